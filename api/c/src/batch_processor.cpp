@@ -0,0 +1,233 @@
+/****************************************************************************
+ * Copyright (C) from 2009 to Present EPAM Systems.
+ *
+ * This file is part of Imago toolkit.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ ***************************************************************************/
+
+#include "batch_processor.h"
+
+#include <indigo.h>
+
+#include "exception.h"
+#include "filter_race.h"
+#include "image_utils.h"
+#include "log_ext.h"
+#include "prefilter_entry.h"
+#include "recognition_context.h"
+#include "superatom_expansion.h"
+
+using namespace imago;
+
+BatchProcessor::BatchProcessor()
+{
+    _threadsCount = 0;
+    _stopping = false;
+}
+
+BatchProcessor::~BatchProcessor()
+{
+    _stop();
+}
+
+BatchProcessor& BatchProcessor::getInstance()
+{
+    static BatchProcessor _instance;
+    return _instance;
+}
+
+void BatchProcessor::setThreadsCount(int count)
+{
+    std::lock_guard<std::mutex> resize_lock(_resizeMutex);
+
+    if (count == _threadsCount)
+        return;
+
+    _stop();
+    _threadsCount = count;
+}
+
+int BatchProcessor::getThreadsCount()
+{
+    std::lock_guard<std::mutex> resize_lock(_resizeMutex);
+
+    if (_threadsCount > 0)
+        return _threadsCount;
+
+    return std::max(1, (int)std::thread::hardware_concurrency());
+}
+
+void BatchProcessor::recognize(const Settings& vars, const std::vector<BatchImage>& images, std::vector<BatchJobResult>& results)
+{
+    results.clear();
+    results.resize(images.size());
+
+    if (images.empty())
+        return;
+
+    Batch batch;
+    batch.vars = &vars;
+    batch.images = &images;
+    batch.results = &results;
+    batch.pending = images.size();
+
+    {
+        // pool can not be stopped between start and enqueue, stopping later drains the queue first
+        std::lock_guard<std::mutex> resize_lock(_resizeMutex);
+
+        if (_workers.empty())
+            _start();
+
+        unique_lock lock(_mutex);
+        for (size_t u = 0; u < images.size(); u++)
+        {
+            Job job;
+            job.batch = &batch;
+            job.index = u;
+            _jobs.push_back(job);
+        }
+        _jobAdded.notify_all();
+    }
+
+    unique_lock lock(_mutex);
+    while (batch.pending > 0)
+        _jobDone.wait(lock);
+}
+
+void BatchProcessor::_start()
+{
+    int count = _threadsCount;
+    if (count <= 0)
+        count = std::max(1, (int)std::thread::hardware_concurrency());
+
+    {
+        unique_lock lock(_mutex);
+        _stopping = false;
+    }
+
+    for (int u = 0; u < count; u++)
+        _workers.push_back(std::thread(&BatchProcessor::_workerRoutine, this));
+}
+
+void BatchProcessor::_stop()
+{
+    {
+        unique_lock lock(_mutex);
+        _stopping = true;
+        _jobAdded.notify_all();
+    }
+
+    for (size_t u = 0; u < _workers.size(); u++)
+        _workers[u].join();
+    _workers.clear();
+}
+
+void BatchProcessor::_workerRoutine()
+{
+    RecognitionContext context;
+    setThreadLogExt(&context.log);
+
+    qword sid = indigoAllocSessionId();
+    indigoSetSessionId(sid);
+
+    for (;;)
+    {
+        Job job;
+        {
+            unique_lock lock(_mutex);
+            while (_jobs.empty() && !_stopping)
+                _jobAdded.wait(lock);
+
+            if (_jobs.empty())
+                break;
+
+            job = _jobs.front();
+            _jobs.pop_front();
+        }
+
+        Batch& batch = *job.batch;
+        _process(context, *batch.vars, (*batch.images)[job.index], (*batch.results)[job.index]);
+
+        {
+            unique_lock lock(_mutex);
+            batch.pending--;
+            if (batch.pending == 0)
+                _jobDone.notify_all();
+        }
+    }
+
+    indigoReleaseSessionId(sid);
+    setThreadLogExt(NULL);
+}
+
+void BatchProcessor::_process(RecognitionContext& context, const Settings& vars, const BatchImage& image, BatchJobResult& result)
+{
+    try
+    {
+        context.vars = vars;
+        context.molfile.clear();
+
+        ImageUtils::loadImageFromBuffer(image.data, image.size, context.img_src);
+
+        // same selection as the console tool: iterate filters until warnings drop below the threshold
+        for (int iter = 0;; iter++)
+        {
+            context.vars.restartTimeLimit();
+
+            if (iter == 0)
+            {
+                if (!prefilterEntrypoint(context.vars, context.img_tmp, context.img_src))
+                    break;
+            }
+            else
+            {
+                if (!applyNextPrefilter(context.vars, context.img_tmp, context.img_src))
+                    break;
+            }
+
+            try
+            {
+                context.csr.image2mol(context.vars, context.img_tmp, context.mol);
+
+                int warnings = getRecognitionWarnings(context.vars, context.mol);
+
+                if (!result.success || warnings < result.warnings)
+                {
+                    result.molfile = expandSuperatoms(context.vars, context.mol);
+                    result.warnings = warnings;
+                    result.success = true;
+                }
+
+                if (warnings <= context.vars.main.WarningsRecalcTreshold)
+                    break;
+            }
+            catch (std::exception& e)
+            {
+                if (!result.success)
+                    result.error = e.what();
+            }
+        }
+
+        if (!result.success && result.error.empty())
+            result.error = "No suitable filter found for the image";
+    }
+    catch (std::exception& e)
+    {
+        result.success = false;
+        result.error = e.what();
+    }
+
+    if (result.success)
+        result.error.clear();
+}
@@ -0,0 +1,103 @@
+/****************************************************************************
+ * Copyright (C) from 2009 to Present EPAM Systems.
+ *
+ * This file is part of Imago toolkit.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ ***************************************************************************/
+
+#pragma once
+
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "settings.h"
+
+namespace imago
+{
+    struct RecognitionContext;
+
+    // encoded image, the caller keeps the bytes alive until recognize() returns
+    struct BatchImage
+    {
+        const byte* data;
+        size_t size;
+    };
+
+    struct BatchJobResult
+    {
+        std::string molfile;
+        std::string error;
+        int warnings;
+        bool success;
+
+        BatchJobResult()
+        {
+            warnings = 0;
+            success = false;
+        }
+    };
+
+    // fixed-size pool of workers, each one owns a recognition context reused across jobs
+    class BatchProcessor
+    {
+    public:
+        static BatchProcessor& getInstance();
+
+        // 0 means count of available cores; waits for running jobs if pool is resized
+        void setThreadsCount(int count);
+        int getThreadsCount();
+
+        // blocks until all the images are processed, every job uses a copy of vars
+        void recognize(const Settings& vars, const std::vector<BatchImage>& images, std::vector<BatchJobResult>& results);
+
+    private:
+        struct Batch
+        {
+            const Settings* vars;
+            const std::vector<BatchImage>* images;
+            std::vector<BatchJobResult>* results;
+            size_t pending;
+        };
+
+        struct Job
+        {
+            Batch* batch;
+            size_t index;
+        };
+
+        int _threadsCount;
+        bool _stopping;
+        std::vector<std::thread> _workers;
+        std::deque<Job> _jobs;
+
+        std::mutex _mutex;
+        std::mutex _resizeMutex;
+        std::condition_variable _jobAdded;
+        std::condition_variable _jobDone;
+        typedef std::unique_lock<std::mutex> unique_lock;
+
+        void _start();
+        void _stop();
+        void _workerRoutine();
+        static void _process(RecognitionContext& context, const Settings& vars, const BatchImage& image, BatchJobResult& result);
+
+        BatchProcessor();
+        BatchProcessor(const BatchProcessor&);
+        ~BatchProcessor();
+    };
+}
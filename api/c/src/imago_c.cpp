@@ -21,14 +21,20 @@
 
 #include <indigo.h>
 
+#include "batch_processor.h"
+#include "character_recognizer.h"
 #include "exception.h"
 #include "failsafe_png.h"
+#include "filter_race.h"
 #include "filters_list.h"
+#include "glyph_cache.h"
 #include "image_utils.h"
 #include "log_ext.h"
 #include "output.h"
+#include "page_recognizer.h"
 #include "prefilter_entry.h"
 #include "recognition_context.h"
+#include "recognition_statistics.h"
 #include "session_manager.h"
 #include "superatom_expansion.h"
 
@@ -76,15 +82,24 @@ CEXPORT void imagoSetSessionId(qword id)
     RecognitionContext* context = getCurrentContext();
 
     if (context == 0)
-        setContextForSession(id, new RecognitionContext());
+    {
+        context = new RecognitionContext();
+        setContextForSession(id, context);
+    }
+
+    setThreadLogExt(&context->log);
 }
 
 CEXPORT void imagoReleaseSessionId(qword id)
 {
     indigoReleaseSessionId(id);
     RecognitionContext* context;
-    if ((context = getCurrentContext()) != 0)
+    if ((context = getContextForSession(id)) != 0)
+    {
+        if (&getLogExt() == &context->log)
+            setThreadLogExt(NULL);
         deleteRecognitionContext(id, context);
+    }
 
     SessionManager::getInstance().releaseSID(id);
 }
@@ -119,6 +134,22 @@ CEXPORT int imagoSetConfig(const char* Name)
     IMAGO_END;
 }
 
+CEXPORT int imagoSetFontDirectory(const char* path)
+{
+    IMAGO_BEGIN;
+
+    RecognitionContext* context = getCurrentContext();
+    std::string dir = path ? path : "";
+
+    // load right now to report errors here, not during the recognition
+    if (!dir.empty())
+        CharacterRecognizerImp::getFontTemplates(context->vars, dir);
+
+    context->vars.general.FontDirectory = dir;
+
+    IMAGO_END;
+}
+
 CEXPORT int imagoSetFilter(const char* Name)
 {
     IMAGO_BEGIN;
@@ -143,13 +174,23 @@ CEXPORT int imagoSetFilter(const char* Name)
     IMAGO_END;
 }
 
+// new image restarts the time limit, drops the previous cancellation and statistics
+static void _resetImageState(RecognitionContext* context)
+{
+    context->statistics.clear();
+    context->page_structures.clear();
+    context->cancellation.reset();
+    context->vars.restartTimeLimit();
+}
+
 CEXPORT int imagoLoadImageFromFile(const char* FileName)
 {
     IMAGO_BEGIN;
 
     RecognitionContext* context = getCurrentContext();
     ImageUtils::loadImageFromFile(context->img_src, FileName);
-    context->img_tmp = context->img_src;
+    context->img_tmp.share(context->img_src);
+    _resetImageState(context);
 
     IMAGO_END;
 }
@@ -159,6 +200,7 @@ CEXPORT int imagoFilterImage()
     IMAGO_BEGIN;
 
     RecognitionContext* context = getCurrentContext();
+    StatisticsScope scope(context->statistics);
     prefilterEntrypoint(context->vars, context->img_tmp, context->img_src);
 
     IMAGO_END;
@@ -171,7 +213,8 @@ CEXPORT int imagoLoadImageFromBuffer(const char* buf, const int buf_size)
     RecognitionContext* context = getCurrentContext();
     const unsigned char* buf_uc = (const unsigned char*)buf;
     failsafePngLoadBuffer(buf_uc, buf_size, context->img_src);
-    context->img_tmp = context->img_src;
+    context->img_tmp.share(context->img_src);
+    _resetImageState(context);
 
     IMAGO_END;
 }
@@ -180,18 +223,17 @@ CEXPORT int imagoLoadGreyscaleRawImage(const char* buf, const int width, const i
 {
     IMAGO_BEGIN;
 
-    RecognitionContext* context = getCurrentContext();
-    Image& img = context->img_src;
-
-    img.clear();
+    if (buf == NULL || width <= 0 || height <= 0)
+        throw ImagoException("Invalid raw image parameters");
 
-    img.init(width, height);
+    RecognitionContext* context = getCurrentContext();
 
-    for (int y = 0; y < height; y++)
-        for (int x = 0; x < width; x++)
-            img.getByte(x, y) = buf[y * width + x];
+    // the caller owns the buffer only for the call, its view is copied as a whole
+    const cv::Mat1b view(height, width, (byte*)buf);
+    context->img_src.copy(view);
 
-    context->img_tmp = context->img_src;
+    context->img_tmp.share(context->img_src);
+    _resetImageState(context);
 
     IMAGO_END;
 }
@@ -202,16 +244,8 @@ CEXPORT int imagoGetInkPercentage(double* result)
     RecognitionContext* context = getCurrentContext();
     Image& img = context->img_tmp;
 
-    size_t ink = 0;
+    size_t ink = ImageUtils::countBelow(img, 64);
     size_t total = img.getWidth() * img.getHeight();
-    for (int y = 0; y < img.getHeight(); y++)
-    {
-        for (int x = 0; x < img.getWidth(); x++)
-        {
-            if (img.getByte(x, y) < 64)
-                ink++;
-        }
-    }
 
     if (result)
     {
@@ -277,6 +311,7 @@ CEXPORT int imagoRecognize(int* warningsCountDataOut)
 
     RecognitionContext* context = getCurrentContext();
     ChemicalStructureRecognizer& csr = context->csr;
+    StatisticsScope scope(context->statistics);
 
     csr.setImage(context->img_tmp);
     csr.recognize(context->vars, context->mol);
@@ -289,6 +324,228 @@ CEXPORT int imagoRecognize(int* warningsCountDataOut)
     IMAGO_END;
 }
 
+CEXPORT int imagoRecognizeWithAllFilters(int* warningsCountDataOut)
+{
+    IMAGO_BEGIN;
+
+    RecognitionContext* context = getCurrentContext();
+    FilterRaceResult race;
+
+    if (!recognizeFilterRace(context->vars, context->img_src, race))
+        throw ImagoException(race.error);
+
+    context->vars = race.vars;
+    context->img_tmp.copy(race.image);
+    context->mol.clear();
+    context->molfile.swap(race.molfile);
+    context->statistics = race.statistics;
+
+    if (warningsCountDataOut)
+    {
+        (*warningsCountDataOut) = race.warnings;
+    }
+
+    IMAGO_END;
+}
+
+static char* _copyString(const std::string& str)
+{
+    char* result = new char[str.size() + 1];
+    memcpy(result, str.c_str(), str.size());
+    result[str.size()] = 0;
+    return result;
+}
+
+CEXPORT int imagoSetBatchThreads(int count)
+{
+    IMAGO_BEGIN;
+
+    if (count < 0)
+        throw ImagoException("Threads count should be non-negative");
+
+    BatchProcessor::getInstance().setThreadsCount(count);
+
+    IMAGO_END;
+}
+
+CEXPORT int imagoRecognizeBatch(const char** buffers, const int* sizes, int count, ImagoBatchResult* results)
+{
+    IMAGO_BEGIN;
+
+    if (count < 0 || (count > 0 && (buffers == NULL || sizes == NULL || results == NULL)))
+        throw ImagoException("Invalid batch parameters");
+
+    RecognitionContext* context = getCurrentContext();
+    context->cancellation.reset(); // jobs share the instance cancellation via copies of its settings
+
+    // the buffers are not copied, they stay valid until this call returns
+    std::vector<BatchImage> images(count);
+    for (int u = 0; u < count; u++)
+    {
+        images[u].data = (const byte*)buffers[u];
+        images[u].size = sizes[u] > 0 ? (size_t)sizes[u] : 0;
+    }
+
+    std::vector<BatchJobResult> jobs;
+    BatchProcessor::getInstance().recognize(context->vars, images, jobs);
+
+    for (int u = 0; u < count; u++)
+    {
+        results[u].warnings = jobs[u].warnings;
+        results[u].molfile = jobs[u].success ? _copyString(jobs[u].molfile) : NULL;
+        results[u].error = jobs[u].success ? NULL : _copyString(jobs[u].error);
+    }
+
+    IMAGO_END;
+}
+
+CEXPORT int imagoFreeBatchResults(ImagoBatchResult* results, int count)
+{
+    IMAGO_BEGIN;
+
+    for (int u = 0; u < count && results != NULL; u++)
+    {
+        delete[] results[u].molfile;
+        delete[] results[u].error;
+        results[u].molfile = NULL;
+        results[u].error = NULL;
+    }
+
+    IMAGO_END;
+}
+
+CEXPORT int imagoRecognizePage(int* count)
+{
+    IMAGO_BEGIN;
+
+    RecognitionContext* context = getCurrentContext();
+    if (!context->img_src.isInit())
+        throw ImagoException("Image is not loaded");
+
+    recognizePageStructures(context->vars, context->img_src, context->page_structures, BatchProcessor::getInstance().getThreadsCount());
+
+    if (count)
+        *count = (int)context->page_structures.size();
+
+    IMAGO_END;
+}
+
+CEXPORT int imagoGetPageStructure(int index, ImagoPageStructure* structure)
+{
+    IMAGO_BEGIN;
+
+    RecognitionContext* context = getCurrentContext();
+    if (index < 0 || index >= (int)context->page_structures.size())
+        throw ImagoException("Page structure index is out of range");
+    if (structure == NULL)
+        throw ImagoException("Invalid page structure pointer");
+
+    const PageStructure& found = context->page_structures[index];
+    structure->molfile = found.success ? found.molfile.c_str() : NULL;
+    structure->error = found.success ? NULL : found.error.c_str();
+    structure->warnings = found.warnings;
+    structure->x = found.bounds.x;
+    structure->y = found.bounds.y;
+    structure->width = found.bounds.width + 1;
+    structure->height = found.bounds.height + 1;
+
+    structure->caption_x = structure->caption_y = structure->caption_width = structure->caption_height = 0;
+    if (found.hasCaption)
+    {
+        structure->caption_x = found.caption.x;
+        structure->caption_y = found.caption.y;
+        structure->caption_width = found.caption.width + 1;
+        structure->caption_height = found.caption.height + 1;
+    }
+
+    IMAGO_END;
+}
+
+CEXPORT int imagoSetGlyphCacheCapacity(int capacity)
+{
+    IMAGO_BEGIN;
+
+    if (capacity < 0)
+        throw ImagoException("Glyph cache capacity should be non-negative");
+
+    GlyphCache::getInstance().setCapacity(capacity);
+
+    IMAGO_END;
+}
+
+CEXPORT int imagoSaveGlyphCache(const char* fileName)
+{
+    IMAGO_BEGIN;
+
+    GlyphCache::getInstance().save(fileName);
+
+    IMAGO_END;
+}
+
+CEXPORT int imagoLoadGlyphCache(const char* fileName)
+{
+    IMAGO_BEGIN;
+
+    GlyphCache::getInstance().load(fileName);
+
+    IMAGO_END;
+}
+
+CEXPORT int imagoGetGlyphCacheStatistics(qword* hits, qword* misses, qword* evictions, qword* entries)
+{
+    IMAGO_BEGIN;
+
+    GlyphCacheStatistics stats = GlyphCache::getInstance().getStatistics();
+    if (hits)
+        *hits = stats.hits;
+    if (misses)
+        *misses = stats.misses;
+    if (evictions)
+        *evictions = stats.evictions;
+    if (entries)
+        *entries = stats.entries;
+
+    IMAGO_END;
+}
+
+CEXPORT int imagoSetTimeLimit(int milliseconds)
+{
+    IMAGO_BEGIN;
+
+    if (milliseconds < 0)
+        throw ImagoException("Time limit should be non-negative");
+
+    RecognitionContext* context = getCurrentContext();
+    context->vars.general.TimeLimit = milliseconds;
+    context->vars.restartTimeLimit();
+
+    IMAGO_END;
+}
+
+CEXPORT int imagoCancel(qword id)
+{
+    IMAGO_BEGIN;
+
+    if (!cancelSession(id))
+        throw ImagoException("Unknown session");
+
+    IMAGO_END;
+}
+
+CEXPORT int imagoGetStatistics(const char** json)
+{
+    IMAGO_BEGIN;
+
+    if (json == NULL)
+        throw ImagoException("Invalid statistics pointer");
+
+    RecognitionContext* context = getCurrentContext();
+    context->statistics_json = context->statistics.toJson();
+    *json = context->statistics_json.c_str();
+
+    IMAGO_END;
+}
+
 CEXPORT int imagoSaveMolToFile(const char* FileName)
 {
     IMAGO_BEGIN;
@@ -336,24 +593,24 @@ CEXPORT int imagoSetLogging(int mode)
     if (mode > 0)
     {
         context->vars.general.LogEnabled = true;
-        imago::getLogExt().setLoggingEnabled(true);
+        context->log.setLoggingEnabled(true);
 
         if (mode == 2)
         {
             context->vars.general.LogVFSEnabled = true;
-            imago::getLogExt().SetVirtualFS(context->vfs);
+            context->log.SetVirtualFS(context->vfs);
             context->vfs.clear();
         }
         else
         {
             context->vars.general.LogVFSEnabled = false;
-            imago::getLogExt().SetNoVirtualFS();
+            context->log.SetNoVirtualFS();
         }
     }
     else
     {
         context->vars.general.LogEnabled = false;
-        imago::getLogExt().setLoggingEnabled(false);
+        context->log.setLoggingEnabled(false);
     }
 
     IMAGO_END;
@@ -24,6 +24,8 @@
  * You can use multiple Imago instances simultaneously, using the
  * 'session ID-s' (see below). It is obligatory to allocate at least one
  * instance to get Imago library work properly.
+ * Different instances may be used concurrently from different threads,
+ * a single instance should be used by one thread at a time.
  */
 
 /* Get the version of Imago.*/
@@ -61,6 +63,11 @@ CEXPORT const char* imagoGetConfigsList();
  * By default, filter from current config will be used. */
 CEXPORT int imagoSetFilter(const char* name);
 
+/* Extend the built-in characters templates by the ones from specified directory,
+ * organized like tools/font-generator/symbols. Empty string means built-in font only.
+ * Every directory is loaded once per process and shared by all instances. */
+CEXPORT int imagoSetFontDirectory(const char* path);
+
 /* Image loading functions. */
 CEXPORT int imagoLoadImageFromBuffer(const char* buf, const int buf_size);
 CEXPORT int imagoLoadImageFromFile(const char* FileName);
@@ -71,9 +78,9 @@ CEXPORT int imagoSaveImageToFile(const char* FileName);
 /* Load raw grayscale image - byte array of length width*height. */
 CEXPORT int imagoLoadGreyscaleRawImage(const char* buf, const int width, const int height);
 
-/* Enable or disable global log printing */
+/* Enable or disable log printing for the current instance */
 /* Modes are: 0 - disabled, 1 - enable log to file, 2 - enable log to virtual fs*/
-/* WARNING: affects all threads/IDS */
+/* WARNING: file logs of all instances are written to the same ./log.html */
 CEXPORT int imagoSetLogging(int mode);
 
 /* Attach some arbitrary data to the current Imago instance. */
@@ -84,6 +91,78 @@ CEXPORT int imagoGetSessionSpecificData(void** data);
    Returns count of recognition warnings in warningsCountDataOut value (if specified) */
 CEXPORT int imagoRecognize(int* warningsCountDataOut = NULL);
 
+/* Filter the loaded image and recognize it, replaces imagoFilterImage() and imagoRecognize() calls.
+   Every filter runs with its recognition on a separate thread, the result is the same as trying them
+   one by one: the first filter with few enough warnings wins, otherwise the one with least warnings.
+   Filters after the winner are cancelled. The filtered image of the winner becomes the current one. */
+CEXPORT int imagoRecognizeWithAllFilters(int* warningsCountDataOut = NULL);
+
+/* Result of a single image from imagoRecognizeBatch(). */
+typedef struct ImagoBatchResult
+{
+    char* molfile; /* recognized molfile, NULL on error */
+    char* error;   /* error message, NULL on success */
+    int warnings;  /* count of recognition warnings */
+} ImagoBatchResult;
+
+/* Set count of worker threads used by imagoRecognizeBatch(), 0 means count of available cores. */
+CEXPORT int imagoSetBatchThreads(int count);
+
+/* Recognize 'count' encoded images (png, jpg, etc) in parallel using the internal worker pool.
+   Every image passes the whole filters chain with a copy of the current instance configuration.
+   'results' should point to 'count' entries, strings stored there must be released by imagoFreeBatchResults().
+   Returns zero only if the batch can not be processed at all, per-image errors are stored in results. */
+CEXPORT int imagoRecognizeBatch(const char** buffers, const int* sizes, int count, ImagoBatchResult* results);
+
+/* Release strings allocated by imagoRecognizeBatch(). */
+CEXPORT int imagoFreeBatchResults(ImagoBatchResult* results, int count);
+
+/* Structure found on the page by imagoRecognizePage(), coordinates are pixels of the loaded image. */
+typedef struct ImagoPageStructure
+{
+    const char* molfile; /* recognized molfile, NULL on error */
+    const char* error;   /* error message, NULL on success */
+    int warnings;        /* count of recognition warnings */
+    int x, y, width, height;
+    int caption_x, caption_y, caption_width, caption_height; /* zero width and height if there is no caption */
+} ImagoPageStructure;
+
+/* Find all the structures on the loaded page and recognize them in parallel, every one with
+   a copy of the current instance configuration on the imagoRecognizeBatch() workers count.
+   Every structure gets the closest text block centered below or above it as the caption.
+   Returns count of found structures in 'count', per-structure errors are kept in their entries. */
+CEXPORT int imagoRecognizePage(int* count);
+
+/* Get the structure found by the last imagoRecognizePage() call, ordered top to bottom, left to right.
+   Strings are owned by the instance and valid until the next image is loaded. */
+CEXPORT int imagoGetPageStructure(int index, ImagoPageStructure* structure);
+
+/* Recognized characters are cached process-wide and shared by all instances and threads.
+   Set the maximal count of cached characters, 0 disables the cache. */
+CEXPORT int imagoSetGlyphCacheCapacity(int capacity);
+
+/* Save the cache content to file and warm the cache from the saved file.
+   Files saved by the library built with other font templates are rejected. */
+CEXPORT int imagoSaveGlyphCache(const char* fileName);
+CEXPORT int imagoLoadGlyphCache(const char* fileName);
+
+/* Returns cache lookups counters since the process start and count of cached characters. */
+CEXPORT int imagoGetGlyphCacheStatistics(qword* hits, qword* misses, qword* evictions, qword* entries);
+
+/* Limit the time of imagoFilterImage() and imagoRecognize() for the loaded image, 0 means no limit.
+   The limit is counted from the first call after the image is loaded. */
+CEXPORT int imagoSetTimeLimit(int milliseconds);
+
+/* Cancel filtering or recognition running in the session, the cancelled call fails with an error.
+   May be called from any thread, the cancellation is dropped when the session loads the next image. */
+CEXPORT int imagoCancel(qword id);
+
+/* Returns JSON object with wall time of recognition stages in milliseconds, the chosen filter
+   and work counters (segments, symbols, graphics, removed captions, compared templates, glyph cache hits and misses)
+   collected by imagoFilterImage() and imagoRecognize() since the image was loaded.
+   The string is owned by the instance and valid until the next call. */
+CEXPORT int imagoGetStatistics(const char** json);
+
 /* Molfile (.mol) output functions. */
 CEXPORT int imagoSaveMolToBuffer(char** buf, int* buf_size);
 CEXPORT int imagoSaveMolToFile(const char* fileName);
@@ -19,6 +19,17 @@ namespace imago
         return it->second;
     }
 
+    bool cancelSession(qword sessionId)
+    {
+        std::lock_guard<std::mutex> lock(_contexts_mutex);
+        ContextMap::iterator it;
+        if ((it = _contexts.find(sessionId)) == _contexts.end())
+            return false;
+
+        it->second->cancellation.cancel();
+        return true;
+    }
+
     void setContextForSession(qword sessionId, RecognitionContext* context)
     {
         std::lock_guard<std::mutex> lock(_contexts_mutex);
@@ -20,10 +20,14 @@
 
 #include <string>
 
+#include "cancellation.h"
 #include "chemical_structure_recognizer.h"
 #include "comdef.h"
 #include "image.h"
+#include "log_ext.h"
 #include "molecule.h"
+#include "page_recognizer.h"
+#include "recognition_statistics.h"
 #include "session_manager.h"
 #include "settings.h"
 #include "virtual_fs.h"
@@ -41,11 +45,17 @@ namespace imago
         std::string error_buf;
         std::string configs_list;
         Settings vars;
+        CancellationToken cancellation; // referenced by vars, set by imagoCancel() from any thread
+        RecognitionStatistics statistics; // of the image loaded last
+        std::string statistics_json;
+        PageStructures page_structures; // found by imagoRecognizePage() on the image loaded last
         VirtualFS vfs;
+        log_ext log; // per-session logger, bound to the thread by imagoSetSessionId()
         void* session_specific_data;
 
-        RecognitionContext()
+        RecognitionContext() : log(".")
         {
+            vars.general.PCancellation = &cancellation;
             session_specific_data = 0;
             error_buf = "No error";
         }
@@ -57,6 +67,9 @@ namespace imago
         return getContextForSession(SessionManager::getInstance().getSID());
     }
 
+    // cancels the recognition of the session, safe to call from any thread
+    bool cancelSession(qword sessionId);
+
     void setContextForSession(qword sessionId, RecognitionContext* context);
     void deleteRecognitionContext(qword sessionId, RecognitionContext* context);
 };
@@ -1,8 +1,10 @@
+import json
 import platform
 import threading
 from ctypes import (
     CDLL,
     POINTER,
+    Structure,
     byref,
     c_byte,
     c_char_p,
@@ -14,16 +16,42 @@ from ctypes import (
     pointer,
 )
 from pathlib import Path
-from typing import AnyStr, Generic, List, Optional, Tuple, TypeVar
+from typing import Any, AnyStr, Dict, Generic, List, Optional, Tuple, TypeVar
 
+from imago.imago_batch_result import ImagoBatchResult
 from imago.imago_exception import ImagoException
 from imago.imago_filters import ImagoFilter
 from imago.imago_log_record import ImagoLogRecord
+from imago.imago_page_structure import ImagoPageStructure
 from PIL import Image
 
 T = TypeVar("T")
 
 
+class _ImagoBatchResult(Structure):
+    _fields_ = [
+        ("molfile", c_char_p),
+        ("error", c_char_p),
+        ("warnings", c_int),
+    ]
+
+
+class _ImagoPageStructure(Structure):
+    _fields_ = [
+        ("molfile", c_char_p),
+        ("error", c_char_p),
+        ("warnings", c_int),
+        ("x", c_int),
+        ("y", c_int),
+        ("width", c_int),
+        ("height", c_int),
+        ("caption_x", c_int),
+        ("caption_y", c_int),
+        ("caption_width", c_int),
+        ("caption_height", c_int),
+    ]
+
+
 class Imago:
     _lib: Optional[CDLL] = None
     _lib_indigo: Optional[CDLL] = None
@@ -135,6 +163,9 @@ class Imago:
             # imagoRecognize
             Imago._lib.imagoRecognize.restype = c_int
             Imago._lib.imagoRecognize.argtypes = [POINTER(c_int)]
+            # imagoRecognizeWithAllFilters
+            Imago._lib.imagoRecognizeWithAllFilters.restype = c_int
+            Imago._lib.imagoRecognizeWithAllFilters.argtypes = [POINTER(c_int)]
             # imagoReleaseSessionId
             Imago._lib.imagoReleaseSessionId.restype = None
             Imago._lib.imagoReleaseSessionId.argtypes = [c_ulonglong]
@@ -156,6 +187,61 @@ class Imago:
             # imagoSetSessionId
             Imago._lib.imagoSetSessionId.restype = None
             Imago._lib.imagoSetSessionId.argtypes = [c_ulonglong]
+            # imagoSetBatchThreads
+            Imago._lib.imagoSetBatchThreads.restype = c_int
+            Imago._lib.imagoSetBatchThreads.argtypes = [c_int]
+            # imagoRecognizeBatch
+            Imago._lib.imagoRecognizeBatch.restype = c_int
+            Imago._lib.imagoRecognizeBatch.argtypes = [
+                POINTER(c_char_p),
+                POINTER(c_int),
+                c_int,
+                POINTER(_ImagoBatchResult),
+            ]
+            # imagoFreeBatchResults
+            Imago._lib.imagoFreeBatchResults.restype = c_int
+            Imago._lib.imagoFreeBatchResults.argtypes = [
+                POINTER(_ImagoBatchResult),
+                c_int,
+            ]
+            # imagoSetFontDirectory
+            Imago._lib.imagoSetFontDirectory.restype = c_int
+            Imago._lib.imagoSetFontDirectory.argtypes = [c_char_p]
+            # imagoSetGlyphCacheCapacity
+            Imago._lib.imagoSetGlyphCacheCapacity.restype = c_int
+            Imago._lib.imagoSetGlyphCacheCapacity.argtypes = [c_int]
+            # imagoSaveGlyphCache
+            Imago._lib.imagoSaveGlyphCache.restype = c_int
+            Imago._lib.imagoSaveGlyphCache.argtypes = [c_char_p]
+            # imagoLoadGlyphCache
+            Imago._lib.imagoLoadGlyphCache.restype = c_int
+            Imago._lib.imagoLoadGlyphCache.argtypes = [c_char_p]
+            # imagoGetGlyphCacheStatistics
+            Imago._lib.imagoGetGlyphCacheStatistics.restype = c_int
+            Imago._lib.imagoGetGlyphCacheStatistics.argtypes = [
+                POINTER(c_ulonglong),
+                POINTER(c_ulonglong),
+                POINTER(c_ulonglong),
+                POINTER(c_ulonglong),
+            ]
+            # imagoGetStatistics
+            Imago._lib.imagoGetStatistics.restype = c_int
+            Imago._lib.imagoGetStatistics.argtypes = [POINTER(c_char_p)]
+            # imagoSetTimeLimit
+            Imago._lib.imagoSetTimeLimit.restype = c_int
+            Imago._lib.imagoSetTimeLimit.argtypes = [c_int]
+            # imagoCancel
+            Imago._lib.imagoCancel.restype = c_int
+            Imago._lib.imagoCancel.argtypes = [c_ulonglong]
+            # imagoRecognizePage
+            Imago._lib.imagoRecognizePage.restype = c_int
+            Imago._lib.imagoRecognizePage.argtypes = [POINTER(c_int)]
+            # imagoGetPageStructure
+            Imago._lib.imagoGetPageStructure.restype = c_int
+            Imago._lib.imagoGetPageStructure.argtypes = [
+                c_int,
+                POINTER(_ImagoPageStructure),
+            ]
             # Archive
             # TODO: check if we need any of this
             # # imagoGetSessionSpecificData
@@ -203,10 +289,7 @@ class Imago:
         width = c_int(image.width)
         height = c_int(image.height)
         data = image.tobytes("raw")
-        image_size = image.width * image.height
-        buf = (c_byte * image_size)()
-        for i in range(image_size):
-            buf[i] = data[i]
+        buf = (c_byte * len(data)).from_buffer_copy(data)
         self._set_session_id()
         Imago._check_result(
             Imago._lib.imagoLoadGreyscaleRawImage(buf, width, height)
@@ -261,6 +344,121 @@ class Imago:
         Imago._check_result(Imago._lib.imagoRecognize(byref(warnings_count)))
         return warnings_count.value
 
+    def recognize_with_all_filters(self) -> int:
+        """
+        Filter the loaded image by all the filters concurrently and recognize it,
+        keeps the first filter in order with few enough warnings
+        Returns count of recognition warnings
+        """
+        warnings_count = c_int()
+        self._set_session_id()
+        Imago._check_result(Imago._lib.imagoRecognizeWithAllFilters(byref(warnings_count)))
+        return warnings_count.value
+
+    def set_batch_threads(self, count: int) -> None:
+        """Set count of worker threads used by recognize_batch(), 0 means count of available cores"""
+        self._set_session_id()
+        Imago._check_result(Imago._lib.imagoSetBatchThreads(count))
+
+    def recognize_batch(self, buffers: List[bytes]) -> List[ImagoBatchResult]:
+        """
+        Recognize several encoded images in parallel using current configuration
+        Returns molecule, warnings count and error message for each image
+        """
+        count = len(buffers)
+        data = (c_char_p * count)(*buffers)
+        sizes = (c_int * count)(*[len(buffer) for buffer in buffers])
+        results = (_ImagoBatchResult * count)()
+        self._set_session_id()
+        Imago._check_result(
+            Imago._lib.imagoRecognizeBatch(data, sizes, count, results)
+        )
+        try:
+            return [
+                ImagoBatchResult(
+                    r.molfile.decode() if r.molfile else None,
+                    r.warnings,
+                    r.error.decode() if r.error else None,
+                )
+                for r in results
+            ]
+        finally:
+            Imago._lib.imagoFreeBatchResults(results, count)
+
+    def recognize_page(self) -> List[ImagoPageStructure]:
+        """
+        Find all the structures on the loaded page and recognize them in parallel
+        Returns molecule, bounding box and caption box of each structure in reading order
+        """
+        count = c_int()
+        self._set_session_id()
+        Imago._check_result(Imago._lib.imagoRecognizePage(byref(count)))
+        structures = []
+        for index in range(count.value):
+            s = _ImagoPageStructure()
+            Imago._check_result(Imago._lib.imagoGetPageStructure(index, byref(s)))
+            structures.append(
+                ImagoPageStructure(
+                    s.molfile.decode() if s.molfile else None,
+                    s.warnings,
+                    s.error.decode() if s.error else None,
+                    (s.x, s.y, s.width, s.height),
+                    (s.caption_x, s.caption_y, s.caption_width, s.caption_height)
+                    if s.caption_width > 0
+                    else None,
+                )
+            )
+        return structures
+
+    def set_font_directory(self, path: Optional[Path]) -> None:
+        """Extend built-in characters templates by the ones from directory, None resets to built-in only"""
+        self._set_session_id()
+        Imago._check_result(
+            Imago._lib.imagoSetFontDirectory(str(path).encode() if path else b"")
+        )
+
+    def set_glyph_cache_capacity(self, capacity: int) -> None:
+        """Set count of characters in the process-wide recognition cache, 0 disables it"""
+        self._set_session_id()
+        Imago._check_result(Imago._lib.imagoSetGlyphCacheCapacity(capacity))
+
+    def save_glyph_cache(self, filename: str) -> None:
+        """Save process-wide characters recognition cache to file"""
+        self._set_session_id()
+        Imago._check_result(Imago._lib.imagoSaveGlyphCache(filename.encode()))
+
+    def load_glyph_cache(self, filename: str) -> None:
+        """Warm process-wide characters recognition cache from file"""
+        self._set_session_id()
+        Imago._check_result(Imago._lib.imagoLoadGlyphCache(filename.encode()))
+
+    def get_glyph_cache_statistics(self) -> Dict[str, int]:
+        """Returns hits, misses, evictions and entries counters of the characters recognition cache"""
+        counters = [c_ulonglong() for _ in range(4)]
+        self._set_session_id()
+        Imago._check_result(
+            Imago._lib.imagoGetGlyphCacheStatistics(*[byref(c) for c in counters])
+        )
+        return dict(
+            zip(("hits", "misses", "evictions", "entries"), [c.value for c in counters])
+        )
+
+    def get_statistics(self) -> Dict[str, Any]:
+        """Returns stage timings in ms, the chosen filter and work counters of the loaded image"""
+        result = c_char_p()
+        self._set_session_id()
+        Imago._check_result(Imago._lib.imagoGetStatistics(byref(result)))
+        return json.loads(result.value.decode("ascii"))
+
+    def set_time_limit(self, milliseconds: int) -> None:
+        """Limit filtering and recognition of each loaded image, 0 disables the limit"""
+        self._set_session_id()
+        Imago._check_result(Imago._lib.imagoSetTimeLimit(milliseconds))
+
+    def cancel(self) -> None:
+        """Abort filtering or recognition of this session, safe to call from another thread"""
+        Imago._check_result(Imago._lib.imagoCancel(self._session_id))
+
     @property
     def image(self) -> Image:
         """Returns filtered image"""
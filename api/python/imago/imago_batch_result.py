@@ -0,0 +1,10 @@
+from typing import Optional
+
+
+class ImagoBatchResult:
+    def __init__(
+        self, molecule: Optional[str], warnings: int, error: Optional[str]
+    ) -> None:
+        self.molecule: Optional[str] = molecule
+        self.warnings: int = warnings
+        self.error: Optional[str] = error
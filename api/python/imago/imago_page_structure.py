@@ -0,0 +1,18 @@
+from typing import Optional, Tuple
+
+
+class ImagoPageStructure:
+    def __init__(
+        self,
+        molecule: Optional[str],
+        warnings: int,
+        error: Optional[str],
+        bounds: Tuple[int, int, int, int],
+        caption: Optional[Tuple[int, int, int, int]],
+    ) -> None:
+        self.molecule: Optional[str] = molecule
+        self.warnings: int = warnings
+        self.error: Optional[str] = error
+        # (x, y, width, height) in pixels of the page
+        self.bounds: Tuple[int, int, int, int] = bounds
+        self.caption: Optional[Tuple[int, int, int, int]] = caption
@@ -4,7 +4,7 @@ from pathlib import Path
 from imago import Imago, ImagoException
 from imago.imago_filters import ImagoFilter
 from PIL import Image
-from tests import CAFFEINE_JPG, OUTPUT_DIR
+from tests import CAFFEINE_JPG, OUTPUT_DIR, TESTS_DIR
 
 
 class ImagoTest(unittest.TestCase):
@@ -97,6 +97,114 @@ class ImagoTest(unittest.TestCase):
         for log_record in self.imago.log_records:
             print(log_record.filename)
 
+    def test_recognize_batch(self) -> None:
+        with CAFFEINE_JPG.open("rb") as f:
+            data = f.read()
+        self.imago.set_batch_threads(2)
+        results = self.imago.recognize_batch([data, b"not an image", data])
+        assert len(results) == 3
+        assert results[0].molecule and results[0].error is None
+        assert results[1].molecule is None and results[1].error
+        # molfile header line contains a timestamp
+        first = results[0].molecule.splitlines()
+        second = results[2].molecule.splitlines()
+        assert first[:1] + first[2:] == second[:1] + second[2:]
+
+    def test_glyph_cache(self) -> None:
+        self.imago.set_glyph_cache_capacity(10000)
+        self.imago.load_image_from_file(CAFFEINE_JPG)
+        self.imago.filter_image(ImagoFilter.BASIC)
+        self.imago.recognize()
+        first = self.imago.molecule
+        before = self.imago.get_glyph_cache_statistics()
+        assert before["entries"] > 0
+        cache_path = OUTPUT_DIR / "test_glyph_cache.bin"
+        self.imago.save_glyph_cache(str(cache_path))
+        # the same glyphs are served from the cache and give the same molecule
+        self.imago.set_glyph_cache_capacity(0)
+        self.imago.set_glyph_cache_capacity(10000)
+        self.imago.load_glyph_cache(str(cache_path))
+        self.imago.load_image_from_file(CAFFEINE_JPG)
+        self.imago.filter_image(ImagoFilter.BASIC)
+        self.imago.recognize()
+        second = self.imago.molecule
+        after = self.imago.get_glyph_cache_statistics()
+        assert after["hits"] > before["hits"]
+        assert first.splitlines()[2:] == second.splitlines()[2:]
+        with self.assertRaises(ImagoException):
+            self.imago.load_glyph_cache(str(CAFFEINE_JPG))
+
+    def test_statistics(self) -> None:
+        self.imago.load_image_from_file(CAFFEINE_JPG)
+        assert self.imago.get_statistics()["filter"]["index"] == -1
+        self.imago.filter_image(ImagoFilter.BASIC)
+        self.imago.recognize()
+        statistics = self.imago.get_statistics()
+        assert statistics["filter"]["index"] >= 0
+        assert statistics["filter"]["name"]
+        assert statistics["stages_ms"]["segmentation"] > 0
+        assert statistics["total_ms"] >= statistics["stages_ms"]["prefilter"]
+        assert statistics["counters"]["segments"] > 0
+        assert statistics["counters"]["symbols"] > 0
+
+    def test_recognize_with_all_filters(self) -> None:
+        self.imago.load_image_from_file(CAFFEINE_JPG)
+        self.imago.recognize_with_all_filters()
+        assert self.imago.molecule
+        assert self.imago.get_statistics()["filter"]["index"] >= 0
+
+    def test_filter_keeps_source(self) -> None:
+        with Image.open(str(CAFFEINE_JPG)) as image:
+            self.imago.load_image_from_pillow(image)
+        source = self.imago.image.tobytes()
+        self.imago.filter_image(ImagoFilter.BASIC)
+        first = self.imago.image.tobytes()
+        self.imago.filter_image(ImagoFilter.BASIC)
+        assert self.imago.image.tobytes() == first
+        assert first != source
+
+    def test_recognize_page(self) -> None:
+        with Image.open(str(CAFFEINE_JPG)) as image:
+            structure = image.convert("L")
+        gap = structure.width // 2
+        page = Image.new("L", (2 * structure.width + gap, structure.height), 255)
+        page.paste(structure, (0, 0))
+        page.paste(structure, (structure.width + gap, 0))
+        page_path = OUTPUT_DIR / "test_recognize_page.png"
+        page.save(page_path)
+        self.imago.load_image_from_file(page_path)
+        structures = self.imago.recognize_page()
+        assert len(structures) == 2
+        for result in structures:
+            assert result.molecule
+            assert result.bounds[2] > 0 and result.bounds[3] > 0
+        assert structures[0].bounds[0] + structures[0].bounds[2] <= structures[1].bounds[0]
+
+    def test_cancel(self) -> None:
+        self.imago.set_time_limit(0)
+        self.imago.load_image_from_file(CAFFEINE_JPG)
+        self.imago.filter_image(ImagoFilter.BASIC)
+        self.imago.cancel()
+        with self.assertRaises(ImagoException):
+            self.imago.recognize()
+        self.imago.load_image_from_file(CAFFEINE_JPG)
+        self.imago.filter_image(ImagoFilter.BASIC)
+        self.imago.recognize()
+        assert self.imago.molecule
+
+    def test_font_directory(self) -> None:
+        symbols = TESTS_DIR.parents[2] / "tools" / "font-generator" / "symbols"
+        self.imago.set_font_directory(symbols / "base")
+        self.imago.load_image_from_file(CAFFEINE_JPG)
+        self.imago.filter_image(ImagoFilter.BASIC)
+        self.imago.recognize()
+        assert self.imago.molecule
+        self.imago.set_font_directory(None)
+        empty = OUTPUT_DIR / "empty_font"
+        empty.mkdir(exist_ok=True)
+        with self.assertRaises(ImagoException):
+            self.imago.set_font_directory(empty)
+
     def test_ink_percentage(self) -> None:
         self.imago.load_image_from_file(CAFFEINE_JPG)
         orignal_ink_percentage = self.imago.image_ink_percentage
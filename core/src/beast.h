@@ -18,8 +18,9 @@
 
 #pragma once
 
-#include <list>
 #include <cstddef>
+#include <iterator>
+#include <utility>
 #include <vector>
 
 namespace beast
@@ -72,56 +73,147 @@ namespace beast
         } edge_descriptor;
 
     protected:
+        // (neighbour vertex id, edge id) pairs in the order of edges addition, the first few are stored inline
+        class _Neighbors
+        {
+        public:
+            typedef std::pair<size_t, size_t> value_type;
+
+            _Neighbors() : _size(0)
+            {
+            }
+
+            size_t size() const
+            {
+                return _size;
+            }
+            const value_type& operator[](size_t index) const
+            {
+                return _data()[index];
+            }
+            void push_back(const value_type& value)
+            {
+                if (_size < INLINE_COUNT)
+                {
+                    _inline[_size] = value;
+                }
+                else
+                {
+                    if (_size == INLINE_COUNT)
+                        _heap.assign(_inline, _inline + INLINE_COUNT);
+                    _heap.push_back(value);
+                }
+                _size++;
+            }
+            // keeps the order of the rest
+            void eraseEdge(size_t edge_id)
+            {
+                value_type* data = _data();
+                for (size_t u = 0; u < _size; u++)
+                {
+                    if (data[u].second == edge_id)
+                    {
+                        for (size_t v = u + 1; v < _size; v++)
+                            data[v - 1] = data[v];
+                        _size--;
+                        if (_size > INLINE_COUNT)
+                            _heap.pop_back();
+                        else if (_size == INLINE_COUNT)
+                        {
+                            std::copy(_heap.begin(), _heap.begin() + INLINE_COUNT, _inline);
+                            _heap.clear();
+                        }
+                        return;
+                    }
+                }
+            }
+            void clear()
+            {
+                _size = 0;
+                _heap.clear();
+            }
+
+        private:
+            enum
+            {
+                INLINE_COUNT = 4
+            };
+
+            value_type _inline[INLINE_COUNT];
+            std::vector<value_type> _heap; // all the neighbours once there are more than INLINE_COUNT
+            size_t _size;
+
+            value_type* _data()
+            {
+                return _size > INLINE_COUNT ? &_heap[0] : _inline;
+            }
+            const value_type* _data() const
+            {
+                return _size > INLINE_COUNT ? &_heap[0] : _inline;
+            }
+        };
+
         struct _Vertex
         {
-            _Vertex(size_t id) : desc(id)
+            _Vertex(size_t id) : desc(id), data(), alive(true)
             {
             }
             vertex_descriptor desc;
-            std::list<std::pair<size_t, size_t>> neighbors;
+            _Neighbors neighbors;
             vertex_data_type data;
+            bool alive;
         };
 
         struct _Edge
         {
-            _Edge(edge_descriptor desc, vertex_descriptor u, vertex_descriptor v) : desc(desc), source(u), target(v)
+            _Edge(edge_descriptor desc, vertex_descriptor u, vertex_descriptor v) : desc(desc), source(u), target(v), data(), alive(true)
             {
             }
             edge_descriptor desc;
             vertex_descriptor source;
             vertex_descriptor target;
             edge_data_type data;
+            bool alive;
         };
 
-        std::list<_Vertex> _vertices;
-        std::list<_Edge> _edges;
-        std::vector<typename std::list<_Vertex>::iterator> _vertex_indices;
-        std::vector<typename std::list<_Edge>::iterator> _edge_indices;
+        // slots are indexed by descriptor ids. ids are never reused: descriptors of removed
+        // vertices and edges are kept in maps by the callers, so removed slots stay dead
+        std::vector<_Vertex> _vertices;
+        std::vector<_Edge> _edges;
+        size_t _vertex_count;
+        size_t _edge_count;
+
+        // position of the alive slot not before index, npos if there is none
+        template <class Slot>
+        static size_t _nextAlive(const std::vector<Slot>& slots, size_t index)
+        {
+            while (index < slots.size() && !slots[index].alive)
+                index++;
+            return index < slots.size() ? index : npos;
+        }
+
+        static const size_t npos = (size_t)-1;
 
     public:
-        class vertex_iterator : public std::iterator<std::forward_iterator_tag, vertex_descriptor>
+        // iterators keep slot indices, so they survive additions and removals of other elements
+        class vertex_iterator
         {
         public:
-            vertex_iterator()
-            {
-            }
-            vertex_iterator(typename std::list<_Vertex>::iterator& iter) : m_iter(iter)
-            {
-            }
-            vertex_iterator(const typename std::list<_Vertex>::iterator& iter) : m_iter(iter)
-            {
-            }
-            vertex_iterator(const vertex_iterator& other) : m_iter(other.m_iter)
+            typedef std::forward_iterator_tag iterator_category;
+            typedef vertex_descriptor value_type;
+            typedef std::ptrdiff_t difference_type;
+            typedef const vertex_descriptor* pointer;
+            typedef vertex_descriptor reference;
+
+            vertex_iterator() : m_vertices(NULL), m_index(npos)
             {
             }
-            vertex_iterator& operator=(const vertex_iterator& other)
+            vertex_iterator(const std::vector<_Vertex>* vertices, size_t index) : m_vertices(vertices), m_index(_nextAlive(*vertices, index))
             {
-                m_iter = other.m_iter;
-                return *this;
             }
             bool operator==(const vertex_iterator& other) const
             {
-                return m_iter == other.m_iter;
+                return _position() == other._position();
             }
             bool operator!=(const vertex_iterator& other) const
             {
@@ -129,41 +221,44 @@ namespace beast
             }
             vertex_descriptor operator*() const
             {
-                return m_iter->desc;
+                return (*m_vertices)[m_index].desc;
             }
             vertex_iterator& operator++()
             {
-                return ++m_iter, *this;
+                m_index = _nextAlive(*m_vertices, m_index + 1);
+                return *this;
             }
 
         private:
-            typename std::list<_Vertex>::iterator m_iter;
+            const std::vector<_Vertex>* m_vertices;
+            size_t m_index;
+
+            // slots added after the iterator was made at the end are visited as the list ones were
+            size_t _position() const
+            {
+                return (m_vertices && m_index != npos) ? _nextAlive(*m_vertices, m_index) : npos;
+            }
         };
         friend class vertex_iterator;
 
-        class edge_iterator : public std::iterator<std::forward_iterator_tag, edge_descriptor>
+        class edge_iterator
         {
         public:
-            edge_iterator()
-            {
-            }
-            edge_iterator(typename std::list<_Edge>::iterator& iter) : m_iter(iter)
-            {
-            }
-            edge_iterator(const typename std::list<_Edge>::iterator& iter) : m_iter(iter)
-            {
-            }
-            edge_iterator(const edge_iterator& other) : m_iter(other.m_iter)
+            typedef std::forward_iterator_tag iterator_category;
+            typedef edge_descriptor value_type;
+            typedef std::ptrdiff_t difference_type;
+            typedef const edge_descriptor* pointer;
+            typedef edge_descriptor reference;
+
+            edge_iterator() : m_edges(NULL), m_index(npos)
             {
             }
-            edge_iterator& operator=(const edge_iterator& other)
+            edge_iterator(const std::vector<_Edge>* edges, size_t index) : m_edges(edges), m_index(_nextAlive(*edges, index))
             {
-                m_iter = other.m_iter;
-                return *this;
             }
             bool operator==(const edge_iterator& other) const
             {
-                return m_iter == other.m_iter;
+                return _position() == other._position();
             }
             bool operator!=(const edge_iterator& other) const
             {
@@ -171,42 +266,52 @@ namespace beast
             }
             edge_descriptor operator*() const
             {
-                return m_iter->desc;
+                return (*m_edges)[m_index].desc;
             }
             edge_iterator& operator++()
             {
-                return ++m_iter, *this;
+                m_index = _nextAlive(*m_edges, m_index + 1);
+                return *this;
             }
             vertex_descriptor get_source()
             {
-                return m_iter->source;
+                return (*m_edges)[m_index].source;
             }
             vertex_descriptor get_target()
             {
-                return m_iter->target;
+                return (*m_edges)[m_index].target;
             }
 
         private:
-            typename std::list<_Edge>::iterator m_iter;
+            const std::vector<_Edge>* m_edges;
+            size_t m_index;
+
+            size_t _position() const
+            {
+                return (m_edges && m_index != npos) ? _nextAlive(*m_edges, m_index) : npos;
+            }
         };
         friend class edge_iterator;
 
-        class adjacency_iterator : public std::iterator<std::forward_iterator_tag, vertex_descriptor>
+        class adjacency_iterator
         {
         public:
-            adjacency_iterator()
-            {
-            }
-            adjacency_iterator(typename std::list<std::pair<size_t, size_t>>::iterator& iter) : m_iter(iter)
+            typedef std::forward_iterator_tag iterator_category;
+            typedef vertex_descriptor value_type;
+            typedef std::ptrdiff_t difference_type;
+            typedef const vertex_descriptor* pointer;
+            typedef vertex_descriptor reference;
+
+            adjacency_iterator() : m_vertices(NULL), m_vertex(npos), m_index(npos)
             {
             }
-            adjacency_iterator(const typename std::list<std::pair<size_t, size_t>>::iterator& iter) : m_iter(iter)
+            adjacency_iterator(const std::vector<_Vertex>* vertices, size_t vertex, size_t index) : m_vertices(vertices), m_vertex(vertex), m_index(index)
             {
             }
 
             bool operator==(const adjacency_iterator& other) const
             {
-                return m_iter == other.m_iter;
+                return m_vertex == other.m_vertex && _position() == other._position();
             }
             bool operator!=(const adjacency_iterator& other) const
             {
@@ -214,36 +319,37 @@ namespace beast
             }
             vertex_descriptor operator*() const
             {
-                return vertex_descriptor(m_iter->first);
+                return vertex_descriptor((*m_vertices)[m_vertex].neighbors[m_index].first);
             }
             adjacency_iterator& operator++()
             {
-                return ++m_iter, *this;
+                return ++m_index, *this;
             }
 
         private:
-            typename std::list<std::pair<size_t, size_t>>::iterator m_iter;
+            const std::vector<_Vertex>* m_vertices;
+            size_t m_vertex;
+            size_t m_index;
+
+            size_t _position() const
+            {
+                return (m_vertices && m_index < (*m_vertices)[m_vertex].neighbors.size()) ? m_index : npos;
+            }
         };
 
         class out_edge_iterator
         {
         public:
-            out_edge_iterator()
+            out_edge_iterator() : m_vertices(NULL), m_edges(NULL), m_vertex(npos), m_index(npos)
             {
             }
-            out_edge_iterator(typename std::list<std::pair<size_t, size_t>>::iterator& iter,
-                              const std::vector<typename std::list<_Edge>::iterator>* edge_indices)
-                : m_iter(iter), m_edge_indices(edge_indices)
-            {
-            }
-            out_edge_iterator(const typename std::list<std::pair<size_t, size_t>>::iterator& iter,
-                              const std::vector<typename std::list<_Edge>::iterator>* edge_indices)
-                : m_iter(iter), m_edge_indices(edge_indices)
+            out_edge_iterator(const std::vector<_Vertex>* vertices, const std::vector<_Edge>* edges, size_t vertex, size_t index)
+                : m_vertices(vertices), m_edges(edges), m_vertex(vertex), m_index(index)
             {
             }
             bool operator==(const out_edge_iterator& other) const
             {
-                return m_iter == other.m_iter;
+                return m_vertex == other.m_vertex && _position() == other._position();
             }
             bool operator!=(const out_edge_iterator& other) const
             {
@@ -251,19 +357,26 @@ namespace beast
             }
             edge_descriptor operator*() const
             {
-                return (*m_edge_indices)[m_iter->second]->desc;
+                return (*m_edges)[(*m_vertices)[m_vertex].neighbors[m_index].second].desc;
             }
             out_edge_iterator& operator++()
             {
-                return ++m_iter, *this;
+                return ++m_index, *this;
             }
 
         private:
-            typename std::list<std::pair<size_t, size_t>>::iterator m_iter;
-            const std::vector<typename std::list<_Edge>::iterator>* m_edge_indices;
+            const std::vector<_Vertex>* m_vertices;
+            const std::vector<_Edge>* m_edges;
+            size_t m_vertex;
+            size_t m_index;
+
+            size_t _position() const
+            {
+                return (m_vertices && m_index < (*m_vertices)[m_vertex].neighbors.size()) ? m_index : npos;
+            }
         };
 
-        Graph()
+        Graph() : _vertex_count(0), _edge_count(0)
         {
         }
 
@@ -271,76 +384,75 @@ namespace beast
         {
             _vertices.clear();
             _edges.clear();
-            _vertex_indices.clear();
-            _edge_indices.clear();
+            _vertex_count = _edge_count = 0;
         }
 
         size_t vertexCount() const
         {
-            return _vertices.size();
+            return _vertex_count;
         }
-        vertex_iterator vertexBegin()
+        vertex_iterator vertexBegin() const
         {
-            return vertex_iterator(_vertices.begin());
+            return vertex_iterator(&_vertices, 0);
         }
-        vertex_iterator vertexEnd()
+        vertex_iterator vertexEnd() const
         {
-            return vertex_iterator(_vertices.end());
+            return vertex_iterator(&_vertices, npos);
         }
         vertex_descriptor addVertex()
         {
-            size_t id = _vertex_indices.size();
-            auto iter = _vertices.insert(_vertices.end(), _Vertex(id));
-            _vertex_indices.push_back(iter);
+            size_t id = _vertices.size();
+            _vertices.push_back(_Vertex(id));
+            _vertex_count++;
             return vertex_descriptor(id);
         }
         void removeVertex(vertex_descriptor desc)
         {
-            auto u_iter = _vertex_indices[desc.id];
-            for (auto u_nei_pair : u_iter->neighbors)
-            {
-                // remove edges
-                auto edge_iter = _edge_indices[u_nei_pair.second];
-                auto v_iter = _vertex_indices[u_nei_pair.first];
-                for (auto v_nei_iter = v_iter->neighbors.begin(); v_nei_iter != v_iter->neighbors.end(); ++v_nei_iter)
-                {
-                    if (v_nei_iter->second == u_nei_pair.second)
-                    {
-                        v_iter->neighbors.erase(v_nei_iter);
-                        break;
-                    }
-                }
-                _edge_indices[u_nei_pair.second] = _edges.end();
-                _edges.erase(edge_iter);
-            }
-            _vertex_indices[desc.id] = _vertices.end();
-            _vertices.erase(u_iter);
+            _Vertex& u = _vertices[desc.id];
+            for (size_t i = 0; i < u.neighbors.size(); i++)
+            {
+                // remove edges, a loop has both ends in this vertex
+                size_t v_id = u.neighbors[i].first, edge_id = u.neighbors[i].second;
+                if (!_edges[edge_id].alive)
+                    continue;
+                if (v_id != desc.id)
+                    _vertices[v_id].neighbors.eraseEdge(edge_id);
+                _edges[edge_id].alive = false;
+                _edge_count--;
+            }
+            u.neighbors.clear();
+            u.alive = false;
+            _vertex_count--;
         }
-        //      void clearVertex(vertex_descriptor desc);
-        //      void clearVertex(vertex_iterator iter);
         size_t getDegree(vertex_descriptor desc) const
         {
-            return _vertex_indices[desc.id]->neighbors.size();
+            return _vertices[desc.id].neighbors.size();
         }
 
         size_t edgeCount() const
         {
-            return _edges.size();
+            return _edge_count;
         }
-        edge_iterator edgeBegin()
+        edge_iterator edgeBegin() const
         {
-            return edge_iterator(_edges.begin());
+            return edge_iterator(&_edges, 0);
         }
-        edge_iterator edgeEnd()
+        edge_iterator edgeEnd() const
         {
-            return edge_iterator(_edges.end());
+            return edge_iterator(&_edges, npos);
         }
-        std::pair<edge_descriptor, bool> getEdge(vertex_descriptor u, vertex_descriptor v)
+        // walks the neighbours of the vertex with the smaller degree
+        std::pair<edge_descriptor, bool> getEdge(vertex_descriptor u, vertex_descriptor v) const
         {
-            for (auto iter : _edges)
+            const _Neighbors& u_nei = _vertices[u.id].neighbors;
+            const _Neighbors& v_nei = _vertices[v.id].neighbors;
+            const _Neighbors& nei = u_nei.size() <= v_nei.size() ? u_nei : v_nei;
+            size_t other = u_nei.size() <= v_nei.size() ? v.id : u.id;
+
+            for (size_t i = 0; i < nei.size(); i++)
             {
-                if ((iter.source == u.id && iter.target == v.id) || (iter.source == v.id && iter.target == u.id))
-                    return std::make_pair(edge_descriptor(iter.desc), true);
+                if (nei[i].first == other)
+                    return std::make_pair(_edges[nei[i].second].desc, true);
             }
             return std::make_pair(edge_descriptor(), false);
         }
@@ -349,36 +461,23 @@ namespace beast
             auto result = getEdge(u, v);
             if (!result.second)
             {
-                size_t id = _edge_indices.size();
-                auto iter = _edges.insert(_edges.end(), _Edge(edge_descriptor(id, u, v), u, v));
-                _edge_indices.push_back(iter);
-                _vertex_indices[u.id]->neighbors.push_back(std::make_pair(v.id, id));
-                _vertex_indices[v.id]->neighbors.push_back(std::make_pair(u.id, id));
-                result.first = _edges.back().desc; // edge_descriptor(id, u, v);
+                size_t id = _edges.size();
+                _edges.push_back(_Edge(edge_descriptor(id, u, v), u, v));
+                _vertices[u.id].neighbors.push_back(std::make_pair(v.id, id));
+                _vertices[v.id].neighbors.push_back(std::make_pair(u.id, id));
+                _edge_count++;
+                result.first = _edges.back().desc;
                 result.second = true;
             }
             return result;
         }
         void removeEdge(edge_descriptor desc)
         {
-            auto iter = _edge_indices[desc.id];
             // remove links in vertices
-            for (auto iter = _vertex_indices[desc.m_source.id]->neighbors.begin(), end = _vertex_indices[desc.m_source.id]->neighbors.end(); iter != end;
-                 ++iter)
-                if (iter->second == desc.id)
-                {
-                    _vertex_indices[desc.m_source.id]->neighbors.erase(iter);
-                    break;
-                }
-            for (auto iter = _vertex_indices[desc.m_target.id]->neighbors.begin(), end = _vertex_indices[desc.m_target.id]->neighbors.end(); iter != end;
-                 ++iter)
-                if (iter->second == desc.id)
-                {
-                    _vertex_indices[desc.m_target.id]->neighbors.erase(iter);
-                    break;
-                }
-            _edges.erase(iter);
-            _edge_indices[desc.id] = _edges.end();
+            _vertices[desc.m_source.id].neighbors.eraseEdge(desc.id);
+            _vertices[desc.m_target.id].neighbors.eraseEdge(desc.id);
+            _edges[desc.id].alive = false;
+            _edge_count--;
         }
         void removeEdge(edge_iterator iter)
         {
@@ -396,20 +495,20 @@ namespace beast
 
         adjacency_iterator adjacencyBegin(vertex_descriptor v) const
         {
-            return adjacency_iterator(_vertex_indices[v.id]->neighbors.begin());
+            return adjacency_iterator(&_vertices, v.id, 0);
         }
         adjacency_iterator adjacencyEnd(vertex_descriptor v) const
         {
-            return adjacency_iterator(_vertex_indices[v.id]->neighbors.end());
+            return adjacency_iterator(&_vertices, v.id, npos);
         }
 
         out_edge_iterator outEdgeBegin(vertex_descriptor v) const
         {
-            return out_edge_iterator(_vertex_indices[v.id]->neighbors.begin(), &_edge_indices);
+            return out_edge_iterator(&_vertices, &_edges, v.id, 0);
         }
         out_edge_iterator outEdgeEnd(vertex_descriptor v) const
         {
-            return out_edge_iterator(_vertex_indices[v.id]->neighbors.end(), &_edge_indices);
+            return out_edge_iterator(&_vertices, &_edges, v.id, npos);
         }
 
     private:
@@ -0,0 +1,64 @@
+/****************************************************************************
+ * Copyright (C) from 2009 to Present EPAM Systems.
+ *
+ * This file is part of Imago toolkit.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ ***************************************************************************/
+
+/**
+ * @file cancellation.h
+ *
+ * @brief   Declares the cancellation token of the recognition
+ */
+
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+
+namespace imago
+{
+    // cancellation request shared between the recognition and the controlling threads.
+    // cancel() may be called from any thread, the recognition polls it via Settings::checkTimeLimit().
+    // token with the parent is also cancelled by the parent one
+    class CancellationToken
+    {
+    public:
+        explicit CancellationToken(const CancellationToken* parent = NULL) : _cancelled(false), _parent(parent)
+        {
+        }
+
+        void cancel()
+        {
+            _cancelled.store(true, std::memory_order_relaxed);
+        }
+
+        void reset()
+        {
+            _cancelled.store(false, std::memory_order_relaxed);
+        }
+
+        bool isCancelled() const
+        {
+            return _cancelled.load(std::memory_order_relaxed) || (_parent != NULL && _parent->isCancelled());
+        }
+
+    private:
+        std::atomic<bool> _cancelled;
+        const CancellationToken* _parent;
+
+        CancellationToken(const CancellationToken&);
+        CancellationToken& operator=(const CancellationToken&);
+    };
+}
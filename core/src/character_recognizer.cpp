@@ -18,17 +18,22 @@
 
 #include "character_recognizer.h"
 
+#include <algorithm>
 #include <cmath>
 #include <deque>
 #include <map>
+#include <memory>
+#include <mutex>
 #include <cstring>
 
 #include <opencv2/opencv.hpp>
 
 #include "exception.h"
 #include "file_helpers.h"
+#include "glyph_cache.h"
 #include "log_ext.h"
 #include "platform_tools.h"
+#include "recognition_statistics.h"
 #include "recognition_tree.h"
 #include "segment.h"
 #include "segmentator.h"
@@ -83,190 +88,236 @@ bool imago::CharacterRecognizer::isPossibleCharacter(const Settings& vars, const
     return false;
 }
 
-qword CharacterRecognizer::getSegmentHash(const Segment& seg)
+RecognitionDistance CharacterRecognizer::recognize(const Settings& vars, const Segment& seg, const std::string& candidates) const
 {
     logEnterFunction();
 
-    qword segHash = 0, shift = 0;
+    getLogExt().appendSegment("Source segment", seg);
+    getLogExt().append("Candidates", candidates);
 
-    // hash against the source pixels
-    for (int y = 0; y < seg.getHeight(); y++)
+    RecognitionDistance result = CharacterRecognizerImp::recognizeMat(vars, seg, CharacterRecognizerImp::getTemplates(vars), candidates);
+    getLogExt().appendMap("Font recognition result", result);
+
+    if (getLogExt().loggingEnabled())
     {
-        for (int x = 0; x < seg.getWidth(); x++)
-            if (seg.getByte(x, y) == 0) // ink
-            {
-                shift = (shift << 1) + x * 3 + y * 7;
-                segHash ^= shift;
-            }
+        getLogExt().append("Result candidates", result.getBest());
+        getLogExt().append("Recognition quality", result.getQuality());
     }
 
-    return segHash;
+    return result;
 }
 
-void internalInitTemplates(imago::CharacterRecognizerImp::Templates& templates)
+namespace imago
 {
-    // unsigned int start = platform::TICKS();
+    namespace CharacterRecognizerImp
     {
 #include "font.inc"
-    }
-    // printf("Loaded font (%u entries) in %u ms\n", templates.size(), platform::TICKS() - start);
-}
 
-RecognitionDistance CharacterRecognizer::recognize(const Settings& vars, const Segment& seg, const std::string& candidates) const
-{
-    logEnterFunction();
+        // points straight into the constant font data, nothing is copied at startup
+        static constexpr PackedTemplates builtinTemplates(FONT_DATA);
 
-    getLogExt().appendSegment("Source segment", seg);
-    getLogExt().append("Candidates", candidates);
-
-    qword segHash = getSegmentHash(seg);
-    getLogExt().append("Segment hash", segHash);
-    RecognitionDistance rec;
-
-    if (vars.caches.PCacheSymbolsRecognition && vars.caches.PCacheSymbolsRecognition->find(segHash) != vars.caches.PCacheSymbolsRecognition->end())
-    {
-        rec = (*vars.caches.PCacheSymbolsRecognition)[segHash];
-        getLogExt().appendText("Used cache: clean");
-    }
-    else
-    {
-        static bool init = false;
-        static CharacterRecognizerImp::Templates templates;
-
-        if (!init)
+        const PackedTemplates& getBuiltinTemplates()
         {
-            internalInitTemplates(templates);
-            init = true;
+            return builtinTemplates;
         }
 
-        rec = CharacterRecognizerImp::recognizeMat(vars, seg, templates);
-        getLogExt().appendMap("Font recognition result", rec);
-
-        if (vars.caches.PCacheSymbolsRecognition)
+        static bool compareByText(const MatchRecord* a, const MatchRecord* b)
         {
-            (*vars.caches.PCacheSymbolsRecognition)[segHash] = rec;
-            getLogExt().appendText("Filled cache: clean");
+            return (unsigned char)a->text[0] < (unsigned char)b->text[0];
         }
-    }
 
-    RecognitionDistance result;
+        TemplatesBuffer::TemplatesBuffer(const Templates& templates)
+        {
+            // templates of the same character are stored together
+            std::vector<const MatchRecord*> sorted;
+            for (size_t u = 0; u < templates.size(); u++)
+            {
+                if (templates[u].text.size() == 1)
+                    sorted.push_back(&templates[u]);
+            }
+            std::stable_sort(sorted.begin(), sorted.end(), compareByText);
+
+            const size_t count = sorted.size();
+            if (count >= 0xFFFF)
+                throw ImagoException("Too many characters templates: " + ImagoException::str((int)count));
 
-    for (RecognitionDistance::iterator it = rec.begin(); it != rec.end(); it++)
-    {
-        if (candidates.find(it->first) != std::string::npos)
+            _ink.resize(count * INTERNAL_ARRAY_SIZE);
+            _white.resize(count * INTERNAL_ARRAY_SIZE);
+            _signatures.resize(count * SIGNATURE_SIZE);
+            _ratios.resize(count);
+            _text.resize(count);
+            _first.resize(CHARACTERS_INDEX_SIZE);
+
+            for (size_t u = 0; u < count; u++)
+            {
+                const MatchRecord& mr = *sorted[u];
+                memcpy(&_ink[u * INTERNAL_ARRAY_SIZE], mr.penalty_ink, INTERNAL_ARRAY_SIZE);
+                memcpy(&_white[u * INTERNAL_ARRAY_SIZE], mr.penalty_white, INTERNAL_ARRAY_SIZE);
+                _ratios[u] = mr.wh_ratio;
+                _text[u] = mr.text[0];
+
+                // ink pixels have zero distance to ink
+                unsigned char ink[REQUIRED_SIZE * REQUIRED_SIZE];
+                for (int y = 0; y < REQUIRED_SIZE; y++)
+                    for (int x = 0; x < REQUIRED_SIZE; x++)
+                        ink[y * REQUIRED_SIZE + x] = mr.penalty_ink[(y + PENALTY_SHIFT) * INTERNAL_ARRAY_DIM + x + PENALTY_SHIFT] == CHARACTERS_OFFSET;
+                calculateSignature(ink, REQUIRED_SIZE, &_signatures[u * SIGNATURE_SIZE]);
+            }
+
+            size_t pos = 0;
+            for (int c = 0; c < CHARACTERS_INDEX_SIZE; c++)
+            {
+                while (pos < count && (unsigned char)_text[pos] < c)
+                    pos++;
+                _first[c] = (unsigned short)pos;
+            }
+
+            _view.count = (int)count;
+            _view.penalty_ink = _ink.data();
+            _view.penalty_white = _white.data();
+            _view.signatures = _signatures.data();
+            _view.wh_ratio = _ratios.data();
+            _view.text = _text.data();
+            _view.first = _first.data();
+
+            qword fingerprint = strongHash(_ink.data(), _ink.size());
+            fingerprint = strongHash(_white.data(), _white.size(), fingerprint);
+            fingerprint = strongHash(_ratios.data(), _ratios.size() * sizeof(double), fingerprint);
+            fingerprint = strongHash(_text.data(), _text.size(), fingerprint);
+            _view.fingerprint = fingerprint ? fingerprint : 1;
+        }
+
+        void unpackTemplates(const PackedTemplates& packed, Templates& templates)
         {
-            result[it->first] = it->second;
+            for (int u = 0; u < packed.count; u++)
+            {
+                MatchRecord mr;
+                memcpy(mr.penalty_ink, packed.ink(u), INTERNAL_ARRAY_SIZE);
+                memcpy(mr.penalty_white, packed.white(u), INTERNAL_ARRAY_SIZE);
+                mr.text = std::string(1, packed.text[u]);
+                mr.wh_ratio = packed.wh_ratio[u];
+                templates.push_back(mr);
+            }
         }
-    }
 
-    if (getLogExt().loggingEnabled())
-    {
-        getLogExt().append("Result candidates", result.getBest());
-        getLogExt().append("Recognition quality", result.getQuality());
-    }
+        const PackedTemplates& getFontTemplates(const Settings& vars, const std::string& path)
+        {
+            // fonts are never unloaded, so the returned references stay valid
+            static std::mutex fontsMutex;
+            static std::map<std::string, std::unique_ptr<TemplatesBuffer> > fonts;
 
-    return result;
-}
+            std::lock_guard<std::mutex> lock(fontsMutex);
 
-namespace imago
-{
-    namespace CharacterRecognizerImp
-    {
-        typedef std::vector<cv::Point> Points;
+            std::map<std::string, std::unique_ptr<TemplatesBuffer> >::iterator it = fonts.find(path);
+            if (it != fonts.end())
+                return it->second->getTemplates();
+
+            Templates custom;
+            if (!initializeTemplates(vars, path, custom))
+                throw FileNotFoundException("No characters templates found in '" + path + "'");
+
+            Templates templates;
+            unpackTemplates(getBuiltinTemplates(), templates);
+            templates.insert(templates.end(), custom.begin(), custom.end());
+
+            std::unique_ptr<TemplatesBuffer>& font = fonts[path];
+            font.reset(new TemplatesBuffer(templates));
 
-        class CircleOffsetPoints : public std::vector<Points>
+            getLogExt().append("Loaded font templates", custom.size());
+            return font->getTemplates();
+        }
+
+        const PackedTemplates& getTemplates(const Settings& vars)
         {
-        public:
-            CircleOffsetPoints(int radius)
-            {
-                clear();
-                resize(radius + 1);
+            if (vars.general.FontDirectory.empty())
+                return getBuiltinTemplates();
+            return getFontTemplates(vars, vars.general.FontDirectory);
+        }
 
-                for (int dx = -radius; dx <= radius; dx++)
-                    for (int dy = -radius; dy <= radius; dy++)
-                    {
-                        int distance = imago::round(sqrt((double)(imago::square(dx) + imago::square(dy))));
-                        if (distance <= radius)
-                            at(distance).push_back(cv::Point(dx, dy));
-                    }
+        // squared distance of missing feature, larger than any distance inside the penalty array
+        const int DT_INF = 1 << 20;
+
+        // exact 1d squared euclidean distance transform (Felzenszwalb, Huttenlocher):
+        // d[q] = min over p of (q - p)^2 + f[p], lower envelope of parabolas in linear time
+        static void squaredDistance1D(const int* f, int n, int* d)
+        {
+            int v[INTERNAL_ARRAY_DIM];
+            double z[INTERNAL_ARRAY_DIM + 1];
+            int k = 0;
+            v[0] = 0;
+            z[0] = -DIST_INF;
+            z[1] = DIST_INF;
+
+            for (int q = 1; q < n; q++)
+            {
+                // intersections are rationals with small denominators, double keeps their order exact
+                double s = ((f[q] + q * q) - (f[v[k]] + v[k] * v[k])) / (2.0 * (q - v[k]));
+                while (s <= z[k])
+                {
+                    k--;
+                    s = ((f[q] + q * q) - (f[v[k]] + v[k] * v[k])) / (2.0 * (q - v[k]));
+                }
+                k++;
+                v[k] = q;
+                z[k] = s;
+                z[k + 1] = DIST_INF;
             }
-        };
 
-        static CircleOffsetPoints offsets(REQUIRED_SIZE);
+            k = 0;
+            for (int q = 0; q < n; q++)
+            {
+                while (z[k + 1] < q)
+                    k++;
+                d[q] = (q - v[k]) * (q - v[k]) + f[v[k]];
+            }
+        }
 
-        void calculatePenalties(const cv::Mat1b& img, unsigned char* penalty_ink, unsigned char* penalty_white)
+        // squared distances from every penalty cell to the nearest pixel of the specified value
+        static void squaredDistanceTransform(const cv::Mat1b& img, unsigned char value, int* dist)
         {
-            for (int y = -PENALTY_SHIFT; y < REQUIRED_SIZE + PENALTY_SHIFT; y++)
-                for (int x = -PENALTY_SHIFT; x < REQUIRED_SIZE + PENALTY_SHIFT; x++)
+            const int n = INTERNAL_ARRAY_DIM;
+            int f[INTERNAL_ARRAY_DIM], d[INTERNAL_ARRAY_DIM];
+
+            for (int y = 0; y < n; y++)
+                for (int x = 0; x < n; x++)
                 {
-                    for (int value = 0; value <= 255; value += 255)
-                    {
-                        double min_dist = REQUIRED_SIZE;
-                        for (size_t radius = 0; radius < offsets.size(); radius++)
-                            for (size_t point = 0; point < offsets[radius].size(); point++)
-                            {
-                                int j = y + offsets[radius].at(point).y;
-                                if (j < 0 || j >= img.cols)
-                                    continue;
-                                int i = x + offsets[radius].at(point).x;
-                                if (i < 0 || i >= img.rows)
-                                    continue;
-
-                                if (img(j, i) == value)
-                                {
-                                    min_dist = (double)radius;
-                                    goto found;
-                                }
-                            }
-
-                    found:
-
-                        double result = (value == 0) ? min_dist : sqrt(min_dist);
-
-                        int idx = (y + PENALTY_SHIFT) * INTERNAL_ARRAY_DIM + (x + PENALTY_SHIFT);
-
-                        if (value == 0)
-                            penalty_ink[idx] = std::min(255, CHARACTERS_OFFSET + imago::round(result));
-                        else
-                            penalty_white[idx] = std::min(255, CHARACTERS_OFFSET + imago::round(PENALTY_WHITE_FACTOR * result));
-                    }
+                    int j = y - PENALTY_SHIFT, i = x - PENALTY_SHIFT;
+                    bool feature = j >= 0 && j < img.rows && i >= 0 && i < img.cols && img(j, i) == value;
+                    dist[y * n + x] = feature ? 0 : DT_INF;
                 }
+
+            for (int x = 0; x < n; x++)
+            {
+                for (int y = 0; y < n; y++)
+                    f[y] = dist[y * n + x];
+                squaredDistance1D(f, n, d);
+                for (int y = 0; y < n; y++)
+                    dist[y * n + x] = d[y];
+            }
+
+            for (int y = 0; y < n; y++)
+            {
+                for (int x = 0; x < n; x++)
+                    f[x] = dist[y * n + x];
+                squaredDistance1D(f, n, dist + y * n);
+            }
         }
 
-        double compareImages(const cv::Mat1b& img, const unsigned char* penalty_ink, const unsigned char* penalty_white)
+        void calculatePenalties(const cv::Mat1b& img, unsigned char* penalty_ink, unsigned char* penalty_white)
         {
-            double best = imago::DIST_INF;
-            for (int shift_x = 0; shift_x <= 2 * PENALTY_SHIFT; shift_x += PENALTY_STEP)
+            int dist_ink[INTERNAL_ARRAY_SIZE], dist_white[INTERNAL_ARRAY_SIZE];
+            squaredDistanceTransform(img, 0, dist_ink);
+            squaredDistanceTransform(img, 255, dist_white);
+
+            for (int idx = 0; idx < INTERNAL_ARRAY_SIZE; idx++)
             {
-                for (int shift_y = 0; shift_y <= 2 * PENALTY_SHIFT; shift_y += PENALTY_STEP)
-                {
-                    int sum_ink = 0;
-                    int sum_white = 0;
-                    for (int y = 0; y < img.cols; y++)
-                    {
-                        for (int x = 0; x < img.rows; x++)
-                        {
-                            int value = img(y, x);
-
-                            int idx = (y + PENALTY_SHIFT) * INTERNAL_ARRAY_DIM + (x + PENALTY_SHIFT);
-
-                            if (value == 0)
-                            {
-                                sum_ink += penalty_ink[idx] - CHARACTERS_OFFSET;
-                            }
-                            else
-                            {
-                                sum_white += penalty_white[idx] - CHARACTERS_OFFSET;
-                            }
-                        }
-                    }
+                // distances are rounded and limited by the glyph size
+                int ink = std::min(REQUIRED_SIZE, imago::round(sqrt((double)dist_ink[idx])));
+                int white = std::min(REQUIRED_SIZE, imago::round(sqrt((double)dist_white[idx])));
 
-                    double result = (double)sum_ink + (double)sum_white / (double)PENALTY_WHITE_FACTOR;
-                    if (result < best)
-                        best = result;
-                }
+                penalty_ink[idx] = std::min(255, CHARACTERS_OFFSET + ink);
+                penalty_white[idx] = std::min(255, CHARACTERS_OFFSET + imago::round(PENALTY_WHITE_FACTOR * sqrt((double)white)));
             }
-            return best;
         }
 
         cv::Mat1b prepareImage(const Settings& vars, const cv::Mat1b& src, double& ratio)
@@ -359,8 +410,8 @@ namespace imago
         struct ResultEntry
         {
             double value;
-            std::string text;
-            ResultEntry(double _value, std::string _text)
+            char text;
+            ResultEntry(double _value, char _text)
             {
                 value = _value;
                 text = _text;
@@ -374,17 +425,65 @@ namespace imago
             }
         };
 
-        imago::RecognitionDistance recognizeMat(const Settings& vars, const cv::Mat1b& rect, const Templates& templates)
+        // the result depends on the prepared glyph, its ratio, templates, candidates and few settings only
+        static void makeGlyphKey(const Settings& vars, const PackedTemplates& templates, const MaskedImage& masks, double ratio, const std::string& candidates,
+                                 GlyphKey& key)
+        {
+            memset(key.bits, 0, sizeof(key.bits));
+            for (int y = 0; y < REQUIRED_SIZE; y++)
+                for (int x = 0; x < REQUIRED_SIZE; x++)
+                {
+                    if (masks.ink[y * MASK_STRIDE + x])
+                    {
+                        int bit = y * REQUIRED_SIZE + x;
+                        key.bits[bit / 64] |= (qword)1 << (bit % 64);
+                    }
+                }
+
+            key.ratio = ratio;
+
+            const double params[] = {vars.characters.RatioDiffThresh, vars.characters.DistanceScaleFactor, (double)vars.characters.PruningTopK,
+                                     vars.characters.PruningSignatureMargin};
+            key.context = strongHash(params, sizeof(params), strongHash(candidates.data(), candidates.size(), templates.fingerprint));
+        }
+
+        // keeps PruningTopK templates closest by the signature and all the ones within the margin of the best
+        static void pruneTemplates(const Settings& vars, const MaskedImage& masks, const PackedTemplates& templates, std::vector<int>& survivors)
+        {
+            const int top = vars.characters.PruningTopK;
+            if (top <= 0 || (int)survivors.size() <= top)
+                return;
+
+            std::vector<std::pair<int, int> > coarse; // signature distance, template index
+            coarse.reserve(survivors.size());
+            for (size_t u = 0; u < survivors.size(); u++)
+                coarse.push_back(std::make_pair(compareSignatures(masks.signature, templates.signature(survivors[u])), survivors[u]));
+            std::sort(coarse.begin(), coarse.end());
+
+            const double margin = coarse[0].first * (1.0 + vars.characters.PruningSignatureMargin);
+
+            survivors.clear();
+            for (size_t u = 0; u < coarse.size(); u++)
+            {
+                if ((int)u >= top && coarse[u].first > margin)
+                    break;
+                survivors.push_back(coarse[u].second);
+            }
+
+            getLogExt().append("Templates after pruning", survivors.size());
+        }
+
+        imago::RecognitionDistance recognizeMat(const Settings& vars, const cv::Mat1b& rect, const PackedTemplates& templates, const std::string& candidates)
         {
             imago::RecognitionDistance _result;
 
             std::vector<ResultEntry> results;
 
             double ratio;
-            cv::Mat1b img;
+            MaskedImage masks;
             try
             {
-                img = prepareImage(vars, rect, ratio);
+                prepareMasks(prepareImage(vars, rect, ratio), masks);
             }
             catch (ImagoException& e)
             {
@@ -392,41 +491,62 @@ namespace imago
                 return _result;
             }
 
-            for (size_t u = 0; u < templates.size(); u++)
+            GlyphCache* cache = vars.caches.PGlyphCache;
+            GlyphKey key;
+            if (cache)
             {
-                // Imago supports only one-char-length templates, TODO: upgrade
-                if (templates[u].text.size() != 1)
-                    continue;
-
-                try
+                makeGlyphKey(vars, templates, masks, ratio, candidates, key);
+                bool found = cache->find(key, _result);
+                if (RecognitionStatistics* statistics = getThreadStatistics())
+                    (found ? statistics->glyphCacheHits : statistics->glyphCacheMisses)++;
+                if (found)
                 {
-                    double distance = compareImages(img, templates[u].penalty_ink, templates[u].penalty_white);
-                    double ratio_diff = imago::absolute(ratio - templates[u].wh_ratio);
-
-                    if (ratio_diff < vars.characters.RatioDiffThresh)
-                    {
-                        results.push_back(ResultEntry(distance, templates[u].text));
-                    }
+                    getLogExt().appendText("Used glyph cache");
+                    return _result;
                 }
-                catch (std::exception& e)
+            }
+
+            // ratio is checked first, templates of other characters are not compared at all
+            std::vector<int> survivors;
+            survivors.reserve(templates.count);
+            bool used[CHARACTERS_INDEX_SIZE] = {false};
+            for (size_t c = 0; c < candidates.size(); c++)
+            {
+                unsigned char ch = (unsigned char)candidates[c];
+                if (used[ch])
+                    continue;
+                used[ch] = true;
+
+                for (int u = templates.first[ch]; u < templates.first[ch + 1]; u++)
                 {
-                    printf("Exception: %s\n", e.what());
+                    if (imago::absolute(ratio - templates.wh_ratio[u]) < vars.characters.RatioDiffThresh)
+                        survivors.push_back(u);
                 }
             }
 
-            if (results.empty())
-                return _result;
+            pruneTemplates(vars, masks, templates, survivors);
+
+            if (RecognitionStatistics* statistics = getThreadStatistics())
+                statistics->templatesCompared += survivors.size();
+
+            results.reserve(survivors.size());
+            for (size_t u = 0; u < survivors.size(); u++)
+            {
+                int idx = survivors[u];
+                double distance = compareImages(masks, templates.ink(idx), templates.white(idx));
+                results.push_back(ResultEntry(distance, templates.text[idx]));
+            }
 
             std::sort(results.begin(), results.end());
 
             for (int u = (int)results.size() - 1; u >= 0; u--)
             {
-                if (results[u].text.size() == 1) // Imago supports only one-char-length templates
-                {
-                    _result[results[u].text[0]] = results[u].value / vars.characters.DistanceScaleFactor;
-                }
+                _result[results[u].text] = results[u].value / vars.characters.DistanceScaleFactor;
             }
 
+            if (cache)
+                cache->insert(key, _result);
+
             return _result;
         }
     }
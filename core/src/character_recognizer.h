@@ -52,8 +52,6 @@ namespace imago
         static const std::string graphics;
         static const std::string like_bonds;
 
-    private:
-        static qword getSegmentHash(const Segment& seg);
     };
 
     namespace CharacterRecognizerImp
@@ -78,10 +76,134 @@ namespace imago
 
         typedef std::vector<MatchRecord> Templates;
 
+        const int CHARACTERS_INDEX_SIZE = 256 + 1;
+
+        // low resolution ink density map, used to prune templates before the full comparison
+        const int SIGNATURE_DIM = 8;
+        const int SIGNATURE_SIZE = SIGNATURE_DIM * SIGNATURE_DIM;
+
+        // templates packed by font-generator into font.inc: one contiguous read-only blob,
+        // penalty planes are stored as separate arrays, templates of the same character are
+        // consecutive and the character c owns templates [first[c], first[c + 1])
+        template <int Count> struct PackedFont
+        {
+            unsigned char penalty_ink[Count * INTERNAL_ARRAY_SIZE];
+            unsigned char penalty_white[Count * INTERNAL_ARRAY_SIZE];
+            unsigned char signature[Count * SIGNATURE_SIZE];
+            double wh_ratio[Count];
+            char text[Count];
+            unsigned short first[CHARACTERS_INDEX_SIZE];
+        };
+
+        // non-owning view of the packed font, independent of the templates count
+        struct PackedTemplates
+        {
+            int count;
+            const unsigned char* penalty_ink;
+            const unsigned char* penalty_white;
+            const unsigned char* signatures;
+            const double* wh_ratio;
+            const char* text;
+            const unsigned short* first;
+            qword fingerprint; // content hash of fonts loaded at runtime, 0 for the built-in one
+
+            template <int Count>
+            constexpr PackedTemplates(const PackedFont<Count>& font)
+                : count(Count), penalty_ink(font.penalty_ink), penalty_white(font.penalty_white), signatures(font.signature), wh_ratio(font.wh_ratio),
+                  text(font.text), first(font.first), fingerprint(0)
+            {
+            }
+
+            PackedTemplates()
+                : count(0), penalty_ink(NULL), penalty_white(NULL), signatures(NULL), wh_ratio(NULL), text(NULL), first(NULL), fingerprint(0)
+            {
+            }
+
+            const unsigned char* ink(int u) const
+            {
+                return penalty_ink + u * INTERNAL_ARRAY_SIZE;
+            }
+
+            const unsigned char* white(int u) const
+            {
+                return penalty_white + u * INTERNAL_ARRAY_SIZE;
+            }
+
+            const unsigned char* signature(int u) const
+            {
+                return signatures + u * SIGNATURE_SIZE;
+            }
+        };
+
+        // packs templates loaded at runtime into the same layout as the generated font
+        class TemplatesBuffer
+        {
+        public:
+            // templates with more than one character are skipped
+            explicit TemplatesBuffer(const Templates& templates);
+
+            const PackedTemplates& getTemplates() const
+            {
+                return _view;
+            }
+
+        private:
+            std::vector<unsigned char> _ink;
+            std::vector<unsigned char> _white;
+            std::vector<unsigned char> _signatures;
+            std::vector<double> _ratios;
+            std::vector<char> _text;
+            std::vector<unsigned short> _first;
+            PackedTemplates _view;
+
+            TemplatesBuffer(const TemplatesBuffer&); // view points into own storage
+        };
+
+        // prepared image rows are padded to the penalty array row width
+        const int MASK_STRIDE = INTERNAL_ARRAY_DIM;
+
+        // image converted once into byte masks (0xFF selects the penalty, padding is zero),
+        // so each template comparison becomes a branchless masked sum
+        struct MaskedImage
+        {
+            unsigned char ink[REQUIRED_SIZE * MASK_STRIDE];
+            unsigned char white[REQUIRED_SIZE * MASK_STRIDE];
+            unsigned char signature[SIGNATURE_SIZE];
+            int ink_count;
+            int white_count;
+        };
+
+        enum CompareKernel
+        {
+            ckAuto,
+            ckScalar,
+            ckSSE2,
+            ckAVX2
+        };
+
+        // best kernel supported by the running cpu
+        CompareKernel getDefaultKernel();
+        bool isKernelSupported(CompareKernel kernel);
+        const char* getKernelName(CompareKernel kernel);
+
+        // templates compiled in from font.inc
+        const PackedTemplates& getBuiltinTemplates();
+        // built-in templates extended by the ones from the directory, every directory is loaded once per process
+        const PackedTemplates& getFontTemplates(const Settings& vars, const std::string& path);
+        // selected by GeneralSettings::FontDirectory
+        const PackedTemplates& getTemplates(const Settings& vars);
+        void unpackTemplates(const PackedTemplates& packed, Templates& templates);
+
         void calculatePenalties(const cv::Mat1b& img, unsigned char* penalty_ink, unsigned char* penalty_white);
+        void prepareMasks(const cv::Mat1b& img, MaskedImage& masks);
+        // ink is REQUIRED_SIZE x REQUIRED_SIZE, non-zero bytes are ink pixels
+        void calculateSignature(const unsigned char* ink, int stride, unsigned char* signature);
+        int compareSignatures(const unsigned char* first, const unsigned char* second);
+        double compareImages(const MaskedImage& masks, const unsigned char* penalty_ink, const unsigned char* penalty_white, CompareKernel kernel = ckAuto);
         double compareImages(const cv::Mat1b& img, const unsigned char* penalty_ink, const unsigned char* penalty_white);
         cv::Mat1b prepareImage(const Settings& vars, const cv::Mat1b& src, double& ratio);
         bool initializeTemplates(const Settings& vars, const std::string& path, Templates& templates);
-        RecognitionDistance recognizeMat(const Settings& vars, const cv::Mat1b& image, const Templates& templates);
+        // compares the image only with templates of candidate characters, see CharactersRecognitionSettings::PruningTopK
+        RecognitionDistance recognizeMat(const Settings& vars, const cv::Mat1b& image, const PackedTemplates& templates, const std::string& candidates);
     };
 }
@@ -0,0 +1,274 @@
+/****************************************************************************
+ * Copyright (C) from 2009 to Present EPAM Systems.
+ *
+ * This file is part of Imago toolkit.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ ***************************************************************************/
+
+// vectorized kernels of the template matching, see CharacterRecognizerImp::compareImages
+
+#include <cstdlib>
+#include <cstring>
+
+#if defined(__x86_64__) || defined(__i386__) || defined(_M_X64) || defined(_M_IX86)
+#define IMAGO_X86
+#include <immintrin.h>
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
+#endif
+
+#if defined(IMAGO_X86) && (defined(__GNUC__) || defined(__clang__))
+#define IMAGO_TARGET(x) __attribute__((target(x)))
+#else
+#define IMAGO_TARGET(x)
+#endif
+
+#include "character_recognizer.h"
+#include "exception.h"
+
+namespace imago
+{
+    namespace CharacterRecognizerImp
+    {
+        // first penalty of the image row y, the penalty arrays have PENALTY_SHIFT border
+        static inline int penaltyRowStart(int y)
+        {
+            return (y + PENALTY_SHIFT) * INTERNAL_ARRAY_DIM + PENALTY_SHIFT;
+        }
+
+        static double combine(const MaskedImage& masks, int sum_ink, int sum_white)
+        {
+            // each selected penalty is stored with CHARACTERS_OFFSET added
+            sum_ink -= masks.ink_count * CHARACTERS_OFFSET;
+            sum_white -= masks.white_count * CHARACTERS_OFFSET;
+            return (double)sum_ink + (double)sum_white / (double)PENALTY_WHITE_FACTOR;
+        }
+
+        static double compareScalar(const MaskedImage& masks, const unsigned char* penalty_ink, const unsigned char* penalty_white)
+        {
+            int sum_ink = 0;
+            int sum_white = 0;
+            for (int y = 0; y < REQUIRED_SIZE; y++)
+            {
+                const unsigned char* ink = masks.ink + y * MASK_STRIDE;
+                const unsigned char* white = masks.white + y * MASK_STRIDE;
+                const unsigned char* p_ink = penalty_ink + penaltyRowStart(y);
+                const unsigned char* p_white = penalty_white + penaltyRowStart(y);
+                for (int x = 0; x < REQUIRED_SIZE; x++)
+                {
+                    sum_ink += p_ink[x] & ink[x];
+                    sum_white += p_white[x] & white[x];
+                }
+            }
+            return combine(masks, sum_ink, sum_white);
+        }
+
+#ifdef IMAGO_X86
+        // rows are loaded as MASK_STRIDE bytes, the padding lanes are cleared by the masks.
+        // the last row load ends at penaltyRowStart(REQUIRED_SIZE - 1) + MASK_STRIDE <= INTERNAL_ARRAY_SIZE
+
+        IMAGO_TARGET("sse2")
+        static double compareSSE2(const MaskedImage& masks, const unsigned char* penalty_ink, const unsigned char* penalty_white)
+        {
+            const __m128i zero = _mm_setzero_si128();
+            __m128i acc_ink = _mm_setzero_si128();
+            __m128i acc_white = _mm_setzero_si128();
+            for (int y = 0; y < REQUIRED_SIZE; y++)
+            {
+                const int offset = penaltyRowStart(y);
+                for (int x = 0; x < MASK_STRIDE; x += 16)
+                {
+                    __m128i ink = _mm_loadu_si128((const __m128i*)(masks.ink + y * MASK_STRIDE + x));
+                    __m128i white = _mm_loadu_si128((const __m128i*)(masks.white + y * MASK_STRIDE + x));
+                    __m128i p_ink = _mm_loadu_si128((const __m128i*)(penalty_ink + offset + x));
+                    __m128i p_white = _mm_loadu_si128((const __m128i*)(penalty_white + offset + x));
+                    // horizontal byte sums into two 64-bit lanes
+                    acc_ink = _mm_add_epi64(acc_ink, _mm_sad_epu8(_mm_and_si128(p_ink, ink), zero));
+                    acc_white = _mm_add_epi64(acc_white, _mm_sad_epu8(_mm_and_si128(p_white, white), zero));
+                }
+            }
+            int sum_ink = _mm_cvtsi128_si32(acc_ink) + _mm_cvtsi128_si32(_mm_unpackhi_epi64(acc_ink, acc_ink));
+            int sum_white = _mm_cvtsi128_si32(acc_white) + _mm_cvtsi128_si32(_mm_unpackhi_epi64(acc_white, acc_white));
+            return combine(masks, sum_ink, sum_white);
+        }
+
+        IMAGO_TARGET("avx2")
+        static double compareAVX2(const MaskedImage& masks, const unsigned char* penalty_ink, const unsigned char* penalty_white)
+        {
+            const __m256i zero = _mm256_setzero_si256();
+            __m256i acc_ink = _mm256_setzero_si256();
+            __m256i acc_white = _mm256_setzero_si256();
+            for (int y = 0; y < REQUIRED_SIZE; y++)
+            {
+                const int offset = penaltyRowStart(y);
+                __m256i ink = _mm256_loadu_si256((const __m256i*)(masks.ink + y * MASK_STRIDE));
+                __m256i white = _mm256_loadu_si256((const __m256i*)(masks.white + y * MASK_STRIDE));
+                __m256i p_ink = _mm256_loadu_si256((const __m256i*)(penalty_ink + offset));
+                __m256i p_white = _mm256_loadu_si256((const __m256i*)(penalty_white + offset));
+                acc_ink = _mm256_add_epi64(acc_ink, _mm256_sad_epu8(_mm256_and_si256(p_ink, ink), zero));
+                acc_white = _mm256_add_epi64(acc_white, _mm256_sad_epu8(_mm256_and_si256(p_white, white), zero));
+            }
+            __m128i ink = _mm_add_epi64(_mm256_castsi256_si128(acc_ink), _mm256_extracti128_si256(acc_ink, 1));
+            __m128i white = _mm_add_epi64(_mm256_castsi256_si128(acc_white), _mm256_extracti128_si256(acc_white, 1));
+            int sum_ink = _mm_cvtsi128_si32(ink) + _mm_cvtsi128_si32(_mm_unpackhi_epi64(ink, ink));
+            int sum_white = _mm_cvtsi128_si32(white) + _mm_cvtsi128_si32(_mm_unpackhi_epi64(white, white));
+            return combine(masks, sum_ink, sum_white);
+        }
+
+        static bool cpuSupports(CompareKernel kernel)
+        {
+#ifdef _MSC_VER
+            int info[4];
+            __cpuid(info, 0);
+            int max_leaf = info[0];
+            __cpuid(info, 1);
+            bool sse2 = (info[3] & (1 << 26)) != 0;
+            bool osxsave = (info[2] & (1 << 27)) != 0;
+            bool avx2 = false;
+            if (osxsave && max_leaf >= 7 && (_xgetbv(0) & 6) == 6)
+            {
+                __cpuidex(info, 7, 0);
+                avx2 = (info[1] & (1 << 5)) != 0;
+            }
+            return kernel == ckSSE2 ? sse2 : (kernel == ckAVX2 ? avx2 : false);
+#else
+            __builtin_cpu_init();
+            if (kernel == ckSSE2)
+                return __builtin_cpu_supports("sse2") != 0;
+            if (kernel == ckAVX2)
+                return __builtin_cpu_supports("avx2") != 0;
+            return false;
+#endif
+        }
+#endif
+
+        bool isKernelSupported(CompareKernel kernel)
+        {
+            switch (kernel)
+            {
+            case ckAuto:
+            case ckScalar:
+                return true;
+#ifdef IMAGO_X86
+            case ckSSE2:
+            case ckAVX2:
+                return cpuSupports(kernel);
+#endif
+            default:
+                return false;
+            }
+        }
+
+        CompareKernel getDefaultKernel()
+        {
+            static const CompareKernel kernel = isKernelSupported(ckAVX2) ? ckAVX2 : (isKernelSupported(ckSSE2) ? ckSSE2 : ckScalar);
+            return kernel;
+        }
+
+        const char* getKernelName(CompareKernel kernel)
+        {
+            switch (kernel)
+            {
+            case ckAuto:
+                return "auto";
+            case ckScalar:
+                return "scalar";
+            case ckSSE2:
+                return "sse2";
+            case ckAVX2:
+                return "avx2";
+            default:
+                return "unknown";
+            }
+        }
+
+        void prepareMasks(const cv::Mat1b& img, MaskedImage& masks)
+        {
+            if (img.rows != REQUIRED_SIZE || img.cols != REQUIRED_SIZE)
+                throw ImagoException("Image is not prepared for the template matching");
+
+            memset(masks.ink, 0, sizeof(masks.ink));
+            memset(masks.white, 0, sizeof(masks.white));
+            masks.ink_count = 0;
+            masks.white_count = 0;
+
+            for (int y = 0; y < REQUIRED_SIZE; y++)
+            {
+                for (int x = 0; x < REQUIRED_SIZE; x++)
+                {
+                    if (img(y, x) == 0)
+                    {
+                        masks.ink[y * MASK_STRIDE + x] = 0xFF;
+                        masks.ink_count++;
+                    }
+                    else
+                    {
+                        masks.white[y * MASK_STRIDE + x] = 0xFF;
+                        masks.white_count++;
+                    }
+                }
+            }
+
+            calculateSignature(masks.ink, MASK_STRIDE, masks.signature);
+        }
+
+        void calculateSignature(const unsigned char* ink, int stride, unsigned char* signature)
+        {
+            memset(signature, 0, SIGNATURE_SIZE);
+            for (int y = 0; y < REQUIRED_SIZE; y++)
+            {
+                unsigned char* cells = signature + (y * SIGNATURE_DIM / REQUIRED_SIZE) * SIGNATURE_DIM;
+                for (int x = 0; x < REQUIRED_SIZE; x++)
+                {
+                    if (ink[y * stride + x] != 0)
+                        cells[x * SIGNATURE_DIM / REQUIRED_SIZE]++;
+                }
+            }
+        }
+
+        int compareSignatures(const unsigned char* first, const unsigned char* second)
+        {
+            int result = 0;
+            for (int u = 0; u < SIGNATURE_SIZE; u++)
+                result += std::abs((int)first[u] - (int)second[u]);
+            return result;
+        }
+
+        double compareImages(const MaskedImage& masks, const unsigned char* penalty_ink, const unsigned char* penalty_white, CompareKernel kernel)
+        {
+            if (kernel == ckAuto)
+                kernel = getDefaultKernel();
+
+            switch (kernel)
+            {
+#ifdef IMAGO_X86
+            case ckAVX2:
+                return compareAVX2(masks, penalty_ink, penalty_white);
+            case ckSSE2:
+                return compareSSE2(masks, penalty_ink, penalty_white);
+#endif
+            default:
+                return compareScalar(masks, penalty_ink, penalty_white);
+            }
+        }
+
+        double compareImages(const cv::Mat1b& img, const unsigned char* penalty_ink, const unsigned char* penalty_white)
+        {
+            MaskedImage masks;
+            prepareMasks(img, masks);
+            return compareImages(masks, penalty_ink, penalty_white);
+        }
+    }
+}
@@ -18,10 +18,12 @@
 
 #include "chemical_structure_recognizer.h"
 
+#include <algorithm>
 #include <cmath>
 #include <cstdio>
 #include <deque>
 #include <memory>
+#include <vector>
 
 #include "approximator.h"
 #include "graph_extractor.h"
@@ -36,7 +38,9 @@
 #include "pixel_boundings.h"
 #include "platform_tools.h"
 #include "prefilter_basic.h"
+#include "recognition_statistics.h"
 #include "segment.h"
+#include "segment_arena.h"
 #include "segmentator.h"
 #include "separator.h"
 #include "superatom.h"
@@ -57,7 +61,8 @@ double maxHeightHelper(const Settings& vars, int lines)
     return maxHeight;
 }
 
-bool ChemicalStructureRecognizer::removeMoleculeCaptions(const Settings& vars, Image& img, SegmentDeque& symbols, SegmentDeque& graphics)
+bool ChemicalStructureRecognizer::removeMoleculeCaptions(const Settings& vars, Image& img, SegmentDeque& symbols, SegmentDeque& graphics,
+                                                         std::vector<Rectangle>& cleared)
 {
     logEnterFunction();
 
@@ -151,10 +156,12 @@ bool ChemicalStructureRecognizer::removeMoleculeCaptions(const Settings& vars, I
                     if (bad_symbols.size() >= bad_graphics.size())
                     {
                         getLogExt().appendText("Clearing the image");
+                        img.detach();
                         for (int x = badBounding.x1(); x <= badBounding.x2() && x < img.getWidth(); x++)
                             for (int y = badBounding.y1(); y <= badBounding.y2() && y < img.getHeight(); y++)
                                 img.getByte(x, y) = 255;
 
+                        cleared.push_back(badBounding);
                         result = true;
                     } // if letters>graphics
 
@@ -170,20 +177,51 @@ void ChemicalStructureRecognizer::segmentate(const Settings& vars, Image& img, S
 {
     logEnterFunction();
 
+    // runs are enough when there is nothing to reconnect, no need in points and labels map
+    int range = vars.csr.WeakSegmentatorDist;
+    if (range >= 1 && (range == 1 || !reconnect))
+    {
+        RunComponents components;
+        WeakSegmentator::labelRuns(img, range, components);
+
+        size_t pixels = 0;
+        for (RunComponents::const_iterator it = components.begin(); it != components.end(); ++it)
+            pixels += (size_t)(it->bounds.width + 1) * (it->bounds.height + 1);
+
+        SegmentArena arena(pixels);
+        for (RunComponents::const_iterator it = components.begin(); it != components.end(); ++it)
+        {
+            const Rectangle& bounds = it->bounds;
+            Segment* s = arena.create(bounds.width + 1, bounds.height + 1, bounds.x, bounds.y);
+            for (PixelRuns::const_iterator run = it->runs.begin(); run != it->runs.end(); ++run)
+                for (int x = run->x1; x <= run->x2; x++)
+                    s->getByte(x - bounds.x, run->y - bounds.y) = 0;
+            segments.push_back(s);
+        }
+        return;
+    }
+
     // extract segments using WeakSegmentator
     WeakSegmentator ws(img.getWidth(), img.getHeight());
     ws.appendData(img, WeakSegmentator::getLookupPattern(vars.csr.WeakSegmentatorDist), reconnect);
+
+    std::vector<Rectangle> boundings;
+    size_t pixels = 0;
     for (WeakSegmentator::SegMap::iterator it = ws.SegmentPoints.begin(); it != ws.SegmentPoints.end(); ++it)
+    {
+        boundings.push_back(RectShapedBounding(it->second).getBounding());
+        pixels += (size_t)(boundings.back().width + 1) * (boundings.back().height + 1);
+    }
+
+    SegmentArena arena(pixels);
+    size_t index = 0;
+    for (WeakSegmentator::SegMap::iterator it = ws.SegmentPoints.begin(); it != ws.SegmentPoints.end(); ++it, ++index)
     {
         const Points2i& pts = it->second;
-        RectShapedBounding b(pts);
-        Segment* s = new Segment();
-        s->init(b.getBounding().width + 1, b.getBounding().height + 1);
-        s->fillWhite();
-        s->getX() = b.getBounding().x;
-        s->getY() = b.getBounding().y;
+        const Rectangle& bounds = boundings[index];
+        Segment* s = arena.create(bounds.width + 1, bounds.height + 1, bounds.x, bounds.y);
         for (size_t u = 0; u < pts.size(); u++)
-            s->getByte(pts[u].x - b.getBounding().x, pts[u].y - b.getBounding().y) = 0;
+            s->getByte(pts[u].x - bounds.x, pts[u].y - bounds.y) = 0;
         segments.push_back(s);
     }
 }
@@ -285,43 +323,69 @@ bool ChemicalStructureRecognizer::isReconnectSegmentsRequired(const Settings& va
 
 void ClearSegments(SegmentDeque& segs, SegmentDeque& segSymbols, SegmentDeque& segGraphics)
 {
-    std::map<std::string, Segment*> all_segs;
-    std::map<std::string, Segment*>::iterator map_it;
-    SegmentDeque::iterator it;
-
-    for (it = segs.begin(); it != segs.end(); ++it)
+    // the same segment may be referenced from several deques
+    std::vector<Segment*> all_segs(segs.begin(), segs.end());
+    all_segs.insert(all_segs.end(), segSymbols.begin(), segSymbols.end());
+    all_segs.insert(all_segs.end(), segGraphics.begin(), segGraphics.end());
+    std::sort(all_segs.begin(), all_segs.end());
+    all_segs.erase(std::unique(all_segs.begin(), all_segs.end()), all_segs.end());
+
+    for (std::vector<Segment*>::iterator it = all_segs.begin(); it != all_segs.end(); ++it)
     {
-        std::ostringstream str;
-        str << (*it);
-        all_segs[str.str()] = (*it);
+        if (*it)
+            delete *it;
     }
 
-    for (it = segSymbols.begin(); it != segSymbols.end(); ++it)
-    {
-        std::ostringstream str;
-        str << (*it);
-        if (all_segs.find(str.str()) == all_segs.end())
-            all_segs[str.str()] = (*it);
-    }
+    segGraphics.clear();
+    segSymbols.clear();
+    segs.clear();
+}
+
+void ChemicalStructureRecognizer::dropClearedSegments(const std::vector<Rectangle>& cleared, SegmentDeque& segments, SegmentDeque& layer_symbols,
+                                                      SegmentDeque& layer_graphics)
+{
+    logEnterFunction();
+
+    // the same segment may be referenced from several deques
+    std::vector<Segment*> all_segs(segments.begin(), segments.end());
+    all_segs.insert(all_segs.end(), layer_symbols.begin(), layer_symbols.end());
+    all_segs.insert(all_segs.end(), layer_graphics.begin(), layer_graphics.end());
+    std::sort(all_segs.begin(), all_segs.end());
+    all_segs.erase(std::unique(all_segs.begin(), all_segs.end()), all_segs.end());
 
-    for (it = segGraphics.begin(); it != segGraphics.end(); ++it)
+    std::vector<Segment*> dropped;
+    for (Segment* s : all_segs)
     {
-        std::ostringstream str;
-        str << (*it);
-        if (all_segs.find(str.str()) == all_segs.end())
-            all_segs[str.str()] = (*it);
+        bool touched = false;
+        for (const Rectangle& r : cleared)
+        {
+            int x1 = std::max(r.x1(), s->getX()), x2 = std::min(r.x2(), s->getX() + s->getWidth() - 1);
+            int y1 = std::max(r.y1(), s->getY()), y2 = std::min(r.y2(), s->getY() + s->getHeight() - 1);
+            if (x1 > x2 || y1 > y2)
+                continue;
+
+            // the same pixels are white on the image now
+            for (int y = y1; y <= y2; y++)
+                for (int x = x1; x <= x2; x++)
+                    s->getByte(x - s->getX(), y - s->getY()) = 255;
+            touched = true;
+        }
+
+        if (touched && ImageUtils::countBelow(*s, 128) == 0)
+            dropped.push_back(s);
     }
 
-    for (map_it = all_segs.begin(); map_it != all_segs.end(); ++map_it)
+    getLogExt().append("Dropped segments", dropped.size());
+
+    for (SegmentDeque* deque : {&segments, &layer_symbols, &layer_graphics})
     {
-        if ((*map_it).second)
-            delete (*map_it).second;
+        deque->erase(std::remove_if(deque->begin(), deque->end(),
+                                    [&dropped](Segment* s) { return std::binary_search(dropped.begin(), dropped.end(), s); }),
+                     deque->end());
     }
 
-    segGraphics.clear();
-    segSymbols.clear();
-    segs.clear();
-    all_segs.clear();
+    for (Segment* s : dropped)
+        delete s;
 }
 
 void ChemicalStructureRecognizer::recognize(Settings& vars, Molecule& mol)
@@ -330,11 +394,6 @@ void ChemicalStructureRecognizer::recognize(Settings& vars, Molecule& mol)
 
     Image& _img = _origImage;
 
-    bool captions_removed = false;
-
-restart :
-
-{
     SegmentDeque segments;
     SegmentDeque layer_symbols, layer_graphics;
 
@@ -358,28 +417,35 @@ restart :
 
         getLogExt().appendImage("Cropped image", _img);
 
-        segmentate(vars, _img, segments);
-
-        bool reconnect = isReconnectSegmentsRequired(vars, _img, segments);
-        if (reconnect)
         {
-            getLogExt().appendText("Reconnection procedure apply");
+            StageTimer timer(RecognitionStatistics::stSegmentation);
 
-            // use filter
-            Image temp_img;
-            temp_img.copy(_img);
-            prefilter_basic::prefilterBasicFullsize(vars, temp_img);
+            segmentate(vars, _img, segments);
 
-            SegmentDeque temp;
-            segmentate(vars, temp_img, temp);
-
-            if (temp.size() > 0)
+            bool reconnect = isReconnectSegmentsRequired(vars, _img, segments);
+            if (reconnect)
             {
-                SegmentDeque temp1, temp2;
-                ClearSegments(segments, temp1, temp2);
+                getLogExt().appendText("Reconnection procedure apply");
+
+                // use filter
+                Image temp_img;
+                temp_img.copy(_img);
+                prefilter_basic::prefilterBasicFullsize(vars, temp_img);
+
+                SegmentDeque temp;
+                segmentate(vars, temp_img, temp);
 
-                segments = temp;
+                if (temp.size() > 0)
+                {
+                    SegmentDeque temp1, temp2;
+                    ClearSegments(segments, temp1, temp2);
+
+                    segments = temp;
+                }
             }
+
+            if (RecognitionStatistics* statistics = getThreadStatistics())
+                statistics->segments = (int)segments.size();
         }
 
         if (vars.checkTimeLimit())
@@ -392,6 +458,7 @@ restart :
 
         WedgeBondExtractor wbe(segments, _img);
         {
+            StageTimer timer(RecognitionStatistics::stWedgeExtraction);
             int sdb_count = wbe.singleDownFetch(vars, mol);
             getLogExt().append("Single-down bonds found", sdb_count);
         }
@@ -399,9 +466,11 @@ restart :
         if (vars.checkTimeLimit())
             throw ImagoException("Timelimit exceeded");
 
-        Separator sep(segments, _img);
-
-        sep.Separate(vars, _cr, layer_symbols, layer_graphics);
+        {
+            StageTimer timer(RecognitionStatistics::stSeparation);
+            Separator sep(segments, _img);
+            sep.Separate(vars, _cr, layer_symbols, layer_graphics);
+        }
 
         if (vars.checkTimeLimit())
             throw ImagoException("Timelimit exceeded");
@@ -409,16 +478,20 @@ restart :
         getLogExt().append("Symbols", layer_symbols.size());
         getLogExt().append("Graphics", layer_graphics.size());
 
-        if (vars.general.ImageAlreadyBinarized && !captions_removed)
+        if (vars.general.ImageAlreadyBinarized)
         {
-            if (removeMoleculeCaptions(vars, _img, layer_symbols, layer_graphics))
+            StageTimer timer(RecognitionStatistics::stCaptionRemoval);
+            std::vector<Rectangle> cleared;
+            if (removeMoleculeCaptions(vars, _img, layer_symbols, layer_graphics, cleared))
             {
-                captions_removed = true;
-                getLogExt().appendText("Restart after molecule captions cleanup");
-                ClearSegments(segments, layer_symbols, layer_graphics);
-                // looks like performance degrade, but actually gives more accurate result (due to capital height re-estimation) at a almost zero-cost in terms
-                // of cpu time
-                goto restart;
+                getLogExt().appendText("Drop segments of molecule captions");
+                dropClearedSegments(cleared, segments, layer_symbols, layer_graphics);
+                if (RecognitionStatistics* statistics = getThreadStatistics())
+                    statistics->captions += (int)cleared.size();
+
+                // capital height is re-estimated without the captions, the rest of segmentation stays
+                Separator sep(segments, _img);
+                sep.ReestimateCapHeight(vars, _cr, layer_symbols);
             }
         }
 
@@ -432,6 +505,12 @@ restart :
             layer_symbols.clear();
         }
 
+        if (RecognitionStatistics* statistics = getThreadStatistics())
+        {
+            statistics->symbols = (int)layer_symbols.size();
+            statistics->graphics = (int)layer_graphics.size();
+        }
+
         if (getLogExt().loggingEnabled())
         {
             Image symbols, graphics;
@@ -458,11 +537,13 @@ restart :
         if (vars.general.ExtractCharactersOnly)
         {
             storeSegments(vars, layer_symbols, layer_graphics);
+            ClearSegments(segments, layer_symbols, layer_graphics);
             return;
         }
 
         if (!layer_symbols.empty())
         {
+            StageTimer timer(RecognitionStatistics::stLabelCombining);
             LabelCombiner lc(vars, layer_symbols, layer_graphics, _cr);
 
             if (vars.dynamic.CapitalHeight > 0.0)
@@ -497,6 +578,7 @@ restart :
             throw ImagoException("Timelimit exceeded");
 
         {
+            StageTimer timer(RecognitionStatistics::stVectorization);
             BaseApproximator* approximator = NULL;
 
             if (vars.csr.UseDPApproximator)
@@ -514,21 +596,28 @@ restart :
         if (vars.checkTimeLimit())
             throw ImagoException("Timelimit exceeded");
 
-        wbe.singleUpFetch(vars, mol);
-
-        while (mol._dissolveShortEdges(vars.csr.Dissolve, true))
         {
-            if (vars.checkTimeLimit())
-                throw ImagoException("Timelimit exceeded");
+            StageTimer timer(RecognitionStatistics::stWedgeExtraction);
+            wbe.singleUpFetch(vars, mol);
         }
 
-        mol.deleteBadTriangles(vars.csr.DeleteBadTriangles);
+        {
+            StageTimer timer(RecognitionStatistics::stSkeletonModification);
+            while (mol._dissolveShortEdges(vars.csr.Dissolve, true))
+            {
+                if (vars.checkTimeLimit())
+                    throw ImagoException("Timelimit exceeded");
+            }
+
+            mol.deleteBadTriangles(vars.csr.DeleteBadTriangles);
+        }
 
         if (vars.checkTimeLimit())
             throw ImagoException("Timelimit exceeded");
 
         if (!layer_symbols.empty())
         {
+            StageTimer timer(RecognitionStatistics::stLabelMapping);
             LabelLogic ll(_cr);
             std::deque<Label> unmapped_labels;
 
@@ -580,7 +669,6 @@ restart :
         throw;
     }
 }
-}
 
 void ChemicalStructureRecognizer::image2mol(Settings& vars, Image& img, Molecule& mol)
 {
@@ -599,9 +687,10 @@ void ChemicalStructureRecognizer::extractCharacters(Settings& vars, Image& img)
     recognize(vars, temp);
 }
 
-void ChemicalStructureRecognizer::setImage(Image& img)
+void ChemicalStructureRecognizer::setImage(const Image& img)
 {
-    _origImage.copy(img);
+    // crop() makes a new image, only the captions removal writes the pixels and it detaches them
+    _origImage.share(img);
 }
 
 ChemicalStructureRecognizer::~ChemicalStructureRecognizer()
@@ -18,8 +18,11 @@
 
 #pragma once
 
+#include <vector>
+
 #include "character_recognizer.h"
 #include "image.h"
+#include "rectangle.h"
 #include "settings.h"
 #include "stl_fwd.h"
 
@@ -34,7 +37,7 @@ namespace imago
     public:
         ChemicalStructureRecognizer();
 
-        void setImage(Image& img);
+        void setImage(const Image& img);
         void recognize(Settings& vars, Molecule& mol);
         void image2mol(Settings& vars, Image& img, Molecule& mol);
         void extractCharacters(Settings& vars, Image& img);
@@ -49,7 +52,9 @@ namespace imago
         CharacterRecognizer _cr;
         Image _origImage;
 
-        bool removeMoleculeCaptions(const Settings& vars, Image& img, SegmentDeque& layer_symbols, SegmentDeque& layer_graphics);
+        bool removeMoleculeCaptions(const Settings& vars, Image& img, SegmentDeque& layer_symbols, SegmentDeque& layer_graphics,
+                                    std::vector<Rectangle>& cleared);
+        void dropClearedSegments(const std::vector<Rectangle>& cleared, SegmentDeque& segments, SegmentDeque& layer_symbols, SegmentDeque& layer_graphics);
         void segmentate(const Settings& vars, Image& img, SegmentDeque& segments, bool connect_mode = false);
         void storeSegments(const Settings& vars, SegmentDeque& layer_symbols, SegmentDeque& layer_graphics);
         bool isReconnectSegmentsRequired(const Settings& vars, const Image& img, const SegmentDeque& segments);
@@ -0,0 +1,288 @@
+/****************************************************************************
+ * Copyright (C) from 2009 to Present EPAM Systems.
+ *
+ * This file is part of Imago toolkit.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ ***************************************************************************/
+
+#include "filter_race.h"
+
+#include <algorithm>
+#include <condition_variable>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include <indigo.h>
+
+#include "cancellation.h"
+#include "chemical_structure_recognizer.h"
+#include "filters_list.h"
+#include "log_ext.h"
+#include "prefilter_entry.h"
+#include "superatom_expansion.h"
+
+namespace imago
+{
+    int getRecognitionWarnings(const Settings& vars, const Molecule& mol)
+    {
+        int warnings = mol.getWarningsCount() + mol.getDissolvingsCount() / vars.main.DissolvingsFactor;
+
+        if (vars.dynamic.CapitalHeight < vars.main.MinGoodCharactersSize && !vars.general.ImageAlreadyBinarized)
+            warnings += vars.main.WarningsForTooSmallCharacters;
+
+        return warnings;
+    }
+
+    namespace
+    {
+        struct FilterAttempt
+        {
+            Settings vars;
+            CancellationToken cancellation; // child of the caller one
+            Image image;
+            RecognitionStatistics statistics;
+            std::string molfile;
+            std::string error;
+            int warnings;
+            bool recognized;
+
+            explicit FilterAttempt(const CancellationToken* parent) : cancellation(parent), warnings(0), recognized(false)
+            {
+            }
+
+            bool good() const
+            {
+                return recognized && warnings <= vars.main.WarningsRecalcTreshold;
+            }
+        };
+
+
+        // outcomes of the filters shared by the attempts: trying the filters one by one keeps the settings
+        // updated by every succeeded filter for the following ones, e.g. general.ImageAlreadyBinarized
+        class FilterOutcomes
+        {
+        public:
+            explicit FilterOutcomes(int count) : _known(count, false), _succeeded(count, false)
+            {
+            }
+
+            void report(int filterIndex, bool succeeded)
+            {
+                std::lock_guard<std::mutex> lock(_mutex);
+                _known[filterIndex] = true;
+                _succeeded[filterIndex] = succeeded;
+                _reported.notify_all();
+            }
+
+            // waits for the filters before filterIndex and applies the updates of the succeeded ones,
+            // then the own update once more, so it stays the last one as in the sequence
+            void inherit(Settings& vars, int filterIndex)
+            {
+                std::vector<bool> succeeded;
+                {
+                    std::unique_lock<std::mutex> lock(_mutex);
+                    _reported.wait(lock, [&]() { return std::find(_known.begin(), _known.begin() + filterIndex, false) == _known.begin() + filterIndex; });
+                    succeeded.assign(_succeeded.begin(), _succeeded.begin() + filterIndex);
+                }
+
+                FilterEntries filters = getFiltersList();
+                bool inherited = false;
+                for (int u = 0; u < filterIndex; u++)
+                {
+                    if (succeeded[u] && !filters[u].update_config_string.empty())
+                    {
+                        vars.fillFromDataStream(filters[u].update_config_string);
+                        inherited = true;
+                    }
+                }
+
+                if (inherited && !filters[filterIndex].update_config_string.empty())
+                    vars.fillFromDataStream(filters[filterIndex].update_config_string);
+            }
+
+        private:
+            std::vector<bool> _known;
+            std::vector<bool> _succeeded;
+            std::mutex _mutex;
+            std::condition_variable _reported;
+        };
+    }
+
+    static void runAttempt(FilterAttempt& attempt, int filterIndex, const Image& src, const FilterRaceConfigure& configure, FilterOutcomes& outcomes)
+    {
+        // superatoms expansion requires own indigo session per thread
+        qword sid = indigoAllocSessionId();
+        indigoSetSessionId(sid);
+
+        StatisticsScope scope(attempt.statistics);
+        bool reported = false;
+
+        try
+        {
+            bool filtered = applyPrefilter(attempt.vars, attempt.image, src, filterIndex);
+            outcomes.report(filterIndex, filtered);
+            reported = true;
+
+            if (filtered)
+            {
+                outcomes.inherit(attempt.vars, filterIndex);
+
+                if (configure)
+                    configure(attempt.vars);
+
+                ChemicalStructureRecognizer csr;
+                Molecule mol;
+                csr.image2mol(attempt.vars, attempt.image, mol);
+
+                attempt.warnings = getRecognitionWarnings(attempt.vars, mol);
+                attempt.molfile = expandSuperatoms(attempt.vars, mol);
+                attempt.recognized = true;
+            }
+        }
+        catch (std::exception& e)
+        {
+            attempt.error = e.what();
+        }
+
+        // a filter interrupted by the time limit or cancellation has not succeeded
+        if (!reported)
+            outcomes.report(filterIndex, false);
+
+        indigoReleaseSessionId(sid);
+    }
+
+    // the same choice as the sequential iteration of filters
+    static bool selectAttempt(std::vector<std::unique_ptr<FilterAttempt> >& attempts, const Settings& vars, FilterRaceResult& result)
+    {
+        int selected = -1;
+        for (size_t u = 0; u < attempts.size(); u++)
+        {
+            const FilterAttempt& attempt = *attempts[u];
+
+            if (!attempt.recognized)
+            {
+                if (!attempt.error.empty())
+                    result.error = attempt.error;
+                continue;
+            }
+
+            if (selected < 0 || attempt.warnings < attempts[selected]->warnings)
+                selected = (int)u;
+
+            if (attempt.good())
+                break;
+        }
+
+        getLogExt().append("Selected filter", selected);
+
+        result.filterIndex = selected;
+        if (selected < 0)
+        {
+            if (result.error.empty())
+                result.error = "No suitable filter found for the image";
+            return false;
+        }
+
+        FilterAttempt& winner = *attempts[selected];
+        result.warnings = winner.warnings;
+        result.molfile.swap(winner.molfile);
+        result.image.copy(winner.image);
+        result.vars = winner.vars;
+        result.vars.general.PCancellation = vars.general.PCancellation;
+        result.statistics = winner.statistics;
+        result.error.clear();
+
+        return true;
+    }
+
+    bool recognizeFilterRace(const Settings& vars, const Image& src, FilterRaceResult& result, const FilterRaceConfigure& configure)
+    {
+        logEnterFunction();
+
+        int count = (int)getFiltersList().size();
+
+        std::vector<std::unique_ptr<FilterAttempt> > attempts;
+        for (int u = 0; u < count; u++)
+        {
+            attempts.push_back(std::unique_ptr<FilterAttempt>(new FilterAttempt(vars.general.PCancellation)));
+            attempts[u]->vars = vars;
+            attempts[u]->vars.general.PCancellation = &attempts[u]->cancellation;
+            attempts[u]->vars.restartTimeLimit();
+        }
+
+        // the attempts write to the caller log, which is not shared between threads:
+        // a logged race runs them one after another, still each on its own thread
+        log_ext* log = &getLogExt();
+        bool logged = log->loggingEnabled();
+
+        FilterOutcomes outcomes(count);
+        std::vector<std::thread> workers;
+        for (int u = 0; u < count; u++)
+        {
+            workers.push_back(std::thread([&, u]() {
+                setThreadLogExt(log);
+                runAttempt(*attempts[u], u, src, configure, outcomes);
+
+                // filters after the good one can not be selected anymore
+                if (attempts[u]->good())
+                {
+                    for (int v = u + 1; v < count; v++)
+                        attempts[v]->cancellation.cancel();
+                }
+                setThreadLogExt(NULL);
+            }));
+
+            if (logged)
+            {
+                workers.back().join();
+                if (attempts[u]->good())
+                    break;
+            }
+        }
+
+        for (size_t u = 0; u < workers.size(); u++)
+        {
+            if (workers[u].joinable())
+                workers[u].join();
+        }
+
+        return selectAttempt(attempts, vars, result);
+    }
+
+    bool recognizeFilterSequence(const Settings& vars, const Image& src, FilterRaceResult& result, const FilterRaceConfigure& configure)
+    {
+        logEnterFunction();
+
+        int count = (int)getFiltersList().size();
+
+        FilterOutcomes outcomes(count);
+        std::vector<std::unique_ptr<FilterAttempt> > attempts;
+        for (int u = 0; u < count; u++)
+        {
+            attempts.push_back(std::unique_ptr<FilterAttempt>(new FilterAttempt(vars.general.PCancellation)));
+            attempts[u]->vars = vars;
+            attempts[u]->vars.general.PCancellation = &attempts[u]->cancellation;
+            attempts[u]->vars.restartTimeLimit();
+
+            runAttempt(*attempts[u], u, src, configure, outcomes);
+
+            if (attempts[u]->good() || (vars.general.PCancellation && vars.general.PCancellation->isCancelled()))
+                break;
+        }
+
+        return selectAttempt(attempts, vars, result);
+    }
+}
@@ -0,0 +1,73 @@
+/****************************************************************************
+ * Copyright (C) from 2009 to Present EPAM Systems.
+ *
+ * This file is part of Imago toolkit.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ ***************************************************************************/
+
+/**
+ * @file filter_race.h
+ *
+ * @brief   Declares the speculative recognition with all the prefilters at once
+ */
+
+#pragma once
+
+#include <functional>
+#include <string>
+
+#include "image.h"
+#include "molecule.h"
+#include "recognition_statistics.h"
+#include "settings.h"
+
+namespace imago
+{
+    struct FilterRaceResult
+    {
+        int filterIndex; // -1 if no filter produced a molecule
+        int warnings;
+        std::string molfile; // with expanded superatoms
+        Image image;         // prefiltered by the selected filter
+        Settings vars;       // as updated by the selected filter and recognition
+        RecognitionStatistics statistics;
+        std::string error; // of the last failed attempt if nothing was recognized
+
+        FilterRaceResult() : filterIndex(-1), warnings(0)
+        {
+        }
+    };
+
+    // called in the worker thread after the filter, before the recognition
+    typedef std::function<void(Settings&)> FilterRaceConfigure;
+
+    // warnings of the recognized molecule used to compare the prefilters
+    int getRecognitionWarnings(const Settings& vars, const Molecule& mol);
+
+    // runs every filter of getFiltersList() followed by the recognition on its own thread.
+    // selects the same result as trying the filters one by one: the first one in the list
+    // with warnings not above WarningsRecalcTreshold, otherwise the one with least warnings.
+    // as in that iteration, a recognition gets the settings updated by the succeeded filters before its own,
+    // so it waits for them to finish filtering. once a filter is good enough the ones after it are cancelled.
+    // the attempts log to the caller log, so with logging enabled they run one after another.
+    // returns false if nothing was recognized
+    bool recognizeFilterRace(const Settings& vars, const Image& src, FilterRaceResult& result,
+                             const FilterRaceConfigure& configure = FilterRaceConfigure());
+
+    // the same selection trying the filters one by one on the calling thread,
+    // for callers that already run several recognitions at once. every attempt allocates and releases
+    // own indigo session, so it has to be called on a worker thread, not on the one of an API session
+    bool recognizeFilterSequence(const Settings& vars, const Image& src, FilterRaceResult& result,
+                                 const FilterRaceConfigure& configure = FilterRaceConfigure());
+}
@@ -0,0 +1,285 @@
+/****************************************************************************
+ * Copyright (C) from 2009 to Present EPAM Systems.
+ *
+ * This file is part of Imago toolkit.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ ***************************************************************************/
+
+#include "glyph_cache.h"
+
+#include <cstdio>
+#include <cstring>
+
+#include "character_recognizer.h"
+#include "exception.h"
+
+namespace imago
+{
+    static const qword GLYPH_CACHE_MAGIC = 0x3143474f47414d49ULL; // "IMAGOGC1"
+
+    static inline qword mix(qword h)
+    {
+        h ^= h >> 33;
+        h *= 0xff51afd7ed558ccdULL;
+        h ^= h >> 33;
+        h *= 0xc4ceb9fe1a85ec53ULL;
+        h ^= h >> 33;
+        return h;
+    }
+
+    qword strongHash(const void* data, size_t size, qword seed)
+    {
+        const unsigned char* bytes = (const unsigned char*)data;
+        qword h = mix(seed ^ (size * 0x9e3779b97f4a7c15ULL));
+        size_t u = 0;
+        for (; u + sizeof(qword) <= size; u += sizeof(qword))
+        {
+            qword word;
+            memcpy(&word, bytes + u, sizeof(qword));
+            h = mix(h ^ word) * 0x9e3779b97f4a7c15ULL;
+        }
+        qword tail = 0;
+        for (size_t shift = 0; u < size; u++, shift += 8)
+            tail |= (qword)bytes[u] << shift;
+        return mix(h ^ tail);
+    }
+
+    qword GlyphKey::hash() const
+    {
+        qword h = strongHash(bits, sizeof(bits), context);
+        return strongHash(&ratio, sizeof(ratio), h);
+    }
+
+    bool GlyphKey::operator==(const GlyphKey& other) const
+    {
+        return context == other.context && ratio == other.ratio && memcmp(bits, other.bits, sizeof(bits)) == 0;
+    }
+
+    GlyphCache& GlyphCache::getInstance()
+    {
+        static GlyphCache instance;
+        return instance;
+    }
+
+    GlyphCache::GlyphCache() : _capacity(DEFAULT_CAPACITY), _hits(0), _misses(0), _evictions(0)
+    {
+    }
+
+    GlyphCache::Shard& GlyphCache::_getShard(qword hash)
+    {
+        // low bits are used by the hash tables inside shards
+        return _shards[(hash >> 59) % SHARDS_COUNT];
+    }
+
+    size_t GlyphCache::_shardCapacity() const
+    {
+        size_t capacity = _capacity;
+        return (capacity + SHARDS_COUNT - 1) / SHARDS_COUNT;
+    }
+
+    void GlyphCache::setCapacity(size_t entries)
+    {
+        _capacity = entries;
+        size_t limit = _shardCapacity();
+        for (int u = 0; u < SHARDS_COUNT; u++)
+        {
+            std::lock_guard<std::mutex> lock(_shards[u].mutex);
+            _trim(_shards[u], limit);
+        }
+    }
+
+    size_t GlyphCache::getCapacity() const
+    {
+        return _capacity;
+    }
+
+    bool GlyphCache::find(const GlyphKey& key, RecognitionDistance& result)
+    {
+        if (_capacity == 0)
+            return false;
+
+        Shard& shard = _getShard(key.hash());
+        std::lock_guard<std::mutex> lock(shard.mutex);
+
+        auto it = shard.index.find(key);
+        if (it == shard.index.end())
+        {
+            _misses++;
+            return false;
+        }
+
+        shard.lru.splice(shard.lru.begin(), shard.lru, it->second);
+        result.clear();
+        result.insert(it->second->value.begin(), it->second->value.end());
+        _hits++;
+        return true;
+    }
+
+    void GlyphCache::insert(const GlyphKey& key, const RecognitionDistance& result)
+    {
+        if (_capacity == 0)
+            return;
+
+        Distances value(result.begin(), result.end());
+        Shard& shard = _getShard(key.hash());
+        std::lock_guard<std::mutex> lock(shard.mutex);
+        _insert(shard, key, value);
+    }
+
+    void GlyphCache::_insert(Shard& shard, const GlyphKey& key, const Distances& value)
+    {
+        auto it = shard.index.find(key);
+        if (it != shard.index.end())
+        {
+            it->second->value = value;
+            shard.lru.splice(shard.lru.begin(), shard.lru, it->second);
+            return;
+        }
+
+        Entry entry;
+        entry.key = key;
+        entry.value = value;
+        shard.lru.push_front(entry);
+        shard.index[key] = shard.lru.begin();
+        _trim(shard, _shardCapacity());
+    }
+
+    void GlyphCache::_trim(Shard& shard, size_t limit)
+    {
+        while (shard.lru.size() > limit)
+        {
+            shard.index.erase(shard.lru.back().key);
+            shard.lru.pop_back();
+            _evictions++;
+        }
+    }
+
+    void GlyphCache::clear()
+    {
+        for (int u = 0; u < SHARDS_COUNT; u++)
+        {
+            std::lock_guard<std::mutex> lock(_shards[u].mutex);
+            _shards[u].index.clear();
+            _shards[u].lru.clear();
+        }
+    }
+
+    GlyphCacheStatistics GlyphCache::getStatistics() const
+    {
+        GlyphCacheStatistics result;
+        result.hits = _hits;
+        result.misses = _misses;
+        result.evictions = _evictions;
+        result.entries = 0;
+        for (int u = 0; u < SHARDS_COUNT; u++)
+        {
+            std::lock_guard<std::mutex> lock(_shards[u].mutex);
+            result.entries += _shards[u].lru.size();
+        }
+        return result;
+    }
+
+    qword GlyphCache::_getFontFingerprint()
+    {
+        using namespace CharacterRecognizerImp;
+        const PackedTemplates& templates = getBuiltinTemplates();
+        qword h = strongHash(templates.penalty_ink, (size_t)templates.count * INTERNAL_ARRAY_SIZE);
+        h = strongHash(templates.penalty_white, (size_t)templates.count * INTERNAL_ARRAY_SIZE, h);
+        h = strongHash(templates.wh_ratio, templates.count * sizeof(double), h);
+        return strongHash(templates.text, templates.count, h);
+    }
+
+    void GlyphCache::save(const std::string& path)
+    {
+        FILE* f = fopen(path.c_str(), "wb");
+        if (f == NULL)
+            throw IOException("Can not open glyph cache file for writing: " + path);
+
+        std::vector<Entry> entries;
+        for (int u = 0; u < SHARDS_COUNT; u++)
+        {
+            std::lock_guard<std::mutex> lock(_shards[u].mutex);
+            // least recently used go first, so load restores the order
+            for (Entries::reverse_iterator it = _shards[u].lru.rbegin(); it != _shards[u].lru.rend(); ++it)
+                entries.push_back(*it);
+        }
+
+        qword header[3] = {GLYPH_CACHE_MAGIC, _getFontFingerprint(), (qword)entries.size()};
+        bool ok = fwrite(header, sizeof(header), 1, f) == 1;
+
+        for (size_t u = 0; ok && u < entries.size(); u++)
+        {
+            const Entry& e = entries[u];
+            unsigned int count = (unsigned int)e.value.size();
+            ok = fwrite(e.key.bits, sizeof(e.key.bits), 1, f) == 1 && fwrite(&e.key.ratio, sizeof(e.key.ratio), 1, f) == 1 &&
+                 fwrite(&e.key.context, sizeof(e.key.context), 1, f) == 1 && fwrite(&count, sizeof(count), 1, f) == 1;
+            for (unsigned int v = 0; ok && v < count; v++)
+            {
+                ok = fwrite(&e.value[v].first, sizeof(char), 1, f) == 1 && fwrite(&e.value[v].second, sizeof(double), 1, f) == 1;
+            }
+        }
+
+        if (fclose(f) != 0 || !ok)
+            throw IOException("Failed to write glyph cache file: " + path);
+    }
+
+    void GlyphCache::load(const std::string& path)
+    {
+        FILE* f = fopen(path.c_str(), "rb");
+        if (f == NULL)
+            throw IOException("Can not open glyph cache file: " + path);
+
+        qword header[3];
+        if (fread(header, sizeof(header), 1, f) != 1 || header[0] != GLYPH_CACHE_MAGIC)
+        {
+            fclose(f);
+            throw IOException("Not a glyph cache file: " + path);
+        }
+
+        if (header[1] != _getFontFingerprint())
+        {
+            fclose(f);
+            throw IOException("Glyph cache file is stored for other font templates: " + path);
+        }
+
+        std::vector<Entry> entries;
+        bool ok = true;
+        for (qword u = 0; ok && u < header[2]; u++)
+        {
+            Entry e;
+            unsigned int count = 0;
+            ok = fread(e.key.bits, sizeof(e.key.bits), 1, f) == 1 && fread(&e.key.ratio, sizeof(e.key.ratio), 1, f) == 1 &&
+                 fread(&e.key.context, sizeof(e.key.context), 1, f) == 1 && fread(&count, sizeof(count), 1, f) == 1 && count <= 256;
+            for (unsigned int v = 0; ok && v < count; v++)
+            {
+                std::pair<char, double> item;
+                ok = fread(&item.first, sizeof(char), 1, f) == 1 && fread(&item.second, sizeof(double), 1, f) == 1;
+                e.value.push_back(item);
+            }
+            if (ok)
+                entries.push_back(e);
+        }
+        fclose(f);
+
+        if (!ok)
+            throw IOException("Glyph cache file is corrupted: " + path);
+
+        for (size_t u = 0; u < entries.size(); u++)
+        {
+            Shard& shard = _getShard(entries[u].key.hash());
+            std::lock_guard<std::mutex> lock(shard.mutex);
+            _insert(shard, entries[u].key, entries[u].value);
+        }
+    }
+}
@@ -0,0 +1,122 @@
+/****************************************************************************
+ * Copyright (C) from 2009 to Present EPAM Systems.
+ *
+ * This file is part of Imago toolkit.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ ***************************************************************************/
+
+#pragma once
+
+#include <atomic>
+#include <list>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "comdef.h"
+#include "recognition_distance.h"
+
+namespace imago
+{
+    // 64-bit hash with good avalanche, not a cryptographic one
+    qword strongHash(const void* data, size_t size, qword seed = 0);
+
+    // exact key of a character recognition: prepared glyph bits and everything else the result depends on
+    struct GlyphKey
+    {
+        static const int BITS_WORDS = 15; // 30x30 prepared image, one bit per pixel
+
+        qword bits[BITS_WORDS];
+        double ratio;  // width to height ratio of the source glyph
+        qword context; // hash of candidates and recognition settings
+
+        qword hash() const;
+        bool operator==(const GlyphKey& other) const;
+    };
+
+    struct GlyphCacheStatistics
+    {
+        qword hits;
+        qword misses;
+        qword evictions;
+        qword entries;
+    };
+
+    // process-wide cache of character recognition results, shared by all sessions and threads.
+    // entries are spread over independently locked shards, each one evicts the least recently used
+    class GlyphCache
+    {
+    public:
+        static GlyphCache& getInstance();
+
+        // total count of cached glyphs, 0 disables caching
+        void setCapacity(size_t entries);
+        size_t getCapacity() const;
+
+        bool find(const GlyphKey& key, RecognitionDistance& result);
+        void insert(const GlyphKey& key, const RecognitionDistance& result);
+        void clear();
+
+        GlyphCacheStatistics getStatistics() const;
+
+        // binary dump, file stored for other font templates is rejected on load; throw IOException
+        void save(const std::string& path);
+        void load(const std::string& path);
+
+    private:
+        typedef std::vector<std::pair<char, double> > Distances;
+
+        struct Entry
+        {
+            GlyphKey key;
+            Distances value;
+        };
+
+        struct KeyHash
+        {
+            size_t operator()(const GlyphKey& key) const
+            {
+                return (size_t)key.hash();
+            }
+        };
+
+        typedef std::list<Entry> Entries;
+
+        struct Shard
+        {
+            mutable std::mutex mutex;
+            Entries lru; // most recently used first
+            std::unordered_map<GlyphKey, Entries::iterator, KeyHash> index;
+        };
+
+        static const int SHARDS_COUNT = 16;
+        static const size_t DEFAULT_CAPACITY = 16384;
+
+        Shard _shards[SHARDS_COUNT];
+        std::atomic<size_t> _capacity;
+        std::atomic<qword> _hits;
+        std::atomic<qword> _misses;
+        std::atomic<qword> _evictions;
+
+        Shard& _getShard(qword hash);
+        size_t _shardCapacity() const;
+        void _insert(Shard& shard, const GlyphKey& key, const Distances& value); // shard should be locked
+        void _trim(Shard& shard, size_t limit);                                 // shard should be locked
+        static qword _getFontFingerprint();
+
+        GlyphCache();
+        GlyphCache(const GlyphCache&);
+    };
+}
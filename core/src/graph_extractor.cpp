@@ -24,6 +24,7 @@
 #include "image_draw_utils.h"
 #include "image_utils.h"
 #include "log_ext.h"
+#include "recognition_statistics.h"
 #include "segment.h"
 #include "skeleton.h"
 
@@ -97,7 +98,10 @@ void GraphExtractor::extract(Settings& vars, const GraphicsDetector& gd, const I
 
         getLogExt().appendSkeleton(vars, "Source skeleton", (Skeleton::SkeletonGraph)graph);
 
-        graph.modifyGraph(vars);
+        {
+            StageTimer timer(RecognitionStatistics::stSkeletonModification);
+            graph.modifyGraph(vars);
+        }
 
         getLogExt().appendSkeleton(vars, "Modified skeleton", (Skeleton::SkeletonGraph)graph);
     }
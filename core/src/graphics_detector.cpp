@@ -230,7 +230,7 @@ void GraphicsDetector::extractRingsCenters(const Settings& vars, SegmentDeque& s
             Segment tmp;
 
             tmp.copy(**it);
-            ThinFilter2(tmp).apply();
+            ThinFilter2(vars, tmp).apply();
 
             getLogExt().appendSegment("Ring?", tmp);
 
@@ -331,7 +331,7 @@ void GraphicsDetector::detect(const Settings& vars, const Image& img, Points2d&
     Image tmp;
     tmp.copy(img);
 
-    ThinFilter2 tf2(tmp);
+    ThinFilter2 tf2(vars, tmp);
     tf2.apply();
 
     if (vars.csr.StableDecorner)
@@ -68,9 +68,7 @@ namespace imago
 
         inline void fillWhite()
         {
-            for (int y = 0; y < rows; y++)
-                for (int x = 0; x < cols; x++)
-                    getByte(x, y) = 255;
+            setTo(cv::Scalar(255));
         }
 
         inline const int& getWidth() const
@@ -98,11 +96,34 @@ namespace imago
             return getByte(x, y) != 255;
         }
 
-        inline void copy(const Image& other)
+        // pixels shared by several images are copied on write: copy() and detach() never write into them
+        inline void copy(const cv::Mat1b& other)
         {
+            if (&other == this)
+                return;
+            if (!ownsPixels())
+                release();
             other.copyTo(*this);
         }
 
+        // refers to the pixels of other without copying them
+        inline void share(const cv::Mat1b& other)
+        {
+            cv::Mat1b::operator=(other);
+        }
+
+        // the pixels are copied if another image refers to them or they are borrowed from the outside
+        inline void detach()
+        {
+            if (data != NULL && !ownsPixels())
+                cv::Mat1b::operator=(clone());
+        }
+
+        inline bool ownsPixels() const
+        {
+            return u != NULL && u->refcount == 1;
+        }
+
         inline void emptyCopy(const Image& other)
         {
             *this = Image(other.cols, other.rows);
@@ -111,9 +132,8 @@ namespace imago
 
         inline void invertColor()
         {
-            for (int y = 0; y < getHeight(); y++)
-                for (int x = 0; x < getWidth(); x++)
-                    getByte(x, y) = 255 - getByte(x, y);
+            // 255 - value is the bitwise not of the byte
+            cv::bitwise_not(*this, *this);
         }
 
         void crop(int left = -1, int top = -1, int right = -1, int bottom = -1, int* shift_x = NULL, int* shift_y = NULL);
@@ -139,11 +159,7 @@ namespace imago
 
         inline double density() const
         {
-            int density = 0;
-            for (int y = 0; y < rows; y++)
-                for (int x = 0; x < cols; x++)
-                    if (getByte(x, y) == 0)
-                        density++;
+            int density = cols * rows - cv::countNonZero(*this);
             return (double)density / (cols * rows);
         }
 
@@ -21,6 +21,7 @@
 #include <algorithm>
 #include <cmath>
 #include <cstdarg>
+#include <cstring>
 #include <string>
 
 #include <opencv2/opencv.hpp>
@@ -30,6 +31,7 @@
 #include "image_draw_utils.h"
 #include "log_ext.h"
 #include "output.h"
+#include "platform_tools.h"
 #include "scanner.h"
 #include "segment.h"
 #include "stat_utils.h"
@@ -46,16 +48,18 @@ namespace imago
 
         getLogExt().appendSegment("segment", img);
 
-        Image tmp;
+        Image thin, tmp;
 
-        tmp.copy(img);
-        ThinFilter2(tmp).apply();
+        // both diagonals are tested on the same thinned image
+        thin.copy(img);
+        ThinFilter2(vars, thin).apply();
+        double thin_density = thin.density();
 
+        tmp.copy(thin);
         thetha = HALF_PI + atan2((double)img.getHeight(), (double)img.getWidth());
         r = 0;
-        density = tmp.density();
         ImageDrawUtils::putLine(tmp, thetha, r, eps, 255);
-        density = tmp.density() / density;
+        density = tmp.density() / thin_density;
 
         if (density < vars.utils.SlashLineDensity)
         {
@@ -64,14 +68,11 @@ namespace imago
             return true;
         }
 
-        tmp.copy(img);
-        ThinFilter2(tmp).apply();
-
+        tmp.copy(thin);
         thetha = -thetha;
         r = cos(thetha) * img.getWidth();
-        density = tmp.density();
         ImageDrawUtils::putLine(tmp, thetha, r, eps, 255);
-        density = tmp.density() / density;
+        density = tmp.density() / thin_density;
 
         if (density < vars.utils.SlashLineDensity)
         {
@@ -166,12 +167,112 @@ namespace imago
              img.getByte(i, j) = mat.at<unsigned char>(j, i);*/
     }
 
-    void ImageUtils::loadImageFromBuffer(const std::vector<byte>& buffer, Image& img)
+    // encodings without transparency can be decoded to greyscale by the codec itself
+    static bool isOpaqueEncoding(const byte* data, size_t size)
     {
-        cv::Mat mat = cv::imdecode(cv::Mat(buffer), 0);
+        // jpeg
+        if (size >= 3 && data[0] == 0xFF && data[1] == 0xD8 && data[2] == 0xFF)
+            return true;
+
+        // portable bitmaps P1..P6
+        if (size >= 2 && data[0] == 'P' && data[1] >= '1' && data[1] <= '6')
+            return true;
+
+        static const byte png_signature[] = {0x89, 'P', 'N', 'G', '\r', '\n', 0x1A, '\n'};
+        if (size < 33 || !std::equal(png_signature, png_signature + 8, data) || memcmp(data + 12, "IHDR", 4) != 0)
+            return false;
+
+        // grey and colour ones, alpha comes with the types 4 and 6 or with the tRNS chunk
+        byte color_type = data[25];
+        if (color_type == 4 || color_type == 6)
+            return false;
+
+        for (size_t offset = 8; offset + 8 <= size;)
+        {
+            size_t length = ((size_t)data[offset] << 24) | ((size_t)data[offset + 1] << 16) | ((size_t)data[offset + 2] << 8) | data[offset + 3];
+            const byte* type = data + offset + 4;
+            if (memcmp(type, "tRNS", 4) == 0)
+                return false;
+            if (memcmp(type, "IDAT", 4) == 0)
+                return true;
+            // truncated or corrupted chunk, can not tell
+            if (size - offset < 12 || length > size - offset - 12)
+                break;
+            offset += length + 12;
+        }
+        return false;
+    }
+
+    void ImageUtils::loadImageFromBuffer(const byte* data, size_t size, Image& img)
+    {
+        logEnterFunction();
+
+        img.clear();
+
+        if (data == NULL || size == 0)
+            throw ImagoException("Image data is invalid");
+
+        // the view of the encoded bytes, nothing is copied
+        const cv::Mat buffer(1, (int)size, CV_8U, (void*)data);
+
+        if (isOpaqueEncoding(data, size))
+        {
+            // orientation is ignored as for the unchanged decoding below
+            cv::imdecode(buffer, cv::IMREAD_GRAYSCALE | cv::IMREAD_IGNORE_ORIENTATION, &img);
+            if (img.isInit())
+            {
+                getLogExt().append("Image type", "decoded as GRAY");
+                return;
+            }
+        }
+
+        cv::Mat mat = cv::imdecode(buffer, cv::IMREAD_UNCHANGED);
+
         if (mat.empty())
+        {
+            getLogExt().appendText("CV returned empty mat");
+            if (failsafePngLoadBuffer(data, size, img))
+            {
+                getLogExt().appendText("... but failsafePngLoad helps");
+                return;
+            }
             throw ImagoException("Image data is invalid");
-        copyMatToImage(mat, img);
+        }
+
+        if (mat.type() == CV_8UC4)
+        {
+            getLogExt().append("Image type", "CV_8UC4 / BGRA");
+            for (int row = 0; row < mat.rows; row++)
+                for (int col = 0; col < mat.cols; col++)
+                {
+                    cv::Vec4b& v = mat.at<cv::Vec4b>(row, col);
+                    if (v[3] == 0) // transparent
+                    {
+                        v[0] = v[1] = v[2] = 255; // to white
+                    }
+                }
+            cv::cvtColor(mat, img, cv::COLOR_BGRA2GRAY);
+        }
+        else if (mat.type() == CV_8UC3)
+        {
+            getLogExt().append("Image type", "CV_8UC3 / BGR");
+            cv::cvtColor(mat, img, cv::COLOR_BGR2GRAY);
+        }
+        else if (mat.type() == CV_8UC1)
+        {
+            getLogExt().append("Image type", "CV_8UC1 / GRAY");
+            img.share(mat);
+        }
+        else
+        {
+            getLogExt().appendText("Unknown image type, attempt to reload as grayscale");
+            cv::imdecode(buffer, cv::IMREAD_GRAYSCALE | cv::IMREAD_IGNORE_ORIENTATION, &img);
+        }
+    }
+
+    void ImageUtils::loadImageFromBuffer(const std::vector<byte>& buffer, Image& img)
+    {
+        loadImageFromBuffer(buffer.empty() ? NULL : &buffer[0], buffer.size(), img);
     }
 
     void ImageUtils::loadImageFromFile(Image& img, const char* format, ...)
@@ -193,56 +294,18 @@ namespace imago
         if (fname.length() < 5)
             throw ImagoException("Unknown file format " + fname);
 
-        FILE* f = fopen(fname.c_str(), "r");
-        if (f == 0)
+        // the codec reads the mapped pages, the file is never copied to a buffer
+        platform::MappedFile file(fname);
+        if (!file.isOpen())
             throw FileNotFoundException(fname.c_str());
-        fclose(f);
-
-        cv::Mat mat = cv::imread(fname, -1 /*BGRA*/);
 
-        if (mat.empty())
+        try
         {
-            getLogExt().appendText("CV returned empty mat");
-            if (failsafePngLoadFile(fname, img))
-            {
-                getLogExt().appendText("... but failsafePngLoad helps");
-            }
-            else
-            {
-                throw ImagoException("Image file is invalid");
-            }
+            loadImageFromBuffer(file.data(), file.size(), img);
         }
-        else
+        catch (ImagoException&)
         {
-            if (mat.type() == CV_8UC4)
-            {
-                getLogExt().append("Image type", "CV_8UC4 / BGRA");
-                for (int row = 0; row < mat.rows; row++)
-                    for (int col = 0; col < mat.cols; col++)
-                    {
-                        cv::Vec4b& v = mat.at<cv::Vec4b>(row, col);
-                        if (v[3] == 0) // transparent
-                        {
-                            v[0] = v[1] = v[2] = 255; // to white
-                        }
-                    }
-                cv::cvtColor(mat, mat, cv::COLOR_BGRA2GRAY);
-            }
-            else if (mat.type() == CV_8UC3)
-            {
-                getLogExt().append("Image type", "CV_8UC3 / BGR");
-                cv::cvtColor(mat, mat, cv::COLOR_BGR2GRAY);
-            }
-            else if (mat.type() == CV_8UC1)
-            {
-                getLogExt().append("Image type", "CV_8UC1 / GRAY");
-            }
-            else
-            {
-                getLogExt().appendText("Unknown image type, attempt to reload as grayscale");
-                mat = cv::imread(fname, 0 /*Grayscale*/);
-            }
-            copyMatToImage(mat, img);
+            throw ImagoException("Image file is invalid");
         }
     }
 
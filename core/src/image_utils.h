@@ -41,6 +41,8 @@ namespace imago
         static void loadImageFromFile(Image& img, const char* FileName, ...);
         static void saveImageToFile(const Image& img, const char* FileName, ...);
 
+        // decodes the encoded image (png, jpg, etc) straight into img, transparent pixels become white
+        static void loadImageFromBuffer(const byte* data, size_t size, Image& img);
         static void loadImageFromBuffer(const std::vector<byte>& buffer, Image& img);
         static void saveImageToBuffer(const Image& img, const std::string& format, std::vector<byte>& buffer);
 
@@ -50,5 +52,20 @@ namespace imago
         static bool testSlashLine(const Settings& vars, Segment& img, double* angle, double eps);
         static bool isThinCircle(const Settings& vars, Image& seg, double& radius, bool asChar = false);
         static double estimateLineThickness(Image& bwimg, int grid);
+
+        // whole image kernels walking row pointers, vectorized with SSE2 where available
+
+        // counts pixels equal to 0, equal to 255 and all the other ones
+        static void countBlackWhite(const Image& img, int& black, int& white, int& others);
+
+        // count of pixels below the threshold
+        static int countBelow(const Image& img, int threshold);
+
+        // pixels below the threshold become black, the rest white. within gap pixels from
+        // the image border the threshold is not applied, only black pixels stay black there
+        static void thresholdWithBorder(Image& img, int threshold, int gap);
+
+        // black pixels become white, all the others black
+        static void invertBinary(Image& img);
     };
 }
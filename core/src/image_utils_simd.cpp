@@ -0,0 +1,202 @@
+/****************************************************************************
+ * Copyright (C) from 2009 to Present EPAM Systems.
+ *
+ * This file is part of Imago toolkit.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ ***************************************************************************/
+
+// vectorized whole image kernels of ImageUtils, each walks the rows by pointers so views are supported
+
+#include <algorithm>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define IMAGO_SSE2
+#include <emmintrin.h>
+#endif
+
+#include "image.h"
+#include "image_utils.h"
+
+namespace imago
+{
+#ifdef IMAGO_SSE2
+    // byte lanes counting matches, moved to 64-bit sums before any of them can wrap
+    class ByteCounter
+    {
+    public:
+        ByteCounter() : _bytes(_mm_setzero_si128()), _sums(_mm_setzero_si128()), _pending(0)
+        {
+        }
+
+        // mask has 0xFF in the lanes to count
+        inline void add(__m128i mask)
+        {
+            _bytes = _mm_sub_epi8(_bytes, mask);
+            if (++_pending == 255)
+                flush();
+        }
+
+        qword total()
+        {
+            flush();
+            qword lanes[2];
+            _mm_storeu_si128((__m128i*)lanes, _sums);
+            return lanes[0] + lanes[1];
+        }
+
+    private:
+        __m128i _bytes;
+        __m128i _sums;
+        int _pending;
+
+        inline void flush()
+        {
+            _sums = _mm_add_epi64(_sums, _mm_sad_epu8(_bytes, _mm_setzero_si128()));
+            _bytes = _mm_setzero_si128();
+            _pending = 0;
+        }
+    };
+
+    // 0xFF in the lanes below limit + 1
+    static inline __m128i belowMask(__m128i v, __m128i limit)
+    {
+        return _mm_cmpeq_epi8(_mm_min_epu8(v, limit), v);
+    }
+#endif
+
+    // pixels [from, to) of the row below the threshold 1..255 become black, the rest white
+    static void binarizeRow(byte* row, int from, int to, byte threshold)
+    {
+        int x = from;
+#ifdef IMAGO_SSE2
+        const __m128i limit = _mm_set1_epi8((char)(threshold - 1));
+        const __m128i white = _mm_set1_epi8((char)0xFF);
+        for (; x + 16 <= to; x += 16)
+        {
+            __m128i v = _mm_loadu_si128((const __m128i*)(row + x));
+            _mm_storeu_si128((__m128i*)(row + x), _mm_andnot_si128(belowMask(v, limit), white));
+        }
+#endif
+        for (; x < to; x++)
+            row[x] = row[x] < threshold ? 0 : 255;
+    }
+
+    void ImageUtils::countBlackWhite(const Image& img, int& black, int& white, int& others)
+    {
+        qword b = 0, w = 0;
+#ifdef IMAGO_SSE2
+        ByteCounter black_lanes, white_lanes;
+        const __m128i zero = _mm_setzero_si128();
+        const __m128i full = _mm_set1_epi8((char)0xFF);
+#endif
+        for (int y = 0; y < img.rows; y++)
+        {
+            const byte* row = img.ptr(y);
+            int x = 0;
+#ifdef IMAGO_SSE2
+            for (; x + 16 <= img.cols; x += 16)
+            {
+                __m128i v = _mm_loadu_si128((const __m128i*)(row + x));
+                black_lanes.add(_mm_cmpeq_epi8(v, zero));
+                white_lanes.add(_mm_cmpeq_epi8(v, full));
+            }
+#endif
+            for (; x < img.cols; x++)
+            {
+                b += row[x] == 0;
+                w += row[x] == 255;
+            }
+        }
+#ifdef IMAGO_SSE2
+        b += black_lanes.total();
+        w += white_lanes.total();
+#endif
+        black = (int)b;
+        white = (int)w;
+        others = img.cols * img.rows - black - white;
+    }
+
+    int ImageUtils::countBelow(const Image& img, int threshold)
+    {
+        if (threshold <= 0)
+            return 0;
+        if (threshold > 255)
+            return img.cols * img.rows;
+
+        qword count = 0;
+#ifdef IMAGO_SSE2
+        ByteCounter lanes;
+        const __m128i limit = _mm_set1_epi8((char)(threshold - 1));
+#endif
+        for (int y = 0; y < img.rows; y++)
+        {
+            const byte* row = img.ptr(y);
+            int x = 0;
+#ifdef IMAGO_SSE2
+            for (; x + 16 <= img.cols; x += 16)
+                lanes.add(belowMask(_mm_loadu_si128((const __m128i*)(row + x)), limit));
+#endif
+            for (; x < img.cols; x++)
+                count += row[x] < threshold;
+        }
+#ifdef IMAGO_SSE2
+        count += lanes.total();
+#endif
+        return (int)count;
+    }
+
+    void ImageUtils::thresholdWithBorder(Image& img, int threshold, int gap)
+    {
+        // threshold 1 keeps black pixels only, 255 leaves white ones intact
+        byte inner = (byte)std::min(std::max(threshold, 1), 255);
+
+        // inner pixels satisfy x > gap && x + gap < width, the same for y
+        int x1 = std::max(gap + 1, 0), x2 = std::min(img.cols - gap, img.cols);
+        int y1 = std::max(gap + 1, 0), y2 = std::min(img.rows - gap, img.rows);
+
+        for (int y = 0; y < img.rows; y++)
+        {
+            byte* row = img.ptr(y);
+            if (y < y1 || y >= y2 || x1 >= x2)
+            {
+                binarizeRow(row, 0, img.cols, 1);
+            }
+            else
+            {
+                binarizeRow(row, 0, x1, 1);
+                binarizeRow(row, x1, x2, inner);
+                binarizeRow(row, x2, img.cols, 1);
+            }
+        }
+    }
+
+    void ImageUtils::invertBinary(Image& img)
+    {
+        for (int y = 0; y < img.rows; y++)
+        {
+            byte* row = img.ptr(y);
+            int x = 0;
+#ifdef IMAGO_SSE2
+            const __m128i zero = _mm_setzero_si128();
+            for (; x + 16 <= img.cols; x += 16)
+            {
+                __m128i v = _mm_loadu_si128((const __m128i*)(row + x));
+                _mm_storeu_si128((__m128i*)(row + x), _mm_cmpeq_epi8(v, zero));
+            }
+#endif
+            for (; x < img.cols; x++)
+                row[x] = row[x] == 0 ? 255 : 0;
+        }
+    }
+}
@@ -89,7 +89,10 @@ void LabelCombiner::_locateLabels(const Settings& vars)
     SegmentsGraph seg_graph;
     add_segment_range(_symbols_layer.begin(), _symbols_layer.end(), seg_graph);
 
-    RNGBuilder::build(seg_graph);
+    if (vars.lcomb.DelaunayRNG)
+        RNGBuilder::buildDelaunay(seg_graph);
+    else
+        RNGBuilder::build(seg_graph);
 
     SegmentsGraph::edge_iterator ei, ei_end, next;
     ei = seg_graph.edgeBegin();
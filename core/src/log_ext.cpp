@@ -17,6 +17,9 @@
  ***************************************************************************/
 
 #include "log_ext.h"
+
+#ifndef IMAGO_DISABLE_DEBUG_LOG
+
 #include "output.h"
 #include "pixel_boundings.h"
 #include "platform_tools.h"
@@ -116,31 +119,20 @@ namespace imago
         }
     }
 
-    bool log_ext::loggingEnabled() const
-    {
-        return enabled;
-    }
-
     void log_ext::setLoggingEnabled(bool value)
     {
         enabled = value;
     }
 
-    void log_ext::appendText(const std::string& text)
+    void log_ext::appendTextImpl(const std::string& text)
     {
-        if (!loggingEnabled())
-            return;
-
         LOG_TIME_START;
         dump(getStringPrefix() + "<b>" + filterHtml(text) + "</b>");
         LOG_TIME_END;
     }
 
-    void log_ext::appendImage(const std::string& caption, const Image& img)
+    void log_ext::appendImageImpl(const std::string& caption, const Image& img)
     {
-        if (!loggingEnabled())
-            return;
-
         LOG_TIME_START;
         appendImageInternal(caption, img);
         LOG_TIME_END;
@@ -165,11 +157,8 @@ namespace imago
         appendImageFile(caption, htmlName);
     }
 
-    void log_ext::appendGraph(const Settings& vars, const std::string& name, const segments_graph::SegmentsGraph& g)
+    void log_ext::appendGraphImpl(const Settings& vars, const std::string& name, const segments_graph::SegmentsGraph& g)
     {
-        if (!loggingEnabled())
-            return;
-
         LOG_TIME_START;
         Image output(vars.general.ImageWidth, vars.general.ImageHeight);
         output.fillWhite();
@@ -178,11 +167,8 @@ namespace imago
         LOG_TIME_END;
     }
 
-    void log_ext::appendMat(const std::string& caption, const cv::Mat& mat)
+    void log_ext::appendMatImpl(const std::string& caption, const cv::Mat& mat)
     {
-        if (!loggingEnabled())
-            return;
-
         LOG_TIME_START;
         Image output;
         ImageUtils::copyMatToImage(mat, output);
@@ -190,11 +176,8 @@ namespace imago
         LOG_TIME_END;
     }
 
-    void log_ext::appendSkeleton(const Settings& vars, const std::string& name, const Skeleton::SkeletonGraph& g)
+    void log_ext::appendSkeletonImpl(const Settings& vars, const std::string& name, const Skeleton::SkeletonGraph& g)
     {
-        if (!loggingEnabled())
-            return;
-
         LOG_TIME_START;
         Image output(vars.general.ImageWidth, vars.general.ImageHeight);
         output.fillWhite();
@@ -203,11 +186,8 @@ namespace imago
         LOG_TIME_END;
     }
 
-    void log_ext::appendSegment(const std::string& name, const Segment& seg)
+    void log_ext::appendSegmentImpl(const std::string& name, const Segment& seg)
     {
-        if (!loggingEnabled())
-            return;
-
         LOG_TIME_START;
         Segment shifted;
         shifted.copy(seg);
@@ -220,11 +200,8 @@ namespace imago
         LOG_TIME_END;
     }
 
-    void log_ext::appendPoints(const std::string& name, const Points2i& pts)
+    void log_ext::appendPointsImpl(const std::string& name, const Points2i& pts)
     {
-        if (!loggingEnabled())
-            return;
-
         LOG_TIME_START;
         RectShapedBounding b(pts);
         Image output(b.getBounding().width + 1, b.getBounding().height + 1);
@@ -235,11 +212,8 @@ namespace imago
         LOG_TIME_END;
     }
 
-    void log_ext::appendSegmentWithYLine(const Settings& vars, const std::string& name, const Segment& seg, int line_y)
+    void log_ext::appendSegmentWithYLineImpl(const Settings& vars, const std::string& name, const Segment& seg, int line_y)
     {
-        if (!loggingEnabled())
-            return;
-
         LOG_TIME_START;
         Image output(vars.general.ImageWidth, vars.general.ImageHeight);
         output.fillWhite();
@@ -259,8 +233,10 @@ namespace imago
         fr.name = filterHtml(fr.name);
         fr.anchor = filterHtml(generateAnchor(name));
 
+        // pseudo-random but reproducible background, rand() is not reentrant
+        size_t seed = CallIdent * 2654435761u;
         char color[64];
-        sprintf(color, "#%02x%02x%02x", rand() % 20 + 236, rand() % 20 + 236, rand() % 20 + 236);
+        sprintf(color, "#%02x%02x%02x", (int)(seed % 20) + 236, (int)((seed >> 8) % 20) + 236, (int)((seed >> 16) % 20) + 236);
 
         dump(getStringPrefix(true) + "<div title=\"" + fr.name + "\" style=\"background-color: " + color + ";\" >" +
              "<b><font size=\"+1\">Enter into <a href=\"#" + fr.anchor + "\">" + fr.name + "</a> function</font></b><div style=\"margin-left: 20px;\">");
@@ -396,10 +372,25 @@ namespace imago
 
     ///////////////////////////////////////////////////////
 
-    static log_ext logExtInstance("."); // current folder
+#if (_MSC_VER >= 1800)
+    __declspec(thread) log_ext* boundLogExt = NULL;
+#else
+    thread_local log_ext* boundLogExt = NULL;
+#endif
 
     log_ext& getLogExt()
     {
+        if (boundLogExt != NULL)
+            return *boundLogExt;
+
+        static thread_local log_ext logExtInstance("."); // current folder
         return logExtInstance;
     }
-};
\ No newline at end of file
+
+    void setThreadLogExt(log_ext* log)
+    {
+        boundLogExt = log;
+    }
+};
+
+#endif // IMAGO_DISABLE_DEBUG_LOG
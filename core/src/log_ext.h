@@ -33,16 +33,136 @@
 #include "stl_fwd.h"
 #include "virtual_fs.h"
 
+#ifdef IMAGO_DISABLE_DEBUG_LOG
+#define logEnterFunction imago::log_ext_service::_logEnterFunctionStub
+#else
 #define logEnterFunction                                                                                                                                       \
     imago::log_ext_service::LogEnterFunction _entry(__FUNCTION__, imago::getLogExt());                                                                         \
     _entry._logEnterFunction
+#endif
 
 namespace imago
 {
     class log_ext;
 
+#ifdef IMAGO_DISABLE_DEBUG_LOG
+
+    // debug log is compiled out (IMAGO_ENABLE_DEBUG_LOG=OFF): same interface, every call is an empty inline
+    class log_ext
+    {
+    public:
+        log_ext(const std::string&)
+        {
+        }
+
+        void SetVirtualFS(VirtualFS&)
+        {
+        }
+
+        void SetNoVirtualFS()
+        {
+        }
+
+        bool loggingEnabled() const
+        {
+            return false;
+        }
+
+        void setLoggingEnabled(bool)
+        {
+        }
+
+        template <class... Args>
+        void append(const Args&...)
+        {
+        }
+
+        template <class... Args>
+        void appendVector(const Args&...)
+        {
+        }
+
+        template <class... Args>
+        void appendMap(const Args&...)
+        {
+        }
+
+        template <class... Args>
+        void appendText(const Args&...)
+        {
+        }
+
+        template <class... Args>
+        void appendImage(const Args&...)
+        {
+        }
+
+        template <class... Args>
+        void appendMat(const Args&...)
+        {
+        }
+
+        template <class... Args>
+        void appendSegment(const Args&...)
+        {
+        }
+
+        template <class... Args>
+        void appendPoints(const Args&...)
+        {
+        }
+
+        template <class... Args>
+        void appendImageFile(const Args&...)
+        {
+        }
+
+        template <class... Args>
+        void appendGraph(const Args&...)
+        {
+        }
+
+        template <class... Args>
+        void appendSkeleton(const Args&...)
+        {
+        }
+
+        template <class... Args>
+        void appendSegmentWithYLine(const Args&...)
+        {
+        }
+
+        std::string generateImageName(std::string* html_name = NULL)
+        {
+            return std::string();
+        }
+    };
+
+    inline log_ext& getLogExt()
+    {
+        static log_ext stub(""); // stateless
+        return stub;
+    }
+
+    inline void setThreadLogExt(log_ext*)
+    {
+    }
+
+    namespace log_ext_service
+    {
+        inline void _logEnterFunctionStub()
+        {
+        }
+    }
+
+#else
+
+    // returns logger bound to the calling thread (or thread's own default logger)
     log_ext& getLogExt();
 
+    // binds logger to the calling thread, NULL restores the default one
+    void setThreadLogExt(log_ext* log);
+
     struct ProfilingInformation
     {
         unsigned int calls;
@@ -84,11 +204,18 @@ namespace imago
             UseVirtualFS = false;
         }
 
-        bool loggingEnabled() const;
+        // inline, so disabled logging costs a single branch at the call site
+        bool loggingEnabled() const
+        {
+            return enabled;
+        }
+
         void setLoggingEnabled(bool value);
 
-        template <class t>
-        void append(const std::string& name, const t& value)
+        // name arguments are templates to not construct std::string while logging is disabled
+
+        template <class n, class t>
+        void append(const n& name, const t& value)
         {
             if (!loggingEnabled())
                 return;
@@ -99,8 +226,8 @@ namespace imago
             dump(getStringPrefix() + "<i>" + filterHtml(name) + "</i>: <u>" + filterHtml(out.str()) + "</u>");
         }
 
-        template <class t>
-        void appendVector(const std::string& name, const std::vector<t>& values)
+        template <class n, class t>
+        void appendVector(const n& name, const std::vector<t>& values)
         {
             if (!loggingEnabled())
                 return;
@@ -108,8 +235,8 @@ namespace imago
             dump(getStringPrefix() + constructTable(name, std::vector<size_t>(), values));
         }
 
-        template <class t1, class t2>
-        void appendMap(const std::string& name, const std::map<t1, t2>& value)
+        template <class n, class t1, class t2>
+        void appendMap(const n& name, const std::map<t1, t2>& value)
         {
             if (!loggingEnabled())
                 return;
@@ -126,18 +253,64 @@ namespace imago
             dump(getStringPrefix() + constructTable(name, row1, row2));
         }
 
-        void appendText(const std::string& text);
-        void appendImage(const std::string& caption, const Image& img);
-        void appendMat(const std::string& caption, const cv::Mat& mat);
-        void appendSegment(const std::string& name, const Segment& seg);
-        void appendPoints(const std::string& name, const Points2i& pts);
+        template <class n>
+        void appendText(const n& text)
+        {
+            if (loggingEnabled())
+                appendTextImpl(text);
+        }
+
+        template <class n>
+        void appendImage(const n& caption, const Image& img)
+        {
+            if (loggingEnabled())
+                appendImageImpl(caption, img);
+        }
+
+        template <class n>
+        void appendMat(const n& caption, const cv::Mat& mat)
+        {
+            if (loggingEnabled())
+                appendMatImpl(caption, mat);
+        }
+
+        template <class n>
+        void appendSegment(const n& name, const Segment& seg)
+        {
+            if (loggingEnabled())
+                appendSegmentImpl(name, seg);
+        }
+
+        template <class n>
+        void appendPoints(const n& name, const Points2i& pts)
+        {
+            if (loggingEnabled())
+                appendPointsImpl(name, pts);
+        }
 
         std::string generateImageName(std::string* html_name = NULL);
         void appendImageFile(const std::string& caption, const std::string& file);
 
-        void appendGraph(const Settings& vars, const std::string& name, const segments_graph::SegmentsGraph& g);
-        void appendSkeleton(const Settings& vars, const std::string& name, const Skeleton::SkeletonGraph& g);
-        void appendSegmentWithYLine(const Settings& vars, const std::string& name, const Segment& seg, int line_y);
+        template <class n>
+        void appendGraph(const Settings& vars, const n& name, const segments_graph::SegmentsGraph& g)
+        {
+            if (loggingEnabled())
+                appendGraphImpl(vars, name, g);
+        }
+
+        template <class n>
+        void appendSkeleton(const Settings& vars, const n& name, const Skeleton::SkeletonGraph& g)
+        {
+            if (loggingEnabled())
+                appendSkeletonImpl(vars, name, g);
+        }
+
+        template <class n>
+        void appendSegmentWithYLine(const Settings& vars, const n& name, const Segment& seg, int line_y)
+        {
+            if (loggingEnabled())
+                appendSegmentWithYLineImpl(vars, name, seg, line_y);
+        }
 
         void enterFunction(const std::string& name);
         void leaveFunction();
@@ -152,6 +325,15 @@ namespace imago
         std::vector<FunctionRecord> Stack;
         std::map<std::string, ProfilingInformation> Profile;
 
+        void appendTextImpl(const std::string& text);
+        void appendImageImpl(const std::string& caption, const Image& img);
+        void appendMatImpl(const std::string& caption, const cv::Mat& mat);
+        void appendSegmentImpl(const std::string& name, const Segment& seg);
+        void appendPointsImpl(const std::string& name, const Points2i& pts);
+        void appendGraphImpl(const Settings& vars, const std::string& name, const segments_graph::SegmentsGraph& g);
+        void appendSkeletonImpl(const Settings& vars, const std::string& name, const Skeleton::SkeletonGraph& g);
+        void appendSegmentWithYLineImpl(const Settings& vars, const std::string& name, const Segment& seg, int line_y);
+
         void appendImageInternal(const std::string& caption, const Image& img);
         std::string generateAnchor(const std::string& name);
         std::string getStringPrefix(bool paragraph = false) const;
@@ -159,8 +341,8 @@ namespace imago
         void dump(const std::string& data);
         void dumpImage(const std::string& filename, const Image& data);
 
-        template <class t1, class t2>
-        std::string constructTable(const std::string& caption, const std::vector<t1>& row1, const std::vector<t2>& row2)
+        template <class n, class t1, class t2>
+        std::string constructTable(const n& caption, const std::vector<t1>& row1, const std::vector<t2>& row2)
         {
             std::ostringstream header;
             header << "<table style=\"display:inline;\"><thead>";
@@ -206,20 +388,25 @@ namespace imago
         class LogEnterFunction
         {
         public:
-            LogEnterFunction(const std::string& name, log_ext& log) : Log(log)
+            // nothing is constructed if logging is disabled, the decision is kept until leave
+            LogEnterFunction(const char* name, log_ext& log) : Log(log.loggingEnabled() ? &log : NULL)
             {
-                Log.enterFunction(name);
+                if (Log != NULL)
+                    Log->enterFunction(name);
             }
             ~LogEnterFunction()
             {
-                Log.leaveFunction();
+                if (Log != NULL)
+                    Log->leaveFunction();
             }
             void _logEnterFunction() // fake stub method for macros calling decoration
             {
             }
 
         private:
-            log_ext& Log;
+            log_ext* Log;
         };
     }
+
+#endif // IMAGO_DISABLE_DEBUG_LOG
 } // end namespace
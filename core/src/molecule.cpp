@@ -18,11 +18,14 @@
 
 #include "molecule.h"
 
+#include <algorithm>
+
 #include "algebra.h"
 #include "exception.h"
 #include "log_ext.h"
 #include "settings.h"
 #include "skeleton.h"
+#include "spatial_index.h"
 
 using namespace imago;
 
@@ -117,6 +120,14 @@ void Molecule::mapLabels(const Settings& vars, std::deque<Label>& unmapped_label
 
     labels.assign(_labels.begin(), _labels.end());
 
+    // vertices by position, kept in sync with the graph changes below
+    SpatialIndex index(bl);
+    for (SkeletonGraph::vertex_iterator begin = _g.vertexBegin(), end = _g.vertexEnd(); begin != end; ++begin)
+        index.insert(_g.getVertexPosition(*begin), (*begin).id);
+
+    std::vector<size_t> found;
+    std::vector<Skeleton::Edge> near_edges;
+
     for (size_t i = 0; i < labels.size(); ++i)
     {
         Label& l = labels[i];
@@ -128,9 +139,24 @@ void Molecule::mapLabels(const Settings& vars, std::deque<Label>& unmapped_label
         space = l.MaxSymbolWidth() * vars.molecule.SpaceMultiply;
         space2 = l.rect.width < l.rect.height ? l.rect.width : l.rect.height;
 
-        for (SkeletonGraph::edge_iterator begin = _g.edgeBegin(), end = _g.edgeEnd(); begin != end; ++begin)
+        // both passes below take only the vertices passing testNear with one of these margins
+        double margin = std::max(space, space2 / 2);
+        index.query(Vec2d(l.rect.x - margin, l.rect.y - margin), Vec2d(l.rect.x + l.rect.width + margin, l.rect.y + l.rect.height + margin), found);
+
+        // edges ending near the label, in the order of the edges iteration
+        near_edges.clear();
+        for (size_t j = 0; j < found.size(); j++)
         {
-            SkeletonGraph::edge_descriptor e = *begin;
+            Vertex v(found[j]);
+            if (_g.getDegree(v) == 1)
+                near_edges.push_back(*_g.outEdgeBegin(v));
+        }
+        std::sort(near_edges.begin(), near_edges.end());
+        near_edges.erase(std::unique(near_edges.begin(), near_edges.end()), near_edges.end());
+
+        for (size_t j = 0; j < near_edges.size(); j++)
+        {
+            SkeletonGraph::edge_descriptor e = near_edges[j];
             if (vars.checkTimeLimit())
                 throw ImagoException("Timelimit exceeded");
 
@@ -157,9 +183,9 @@ void Molecule::mapLabels(const Settings& vars, std::deque<Label>& unmapped_label
                 nearest.push_back(e.m_target);
         }
 
-        for (SkeletonGraph::vertex_iterator begin = _g.vertexBegin(), end = _g.vertexEnd(); begin != end; ++begin)
+        for (size_t j = 0; j < found.size(); j++)
         {
-            SkeletonGraph::vertex_descriptor v = *begin;
+            SkeletonGraph::vertex_descriptor v(found[j]);
             auto v_position = _g.getVertexPosition(v);
 
             if (_g.getDegree(v) != 2)
@@ -195,6 +221,7 @@ void Molecule::mapLabels(const Settings& vars, std::deque<Label>& unmapped_label
 
                 removeBond(edge1);
                 Vertex v_d = addVertex(p_v);
+                index.insert(p_v, v_d.id);
                 addBond(neighbors[0], v_d, BT_SINGLE, true);
                 nearest.push_back(v_d);
                 nearest.push_back(v);
@@ -255,6 +282,7 @@ void Molecule::mapLabels(const Settings& vars, std::deque<Label>& unmapped_label
 
         middle.scale(2.0 / (s * (s - 1)));
         Vertex newVertex = addVertex(middle);
+        index.insert(middle, newVertex.id);
         for (int j = 0; j < s; j++)
         {
             Vertex e = nearest[j];
@@ -263,6 +291,7 @@ void Molecule::mapLabels(const Settings& vars, std::deque<Label>& unmapped_label
             BondType t = _g.getEdgeBond(bond).type;
 
             _g.removeEdge(bond);
+            index.erase(_g.getVertexPosition(e), e.id);
             _g.removeVertex(e);
             addBond(b, newVertex, t);
         }
@@ -52,10 +52,15 @@ void MolfileSaver::saveMolecule(const Settings& vars, const Molecule& mol)
 void MolfileSaver::_writeHeader()
 {
     time_t tm = time(NULL);
-    const struct tm* lt = localtime(&tm);
+    struct tm lt;
+#ifdef _WIN32
+    localtime_s(&lt, &tm);
+#else
+    localtime_r(&tm, &lt);
+#endif
 
     _out.writeCR();
-    _out.printf("  -IMAGO- %02d%02d%02d%02d%02d2D\n", lt->tm_mon + 1, lt->tm_mday, lt->tm_year % 100, lt->tm_hour, lt->tm_min);
+    _out.printf("  -IMAGO- %02d%02d%02d%02d%02d2D\n", lt.tm_mon + 1, lt.tm_mday, lt.tm_year % 100, lt.tm_hour, lt.tm_min);
     _out.writeCR();
     _out.printf("%3d%3d%3d%3d%3d%3d%3d%3d%3d%3d%3d V3000\n", 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0);
 }
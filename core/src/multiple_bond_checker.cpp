@@ -18,6 +18,8 @@
 
 #include "multiple_bond_checker.h"
 
+#include <algorithm>
+
 #include "algebra.h"
 #include "log_ext.h"
 
@@ -167,30 +169,7 @@ bool MultipleBondChecker::checkDouble(const Settings& vars, Edge frst, Edge scnd
         minLength = bf.length;
     }
 
-    // TODO: depends on hard-set constants (something more adaptive required here)
-
-    if (maxLength > vars.mbond.MaxLen1)
-        _multiBondErr = vars.mbond.mbe1;
-    else if (maxLength > vars.mbond.MaxLen2)
-    {
-        if (minLength > vars.mbond.MinLen1)
-            _multiBondErr = vars.mbond.mbe2;
-        else
-            _multiBondErr = vars.mbond.mbe3;
-    }
-    else if (maxLength > vars.mbond.MaxLen3)
-        _multiBondErr = vars.mbond.mbe4;
-    else if (maxLength > vars.mbond.MaxLen4)
-    {
-        if (minLength > vars.mbond.MinLen2)
-            _multiBondErr = vars.mbond.mbe5;
-        else
-            _multiBondErr = vars.mbond.mbe6;
-    }
-    else if (maxLength > vars.mbond.MaxLen5)
-        _multiBondErr = vars.mbond.mbe7;
-    else
-        _multiBondErr = vars.mbond.mbe_def;
+    _multiBondErr = _doubleBondErr(vars, maxLength, minLength);
 
 #ifdef DEBUG
     printf("DC:%d; %lf\nDC: %lf < %lf\n", maxLength, _multiBondErr, d, _multiBondErr * maxLength);
@@ -208,6 +187,30 @@ bool MultipleBondChecker::checkDouble(const Settings& vars, Edge frst, Edge scnd
     return true;
 }
 
+double MultipleBondChecker::maxDoubleDistance(const Settings& vars, double maxLength) const
+{
+    // minLength only chooses between two errors
+    return std::max(_doubleBondErr(vars, maxLength, 0), _doubleBondErr(vars, maxLength, maxLength)) * maxLength;
+}
+
+double MultipleBondChecker::_doubleBondErr(const Settings& vars, double maxLength, double minLength) const
+{
+    // TODO: depends on hard-set constants (something more adaptive required here)
+
+    if (maxLength > vars.mbond.MaxLen1)
+        return vars.mbond.mbe1;
+    else if (maxLength > vars.mbond.MaxLen2)
+        return minLength > vars.mbond.MinLen1 ? vars.mbond.mbe2 : vars.mbond.mbe3;
+    else if (maxLength > vars.mbond.MaxLen3)
+        return vars.mbond.mbe4;
+    else if (maxLength > vars.mbond.MaxLen4)
+        return minLength > vars.mbond.MinLen2 ? vars.mbond.mbe5 : vars.mbond.mbe6;
+    else if (maxLength > vars.mbond.MaxLen5)
+        return vars.mbond.mbe7;
+    else
+        return vars.mbond.mbe_def;
+}
+
 bool MultipleBondChecker::checkTriple(const Settings& vars, Edge thrd)
 {
     third = thrd;
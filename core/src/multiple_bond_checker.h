@@ -37,7 +37,12 @@ namespace imago
         bool checkDouble(const Settings& vars, Edge frst, Edge scnd);
         bool checkTriple(const Settings& vars, Edge thrd);
 
+        // upper bound of the average distance from the shorter bond to the longer one accepted by checkDouble
+        double maxDoubleDistance(const Settings& vars, double maxLength) const;
+
     private:
+        double _doubleBondErr(const Settings& vars, double maxLength, double minLength) const;
+
         Edge first, second, third;
         Vertex fb, fe, sb, se, tb, te;
         Vec2d fb_pos, fe_pos, sb_pos, se_pos, tb_pos, te_pos;
@@ -0,0 +1,113 @@
+/****************************************************************************
+ * Copyright (C) from 2009 to Present EPAM Systems.
+ *
+ * This file is part of Imago toolkit.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ ***************************************************************************/
+
+#include "page_recognizer.h"
+
+#include <algorithm>
+#include <atomic>
+#include <thread>
+
+#include "filter_race.h"
+#include "log_ext.h"
+#include "page_segmentator.h"
+
+namespace imago
+{
+    static void recognizeStructure(const Settings& vars, const Image& page, const PageLayout& layout, PageStructure& structure)
+    {
+        try
+        {
+            Image region;
+            PageSegmentator::cropRegion(page, structure.bounds, layout.gap, region);
+
+            FilterRaceResult result;
+            structure.success = recognizeFilterSequence(vars, region, result);
+            structure.warnings = result.warnings;
+            if (structure.success)
+                structure.molfile.swap(result.molfile);
+            else
+                structure.error = result.error;
+        }
+        catch (std::exception& e)
+        {
+            structure.error = e.what();
+        }
+    }
+
+    void recognizePageStructures(const Settings& vars, const Image& page, PageStructures& structures, int threads)
+    {
+        logEnterFunction();
+
+        structures.clear();
+
+        PageLayout layout;
+        PageSegmentator::segmentate(vars, page, layout);
+
+        PageRegions regions, captions;
+        PageSegmentator::classifyRegions(vars, layout, regions, captions);
+
+        for (size_t u = 0; u < regions.size(); u++)
+        {
+            PageStructure structure;
+            structure.bounds = regions[u].bounds;
+
+            int caption = PageSegmentator::findCaption(vars, layout, structure.bounds, captions);
+            if (caption >= 0)
+            {
+                structure.caption = captions[caption].bounds;
+                structure.hasCaption = true;
+            }
+            structures.push_back(structure);
+        }
+
+        // reading order
+        std::sort(structures.begin(), structures.end(), [](const PageStructure& a, const PageStructure& b) {
+            return a.bounds.y != b.bounds.y ? a.bounds.y < b.bounds.y : a.bounds.x < b.bounds.x;
+        });
+
+        // the caller log is not shared between threads, a logged page is recognized by one worker
+        log_ext* log = &getLogExt();
+
+        if (threads <= 0)
+            threads = std::max(1, (int)std::thread::hardware_concurrency());
+        if (log->loggingEnabled())
+            threads = 1;
+        threads = std::min(threads, (int)structures.size());
+
+        getLogExt().append("Structures", structures.size());
+        getLogExt().append("Threads", threads);
+
+        // every structure is recognized on a spawned worker: the attempts allocate and release
+        // own indigo sessions, that would leave the calling thread without its session
+        std::atomic<int> next(0);
+        auto worker = [&]() {
+            if (threads == 1)
+                setThreadLogExt(log);
+            for (int u = next++; u < (int)structures.size(); u = next++)
+                recognizeStructure(vars, page, layout, structures[u]);
+            setThreadLogExt(NULL);
+        };
+
+        std::vector<std::thread> workers;
+        for (int t = 0; t < threads; t++)
+            workers.push_back(std::thread(worker));
+
+        for (size_t t = 0; t < workers.size(); t++)
+            workers[t].join();
+    }
+}
@@ -0,0 +1,58 @@
+/****************************************************************************
+ * Copyright (C) from 2009 to Present EPAM Systems.
+ *
+ * This file is part of Imago toolkit.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ ***************************************************************************/
+
+/**
+ * @file page_recognizer.h
+ *
+ * @brief   Declares the recognition of all the structures found on a page
+ */
+
+#pragma once
+
+#include <string>
+#include <vector>
+
+#include "image.h"
+#include "rectangle.h"
+#include "settings.h"
+
+namespace imago
+{
+    struct PageStructure
+    {
+        Rectangle bounds;  // page coordinates, x2() and y2() inclusive as for PageRegion
+        Rectangle caption; // the same for the caption, valid if hasCaption
+        bool hasCaption;
+        bool success;
+        int warnings;
+        std::string molfile; // with expanded superatoms
+        std::string error;   // if not success
+
+        PageStructure() : hasCaption(false), success(false), warnings(0)
+        {
+        }
+    };
+
+    typedef std::vector<PageStructure> PageStructures;
+
+    // segmentates the page, recognizes every structure region on its own copy of vars using up to
+    // 'threads' worker threads (0 means count of available cores, one if logging is enabled) and attaches
+    // the closest caption. the calling thread only waits, it keeps its indigo session.
+    // the structures are ordered top to bottom, left to right
+    void recognizePageStructures(const Settings& vars, const Image& page, PageStructures& structures, int threads);
+}
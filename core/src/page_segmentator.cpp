@@ -0,0 +1,423 @@
+/****************************************************************************
+ * Copyright (C) from 2009 to Present EPAM Systems.
+ *
+ * This file is part of Imago toolkit.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ ***************************************************************************/
+
+#include "page_segmentator.h"
+
+#include <algorithm>
+
+#include "log_ext.h"
+#include "weak_segmentator.h"
+
+namespace imago
+{
+    namespace
+    {
+        // component of a single tile in page coordinates, several pieces form a component cut by tiles
+        struct TilePiece
+        {
+            Rectangle bounds;
+            int pixels; // in the part of the page owned by the tile, so the pieces of a component sum up exactly
+        };
+
+        // run of the piece within the overlap of tiles
+        struct SeamRun
+        {
+            int y, x1, x2;
+            int piece;
+
+            bool operator<(const SeamRun& other) const
+            {
+                return y < other.y || (y == other.y && x1 < other.x1);
+            }
+        };
+    }
+
+    static int findRoot(std::vector<int>& parent, int v)
+    {
+        while (parent[v] != v)
+        {
+            parent[v] = parent[parent[v]];
+            v = parent[v];
+        }
+        return v;
+    }
+
+    // distance between the closest pixels of the boxes along the axis, 1 for the adjacent ones
+    static int axisGap(int a1, int a2, int b1, int b2)
+    {
+        return std::max(a1 - b2, b1 - a2);
+    }
+
+    int PageSegmentator::getInkThreshold(const Image& page)
+    {
+        double hist[256] = {0};
+        for (int y = 0; y < page.rows; y++)
+        {
+            const byte* row = page.ptr(y);
+            for (int x = 0; x < page.cols; x++)
+                hist[row[x]]++;
+        }
+
+        double total = (double)page.cols * page.rows;
+        double sum = 0.0;
+        for (int v = 0; v < 256; v++)
+            sum += v * hist[v];
+
+        // maximal between-class variance, classes are [0..t] and [t+1..255]
+        int threshold = 127;
+        double best = -1.0, weight = 0.0, partial = 0.0;
+        for (int t = 0; t < 255; t++)
+        {
+            weight += hist[t];
+            partial += t * hist[t];
+            if (weight == 0.0 || weight == total)
+                continue;
+
+            double mean_low = partial / weight;
+            double mean_high = (sum - partial) / (total - weight);
+            double variance = weight * (total - weight) * (mean_low - mean_high) * (mean_low - mean_high);
+            if (variance > best)
+            {
+                best = variance;
+                threshold = t;
+            }
+        }
+        return threshold;
+    }
+
+    void PageSegmentator::segmentate(const Settings& vars, const Image& page, PageLayout& layout)
+    {
+        logEnterFunction();
+
+        layout = PageLayout();
+        layout.threshold = getInkThreshold(page);
+        getLogExt().append("Ink threshold", layout.threshold);
+
+        const int tile = std::max(64, vars.page.TileSize);
+        const int overlap = std::min(std::max(vars.page.TileOverlap, 1), tile / 2);
+        const int step = tile - overlap;
+
+        std::vector<TilePiece> pieces;
+        std::vector<SeamRun> seams;
+        Image binarized;
+        RunComponents components;
+
+        for (int ty = 0; ty < page.rows; ty += step)
+        {
+            for (int tx = 0; tx < page.cols; tx += step)
+            {
+                cv::Rect rect(tx, ty, std::min(tile, page.cols - tx), std::min(tile, page.rows - ty));
+                const bool has_left = tx > 0, has_top = ty > 0;
+                const bool has_right = rect.x + rect.width < page.cols, has_bottom = rect.y + rect.height < page.rows;
+
+                // every pixel is owned by one tile, the overlaps are split in halves
+                const int own_x1 = has_left ? overlap / 2 : 0, own_x2 = has_right ? step + overlap / 2 : rect.width;
+                const int own_y1 = has_top ? overlap / 2 : 0, own_y2 = has_bottom ? step + overlap / 2 : rect.height;
+
+                cv::threshold(page(rect), binarized, layout.threshold, 255, cv::THRESH_BINARY);
+                WeakSegmentator::labelRuns(binarized, 1, components);
+
+                for (size_t u = 0; u < components.size(); u++)
+                {
+                    const Rectangle& b = components[u].bounds;
+                    const int id = (int)pieces.size();
+
+                    TilePiece piece;
+                    piece.bounds = Rectangle(b.x + tx, b.y + ty, b.width, b.height);
+                    piece.pixels = 0;
+
+                    const PixelRuns& runs = components[u].runs;
+                    for (size_t r = 0; r < runs.size(); r++)
+                    {
+                        const PixelRun& run = runs[r];
+
+                        if (run.y >= own_y1 && run.y < own_y2)
+                            piece.pixels += std::max(0, std::min(run.x2 + 1, own_x2) - std::max(run.x1, own_x1));
+
+                        SeamRun seam;
+                        seam.y = run.y + ty;
+                        seam.piece = id;
+
+                        if ((has_top && run.y < overlap) || (has_bottom && run.y >= step))
+                        {
+                            seam.x1 = run.x1 + tx;
+                            seam.x2 = run.x2 + tx;
+                            seams.push_back(seam);
+                            continue;
+                        }
+                        if (has_left && run.x1 < overlap)
+                        {
+                            seam.x1 = run.x1 + tx;
+                            seam.x2 = std::min(run.x2, overlap - 1) + tx;
+                            seams.push_back(seam);
+                        }
+                        if (has_right && run.x2 >= step)
+                        {
+                            seam.x1 = std::max(run.x1, step) + tx;
+                            seam.x2 = run.x2 + tx;
+                            seams.push_back(seam);
+                        }
+                    }
+
+                    pieces.push_back(piece);
+                }
+
+                if (!has_right)
+                    break;
+            }
+
+            if (ty + std::min(tile, page.rows - ty) >= page.rows)
+                break;
+        }
+
+        // pieces of different tiles sharing a pixel in the overlap belong to one component
+        std::vector<int> parent(pieces.size());
+        for (size_t u = 0; u < pieces.size(); u++)
+            parent[u] = (int)u;
+
+        std::sort(seams.begin(), seams.end());
+        std::vector<SeamRun> active;
+        for (size_t u = 0; u < seams.size(); u++)
+        {
+            const SeamRun& run = seams[u];
+            if (u == 0 || seams[u - 1].y != run.y)
+                active.clear();
+
+            size_t kept = 0;
+            for (size_t v = 0; v < active.size(); v++)
+            {
+                if (active[v].x2 < run.x1)
+                    continue;
+                // runs of one tile never intersect, so the rest are from the other tiles
+                int ra = findRoot(parent, active[v].piece), rb = findRoot(parent, run.piece);
+                if (ra != rb)
+                    parent[std::max(ra, rb)] = std::min(ra, rb);
+                active[kept++] = active[v];
+            }
+            active.resize(kept);
+            active.push_back(run);
+        }
+        std::vector<SeamRun>().swap(seams);
+
+        std::vector<TilePiece> stitched;
+        {
+            std::vector<int> component_of(pieces.size(), -1);
+            std::vector<int> x2, y2;
+            for (size_t u = 0; u < pieces.size(); u++)
+            {
+                int root = findRoot(parent, (int)u);
+                const Rectangle& b = pieces[u].bounds;
+
+                if (component_of[root] < 0)
+                {
+                    component_of[root] = (int)stitched.size();
+                    TilePiece component;
+                    component.bounds = b;
+                    component.pixels = 0;
+                    stitched.push_back(component);
+                    x2.push_back(b.x2());
+                    y2.push_back(b.y2());
+                }
+
+                int c = component_of[root];
+                Rectangle& bounds = stitched[c].bounds;
+                bounds.x = std::min(bounds.x, b.x);
+                bounds.y = std::min(bounds.y, b.y);
+                x2[c] = std::max(x2[c], b.x2());
+                y2[c] = std::max(y2[c], b.y2());
+                stitched[c].pixels += pieces[u].pixels;
+            }
+
+            size_t kept = 0;
+            for (size_t c = 0; c < stitched.size(); c++)
+            {
+                stitched[c].bounds.width = x2[c] - stitched[c].bounds.x;
+                stitched[c].bounds.height = y2[c] - stitched[c].bounds.y;
+                if (stitched[c].pixels >= vars.page.MinComponentPixels)
+                    stitched[kept++] = stitched[c];
+            }
+            stitched.resize(kept);
+        }
+        getLogExt().append("Tile pieces", pieces.size());
+        std::vector<TilePiece>().swap(pieces);
+
+        std::vector<int> heights;
+        for (size_t u = 0; u < stitched.size(); u++)
+            heights.push_back(stitched[u].bounds.height + 1);
+
+        if (!heights.empty())
+        {
+            std::nth_element(heights.begin(), heights.begin() + heights.size() / 2, heights.end());
+            layout.componentHeight = heights[heights.size() / 2];
+        }
+        else
+        {
+            layout.componentHeight = vars.characters.MinimalRecognizableHeight;
+        }
+
+        layout.gap = std::max(1, imago::round(vars.page.RegionGapFactor * layout.componentHeight));
+        const double graphics_size = vars.page.GraphicsFactor * layout.componentHeight;
+        getLogExt().append("Component height", layout.componentHeight);
+        getLogExt().append("Region gap", layout.gap);
+
+        // single linkage of the components with boxes closer than the gap
+        std::sort(stitched.begin(), stitched.end(), [](const TilePiece& a, const TilePiece& b) { return a.bounds.x < b.bounds.x; });
+        parent.resize(stitched.size());
+        for (size_t u = 0; u < stitched.size(); u++)
+            parent[u] = (int)u;
+
+        for (size_t i = 0; i < stitched.size(); i++)
+        {
+            const Rectangle& a = stitched[i].bounds;
+            for (size_t j = i + 1; j < stitched.size() && stitched[j].bounds.x1() <= a.x2() + layout.gap; j++)
+            {
+                const Rectangle& b = stitched[j].bounds;
+                if (axisGap(a.y1(), a.y2(), b.y1(), b.y2()) <= layout.gap)
+                {
+                    int ri = findRoot(parent, (int)i), rj = findRoot(parent, (int)j);
+                    if (ri != rj)
+                        parent[std::max(ri, rj)] = std::min(ri, rj);
+                }
+            }
+        }
+
+        std::vector<int> region_of(stitched.size(), -1);
+        std::vector<int> x2, y2;
+        for (size_t u = 0; u < stitched.size(); u++)
+        {
+            int root = findRoot(parent, (int)u);
+            const Rectangle& b = stitched[u].bounds;
+
+            if (region_of[root] < 0)
+            {
+                region_of[root] = (int)layout.regions.size();
+                PageRegion region;
+                region.bounds = b;
+                region.pixels = 0;
+                region.components = 0;
+                region.graphics = 0;
+                layout.regions.push_back(region);
+                x2.push_back(b.x2());
+                y2.push_back(b.y2());
+            }
+
+            int r = region_of[root];
+            PageRegion& region = layout.regions[r];
+            region.bounds.x = std::min(region.bounds.x, b.x);
+            region.bounds.y = std::min(region.bounds.y, b.y);
+            x2[r] = std::max(x2[r], b.x2());
+            y2[r] = std::max(y2[r], b.y2());
+            region.pixels += stitched[u].pixels;
+            region.components++;
+            if (std::max(b.width, b.height) + 1 >= graphics_size)
+                region.graphics++;
+        }
+
+        for (size_t r = 0; r < layout.regions.size(); r++)
+        {
+            Rectangle& bounds = layout.regions[r].bounds;
+            bounds.width = x2[r] - bounds.x;
+            bounds.height = y2[r] - bounds.y;
+        }
+
+        std::stable_sort(layout.regions.begin(), layout.regions.end(), [](const PageRegion& a, const PageRegion& b) { return a.pixels > b.pixels; });
+
+        getLogExt().append("Components", stitched.size());
+        getLogExt().append("Regions", layout.regions.size());
+    }
+
+    void PageSegmentator::selectCandidates(const Settings& vars, const PageLayout& layout, PageRegions& candidates)
+    {
+        candidates.clear();
+
+        const double min_size = vars.page.MinRegionFactor * layout.componentHeight;
+        for (size_t u = 0; u < layout.regions.size(); u++)
+        {
+            if (vars.page.MaxCandidates > 0 && (int)candidates.size() >= vars.page.MaxCandidates)
+                break;
+
+            const Rectangle& b = layout.regions[u].bounds;
+            if (b.width + 1 >= min_size && b.height + 1 >= min_size)
+                candidates.push_back(layout.regions[u]);
+        }
+    }
+
+    void PageSegmentator::classifyRegions(const Settings& vars, const PageLayout& layout, PageRegions& structures, PageRegions& captions)
+    {
+        logEnterFunction();
+
+        structures.clear();
+        captions.clear();
+
+        const double min_size = vars.page.MinRegionFactor * layout.componentHeight;
+        const double max_caption_height = vars.page.MaxCaptionLines * vars.page.CaptionLineFactor * layout.componentHeight;
+
+        for (size_t u = 0; u < layout.regions.size(); u++)
+        {
+            const PageRegion& region = layout.regions[u];
+            const Rectangle& b = region.bounds;
+
+            if (region.graphics > 0 && b.width + 1 >= min_size && b.height + 1 >= min_size)
+                structures.push_back(region);
+            else if (region.graphics == 0 && b.height + 1 <= max_caption_height)
+                captions.push_back(region);
+        }
+
+        getLogExt().append("Structures", structures.size());
+        getLogExt().append("Captions", captions.size());
+    }
+
+    int PageSegmentator::findCaption(const Settings& vars, const PageLayout& layout, const Rectangle& structure, const PageRegions& captions)
+    {
+        const double max_distance = vars.page.CaptionDistanceFactor * layout.componentHeight;
+
+        int result = -1;
+        double best = 0.0;
+        for (size_t u = 0; u < captions.size(); u++)
+        {
+            const Rectangle& c = captions[u].bounds;
+
+            // captions are centered below or above the structure
+            double center = (c.x1() + c.x2()) / 2.0;
+            if (center < structure.x1() || center > structure.x2())
+                continue;
+
+            double distance = axisGap(structure.y1(), structure.y2(), c.y1(), c.y2());
+            if (distance <= 0 || distance > max_distance)
+                continue;
+
+            // the ones below win at equal distance
+            if (c.y1() < structure.y1())
+                distance += 0.5;
+
+            if (result < 0 || distance < best)
+            {
+                result = (int)u;
+                best = distance;
+            }
+        }
+        return result;
+    }
+
+    void PageSegmentator::cropRegion(const Image& page, const Rectangle& bounds, int margin, Image& output)
+    {
+        int x1 = std::max(0, bounds.x1() - margin), y1 = std::max(0, bounds.y1() - margin);
+        int x2 = std::min(page.cols - 1, bounds.x2() + margin), y2 = std::min(page.rows - 1, bounds.y2() + margin);
+        page.extractRect(x1, y1, x2, y2, output);
+    }
+}
@@ -0,0 +1,82 @@
+/****************************************************************************
+ * Copyright (C) from 2009 to Present EPAM Systems.
+ *
+ * This file is part of Imago toolkit.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ ***************************************************************************/
+
+/**
+ * @file page_segmentator.h
+ *
+ * @brief   Declares the tiled segmentation of large pages into ink regions
+ */
+
+#pragma once
+
+#include <vector>
+
+#include "image.h"
+#include "rectangle.h"
+#include "settings.h"
+
+namespace imago
+{
+    // connected ink of the page grouped by proximity
+    struct PageRegion
+    {
+        Rectangle bounds; // page coordinates, x2() and y2() inclusive as for RunComponent
+        int pixels;       // ink pixels count
+        int components;
+        int graphics; // components longer than GraphicsFactor * median component height, such as bonds
+    };
+
+    typedef std::vector<PageRegion> PageRegions;
+
+    struct PageLayout
+    {
+        int threshold;          // pixels not above it are ink
+        double componentHeight; // median height of the complete components
+        int gap;                // components closer than gap pixels are in the same region
+        PageRegions regions;    // sorted by decreasing ink
+
+        PageLayout() : threshold(0), componentHeight(0.0), gap(0)
+        {
+        }
+    };
+
+    class PageSegmentator
+    {
+    public:
+        // binarizes and labels the page by overlapping tiles, components cut by tiles are stitched by
+        // their pixels in the overlaps. besides the page only one tile is binarized at a time, the rest of
+        // the memory depends on the count of components and the ink in the overlaps
+        static void segmentate(const Settings& vars, const Image& page, PageLayout& layout);
+
+        // regions large enough to contain a structure, at most MaxCandidates of the largest ones
+        static void selectCandidates(const Settings& vars, const PageLayout& layout, PageRegions& candidates);
+
+        // structures contain long strokes and are large enough, captions are short text-only blocks.
+        // other regions (long text, noise) are in neither list, both lists keep the order by ink
+        static void classifyRegions(const Settings& vars, const PageLayout& layout, PageRegions& structures, PageRegions& captions);
+
+        // index of the closest caption centered below or above the structure, -1 if there is none
+        static int findCaption(const Settings& vars, const PageLayout& layout, const Rectangle& structure, const PageRegions& captions);
+
+        // copies the region with the margin around it, clipped by the page
+        static void cropRegion(const Image& page, const Rectangle& bounds, int margin, Image& output);
+
+        // global Otsu threshold of the page histogram
+        static int getInkThreshold(const Image& page);
+    };
+}
@@ -67,6 +67,39 @@ std::string platform::getLineEndings()
     return "\r\n";
 }
 
+platform::MappedFile::MappedFile(const std::string& fileName) : _open(false), _data(NULL), _size(0), _handle(NULL)
+{
+    HANDLE file = CreateFileA(fileName.c_str(), GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+    if (file == INVALID_HANDLE_VALUE)
+        return;
+
+    LARGE_INTEGER size;
+    if (GetFileSizeEx(file, &size))
+    {
+        _size = (size_t)size.QuadPart;
+        if (_size == 0)
+        {
+            _open = true;
+        }
+        else if ((_handle = CreateFileMappingA(file, NULL, PAGE_READONLY, 0, 0, NULL)) != NULL)
+        {
+            _data = (const unsigned char*)MapViewOfFile(_handle, FILE_MAP_READ, 0, 0, 0);
+            _open = _data != NULL;
+        }
+    }
+
+    // the mapping keeps the file open
+    CloseHandle(file);
+}
+
+platform::MappedFile::~MappedFile()
+{
+    if (_data)
+        UnmapViewOfFile(_data);
+    if (_handle)
+        CloseHandle(_handle);
+}
+
 int platform::CALL(const std::string& executable, const std::string& parameters, int timelimit)
 {
     int result = 0;
@@ -142,7 +175,10 @@ int platform::CALL(const std::string& executable, const std::string& parameters,
 #else // ------------------- POSIX -------------------
 
 #include <errno.h>
+#include <fcntl.h>
+#include <sys/mman.h>
 #include <sys/stat.h>
+#include <unistd.h>
 
 int platform::MKDIR(const std::string& directory)
 {
@@ -169,4 +205,39 @@ std::string platform::getLineEndings()
     return "\n";
 }
 
+platform::MappedFile::MappedFile(const std::string& fileName) : _open(false), _data(NULL), _size(0), _handle(NULL)
+{
+    int fd = open(fileName.c_str(), O_RDONLY);
+    if (fd < 0)
+        return;
+
+    struct stat st;
+    if (fstat(fd, &st) == 0 && S_ISREG(st.st_mode))
+    {
+        _size = (size_t)st.st_size;
+        if (_size == 0)
+        {
+            _open = true;
+        }
+        else
+        {
+            void* data = mmap(NULL, _size, PROT_READ, MAP_PRIVATE, fd, 0);
+            if (data != MAP_FAILED)
+            {
+                _data = (const unsigned char*)data;
+                _open = true;
+            }
+        }
+    }
+
+    // the mapping stays valid after the descriptor is closed
+    close(fd);
+}
+
+platform::MappedFile::~MappedFile()
+{
+    if (_data)
+        munmap((void*)_data, _size);
+}
+
 #endif
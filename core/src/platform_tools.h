@@ -18,10 +18,45 @@
 
 #pragma once
 
+#include <cstddef>
 #include <string>
 
 namespace platform
 {
+    // read-only memory mapping of the whole file
+    class MappedFile
+    {
+    public:
+        explicit MappedFile(const std::string& fileName);
+        ~MappedFile();
+
+        // false if the file can not be opened or mapped
+        bool isOpen() const
+        {
+            return _open;
+        }
+
+        // NULL for the empty file
+        const unsigned char* data() const
+        {
+            return _data;
+        }
+
+        size_t size() const
+        {
+            return _size;
+        }
+
+    private:
+        bool _open;
+        const unsigned char* _data;
+        size_t _size;
+        void* _handle; // file mapping object on Windows
+
+        MappedFile(const MappedFile&);
+        MappedFile& operator=(const MappedFile&);
+    };
+
     // returns error code
     int MKDIR(const std::string& directory);
 
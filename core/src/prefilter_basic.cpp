@@ -37,14 +37,7 @@ namespace imago
             getLogExt().appendImage("Source", image);
 
             int white_count = 0, black_count = 0, others_count = 0;
-            for (int y = 0; y < image.getHeight(); y++)
-                for (int x = 0; x < image.getWidth(); x++)
-                    if (image.getByte(x, y) == 0)
-                        black_count++;
-                    else if (image.getByte(x, y) == 255)
-                        white_count++;
-                    else
-                        others_count++;
+            ImageUtils::countBlackWhite(image, black_count, white_count, others_count);
 
             getLogExt().append("white_count", white_count);
             getLogExt().append("black_count", black_count);
@@ -55,26 +48,8 @@ namespace imago
                 getLogExt().appendText("image is binarized");
                 if (others_count > 0)
                 {
-                    int gap = vars.prefilterCV.BinarizerFrameGap;
                     getLogExt().appendText("Fixup other colors");
-                    for (int y = 0; y < image.getHeight(); y++)
-                    {
-                        for (int x = 0; x < image.getWidth(); x++)
-                        {
-                            if (image.getByte(x, y) != 0 && image.getByte(x, y) != 255)
-                            {
-                                if (x > gap && y > gap && x + gap < image.getWidth() && y + gap < image.getHeight() &&
-                                    image.getByte(x, y) < vars.prefilterCV.BinarizerThreshold)
-                                {
-                                    image.getByte(x, y) = 0;
-                                }
-                                else
-                                {
-                                    image.getByte(x, y) = 255;
-                                }
-                            }
-                        }
-                    }
+                    ImageUtils::thresholdWithBorder(image, vars.prefilterCV.BinarizerThreshold, vars.prefilterCV.BinarizerFrameGap);
                 }
 
                 if (black_count > 2 * white_count)
@@ -87,20 +62,7 @@ namespace imago
                     else
                     {
                         getLogExt().appendText("image is inversed");
-                        for (int y = 0; y < image.getHeight(); y++)
-                        {
-                            for (int x = 0; x < image.getWidth(); x++)
-                            {
-                                if (image.getByte(x, y) == 0)
-                                {
-                                    image.getByte(x, y) = 255;
-                                }
-                                else
-                                {
-                                    image.getByte(x, y) = 0;
-                                }
-                            }
-                        }
+                        ImageUtils::invertBinary(image);
                     }
                 }
 
@@ -181,6 +143,9 @@ namespace imago
             cv::Mat smoothed2x(grayFrame.rows, grayFrame.cols, CV_8U);
             cv::pyrUp(reduced2x, smoothed2x);
 
+            if (vars.checkTimeLimit())
+                throw ImagoException("Timelimit exceeded");
+
             cv::Mat strong;
             cv::adaptiveThreshold(smoothed2x, strong, 255, cv::ADAPTIVE_THRESH_GAUSSIAN_C, CV_THRESH_BINARY,
                                   (vars.prefilterCV.StrongBinarizeSize) + (vars.prefilterCV.StrongBinarizeSize) % 2 + 1, vars.prefilterCV.StrongBinarizeTresh);
@@ -207,6 +172,12 @@ namespace imago
 
             for (int iter = 0; iter <= (vars.prefilterCV.UseOtsuPixelsAddition ? 1 : 0); iter++)
             {
+                if (vars.checkTimeLimit())
+                {
+                    delete output;
+                    throw ImagoException("Timelimit exceeded");
+                }
+
                 Image bin;
                 if (iter == 0)
                     ImageUtils::copyMatToImage(weak, bin);
@@ -2,8 +2,10 @@
 
 #include <opencv2/opencv.hpp>
 
+#include "exception.h"
 #include "filters_list.h"
 #include "log_ext.h"
+#include "recognition_statistics.h"
 
 namespace imago
 {
@@ -53,19 +55,59 @@ namespace imago
         }
     }
 
-    bool prefilterEntrypoint(Settings& vars, Image& output, const Image& src)
+    static void resetFilterState(Settings& vars, const Image& src)
     {
-        logEnterFunction();
-
-        bool result = false;
-
-        output.copy(src);
-
         vars.general.ImageWidth = vars.general.OriginalImageWidth = src.getWidth();
         vars.general.ImageHeight = vars.general.OriginalImageHeight = src.getHeight();
 
         vars.general.ImageAlreadyBinarized = false;
         vars.general.FilterIndex = 0;
+    }
+
+    // applies the filter vars.general.FilterIndex to the copy of src
+    static bool tryFilter(Settings& vars, Image& output, const Image& src, const FilterEntries& filters)
+    {
+        const FilterEntryDefinition& filter = filters[vars.general.FilterIndex];
+
+        output.copy(src);
+
+        getLogExt().append("use filter", filter.name);
+
+        if (filter.condition != NULL && filter.condition(output) == false)
+        {
+            getLogExt().append("filter condition failed", filter.name);
+            return false;
+        }
+
+        if (filter.routine(vars, output))
+        {
+            getLogExt().append("filter success", filter.name);
+            if (!filter.update_config_string.empty())
+            {
+                vars.fillFromDataStream(filter.update_config_string);
+            }
+            return true;
+        }
+
+        getLogExt().append("filter failed", filter.name);
+        return false;
+    }
+
+    static void storeFilterStatistics(const Settings& vars, const FilterEntries& filters, bool result)
+    {
+        if (RecognitionStatistics* statistics = getThreadStatistics())
+        {
+            statistics->filterIndex = result ? vars.general.FilterIndex : -1;
+            statistics->filterName = result ? filters[vars.general.FilterIndex].name : "";
+        }
+    }
+
+    bool prefilterEntrypoint(Settings& vars, Image& output, const Image& src)
+    {
+        logEnterFunction();
+
+        output.share(src); // every filter copies it before the changes
+        resetFilterState(vars, src);
 
         return applyNextPrefilter(vars, output, src, false);
     }
@@ -73,6 +115,7 @@ namespace imago
     bool applyNextPrefilter(Settings& vars, Image& output, const Image& src, bool iterateNext)
     {
         logEnterFunction();
+        StageTimer timer(RecognitionStatistics::stPrefilter);
         bool result = false;
 
         if (iterateNext)
@@ -84,34 +127,33 @@ namespace imago
 
         for (; vars.general.FilterIndex < (int)filters.size(); vars.general.FilterIndex++)
         {
-            output.copy(src);
-
-            int& u = vars.general.FilterIndex;
-
-            getLogExt().append("use filter", filters[u].name);
-
-            if (filters[u].condition != NULL && filters[u].condition(output) == false)
+            if (tryFilter(vars, output, src, filters))
             {
-                getLogExt().append("filter condition failed", filters[u].name);
-                continue;
-            }
-
-            if (filters[u].routine(vars, output))
-            {
-                getLogExt().append("filter success", filters[u].name);
-                if (!filters[u].update_config_string.empty())
-                {
-                    vars.fillFromDataStream(filters[u].update_config_string);
-                }
                 result = true;
                 break;
             }
-            else
-            {
-                getLogExt().append("filter failed", filters[u].name);
-            }
         }
 
+        storeFilterStatistics(vars, filters, result);
+
+        return result;
+    }
+
+    bool applyPrefilter(Settings& vars, Image& output, const Image& src, int filterIndex)
+    {
+        logEnterFunction();
+        StageTimer timer(RecognitionStatistics::stPrefilter);
+
+        FilterEntries filters = getFiltersList();
+        if (filterIndex < 0 || filterIndex >= (int)filters.size())
+            throw ImagoException("Filter index is out of range");
+
+        resetFilterState(vars, src);
+        vars.general.FilterIndex = filterIndex;
+
+        bool result = tryFilter(vars, output, src, filters);
+        storeFilterStatistics(vars, filters, result);
+
         return result;
     }
 }
@@ -29,6 +29,10 @@ namespace imago
     // iterates trough next filters
     bool applyNextPrefilter(Settings& vars, Image& output, const Image& src, bool iterateNext = true);
 
+    // applies the single filter of getFiltersList(), returns false if it is not suitable for the image.
+    // starts from the state of a new iteration, the settings updated by the filters before it are not applied
+    bool applyPrefilter(Settings& vars, Image& output, const Image& src, int filterIndex);
+
     namespace PrefilterUtils
     {
         // returns true if image was modified
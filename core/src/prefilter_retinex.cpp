@@ -1,5 +1,9 @@
 #include "prefilter_retinex.h"
 
+#include <algorithm>
+#include <cmath>
+#include <vector>
+
 #include <opencv2/opencv.hpp>
 
 #include "image_utils.h"
@@ -11,8 +15,7 @@ namespace imago
 {
     namespace prefilter_retinex
     {
-        template <typename data_t>
-        double contrastNormalizeSingleIteration(std::vector<data_t>& data, double drop_percentage = 0.01, double max_average = 128)
+        static double contrastNormalizeSingleIteration(cv::Mat1f& data, double drop_percentage = 0.01, double max_average = 128)
         {
             logEnterFunction();
 
@@ -23,14 +26,17 @@ namespace imago
             int max_v = max_value;
             double average = 0;
 
-            for (size_t u = 0; u < data.size(); u++)
+            const size_t size = data.total();
+            float* ptr = (float*)data.data; // continuous, allocated by the filter
+
+            for (size_t u = 0; u < size; u++)
             {
-                double v = data[u];
+                double v = ptr[u];
                 hist[imago::round(v)]++;
                 average += v;
             }
 
-            average /= data.size();
+            average /= size;
 
             if (average > max_average)
             {
@@ -40,7 +46,7 @@ namespace imago
 
             {
                 int sum = 0;
-                while (sum < data.size() * drop_percentage && max_v > min_v)
+                while (sum < size * drop_percentage && max_v > min_v)
                 {
                     sum += hist[max_v];
                     max_v--;
@@ -49,7 +55,7 @@ namespace imago
 
             {
                 int sum = 0;
-                while (sum < data.size() * drop_percentage && max_v > min_v)
+                while (sum < size * drop_percentage && max_v > min_v)
                 {
                     sum += hist[min_v];
                     min_v++;
@@ -65,21 +71,20 @@ namespace imago
             cv::normalize(data, data, min_v, max_v, cv::NORM_MINMAX);
 
             average = 0;
-            for (size_t u = 0; u < data.size(); u++)
+            for (size_t u = 0; u < size; u++)
             {
-                data_t& v = data[u];
+                float& v = ptr[u];
                 if (v < 0)
                     v = 0;
                 else if (v > max_value)
                     v = max_value;
                 average += v;
             }
-            average /= data.size();
+            average /= size;
             return average;
         }
 
-        template <typename data_t>
-        void contrastNormalize(std::vector<data_t>& data, int contrastNominal, double dropPercentage)
+        static void contrastNormalize(cv::Mat1f& data, int contrastNominal, double dropPercentage)
         {
             logEnterFunction();
 
@@ -94,156 +99,106 @@ namespace imago
             }
         }
 
-        template <typename data_t>
-        bool computeDLT(std::vector<data_t>& data_out, const std::vector<data_t>& data_in, size_t nx, size_t ny, double t)
+        // difference counted once for every threshold it exceeds
+        static inline float thresholdedDiff(float diff, const std::vector<float>& thresholds)
         {
-            logEnterFunction();
+            float magnitude = fabs(diff);
+            int count = 0;
+            for (size_t u = 0; u < thresholds.size(); u++)
+                if (magnitude > thresholds[u])
+                    count++;
+            return diff * count;
+        }
 
-            const data_t* ptr_in = &data_in.at(0);
-            const data_t* ptr_in_xm1 = ptr_in - 1;
-            const data_t* ptr_in_xp1 = ptr_in + 1;
-            const data_t* ptr_in_ym1 = ptr_in - nx;
-            const data_t* ptr_in_yp1 = ptr_in + nx;
-            data_t* ptr_out = &data_out.at(0);
+        // discrete laplacian thresholded by each of the thresholds and summed over them.
+        // the rest of the solve is linear, so solving the sum once equals summing the per-threshold solutions
+        static void computeDLT(const cv::Mat1f& in, cv::Mat1f& out, const std::vector<float>& thresholds)
+        {
+            logEnterFunction();
 
-            data_t diff = 0.0;
+            out.create(in.rows, in.cols);
 
-            for (size_t j = 0; j < ny; j++)
-            {
-                for (size_t i = 0; i < nx; i++)
+            cv::parallel_for_(cv::Range(0, in.rows), [&](const cv::Range& range) {
+                for (int y = range.start; y < range.end; y++)
                 {
-                    *ptr_out = 0.;
-                    if (0 < i)
-                    {
-                        diff = *ptr_in - *ptr_in_xm1;
-                        if (fabs(diff) > t)
-                            *ptr_out += diff;
-                    }
-                    if (nx - 1 > i)
-                    {
-                        diff = *ptr_in - *ptr_in_xp1;
-                        if (fabs(diff) > t)
-                            *ptr_out += diff;
-                    }
-                    if (0 < j)
-                    {
-                        diff = *ptr_in - *ptr_in_ym1;
-                        if (fabs(diff) > t)
-                            *ptr_out += diff;
-                    }
-                    if (ny - 1 > j)
+                    const float* row = in[y];
+                    const float* up = y > 0 ? in[y - 1] : NULL;
+                    const float* down = y + 1 < in.rows ? in[y + 1] : NULL;
+                    float* dst = out[y];
+
+                    for (int x = 0; x < in.cols; x++)
                     {
-                        diff = *ptr_in - *ptr_in_yp1;
-                        if (fabs(diff) > t)
-                            *ptr_out += diff;
+                        float sum = 0;
+                        if (x > 0)
+                            sum += thresholdedDiff(row[x] - row[x - 1], thresholds);
+                        if (x + 1 < in.cols)
+                            sum += thresholdedDiff(row[x] - row[x + 1], thresholds);
+                        if (up != NULL)
+                            sum += thresholdedDiff(row[x] - up[x], thresholds);
+                        if (down != NULL)
+                            sum += thresholdedDiff(row[x] - down[x], thresholds);
+                        dst[x] = sum;
                     }
-                    ptr_in++;
-                    ptr_in_xm1++;
-                    ptr_in_xp1++;
-                    ptr_in_ym1++;
-                    ptr_in_yp1++;
-                    ptr_out++;
                 }
-            }
-
-            return true;
+            });
         }
 
-        template <typename data_t>
-        bool fastFillCosTable(size_t size, std::vector<data_t>& table)
+        static void fillCosTable(int size, std::vector<float>& table)
         {
-            logEnterFunction();
-
             table.resize(size);
-
-            data_t* ptr_table = &table.at(0);
-            for (size_t i = 0; i < size; i++)
-                *ptr_table++ = cos((data_t)(imago::PI)*i / size);
-
-            return true;
+            for (int i = 0; i < size; i++)
+                table[i] = (float)cos(imago::PI * i / size);
         }
 
-        template <typename data_t>
-        bool retinexPoissonDCT(std::vector<data_t>& data, size_t nx, size_t ny, data_t m)
+        // solves the Poisson PDE in place in the DCT space, m is the normalization of the DCT
+        static void retinexPoissonDCT(cv::Mat1f& data, float m)
         {
             logEnterFunction();
 
-            std::vector<data_t> cosi, cosj;
-            fastFillCosTable(nx, cosi);
-            fastFillCosTable(ny, cosj);
-
-            data_t two = static_cast<data_t>(2.0);
-            data_t m2 = static_cast<data_t>(m) / two;
+            std::vector<float> cosi, cosj;
+            fillCosTable(data.cols, cosi);
+            fillCosTable(data.rows, cosj);
 
-            data_t* ptr_data = &data.at(0);
-            data_t* ptr_cosi = &cosi.at(0);
-            data_t* ptr_cosj = &cosj.at(0);
+            const float two = 2.0f;
+            const float m2 = m / two;
 
-            *ptr_data++ = 0.;
-            ptr_cosi++;
-
-            for (size_t i = 1; i < nx; i++)
+            for (int j = 0; j < data.rows; j++)
             {
-                *ptr_data++ *= m2 / (two - *ptr_cosi++ - *ptr_cosj);
-            }
-
-            ptr_cosj++;
-            ptr_cosi = &cosi.at(0);
-
-            for (size_t j = 1; j < ny; j++)
-            {
-                for (size_t i = 0; i < nx; i++)
-                {
-                    *ptr_data++ *= m2 / (two - *ptr_cosi++ - *ptr_cosj);
-                }
-                ptr_cosj++;
-                ptr_cosi = &cosi.at(0);
+                float* row = data[j];
+                for (int i = 0; i < data.cols; i++)
+                    row[i] *= m2 / (two - cosi[i] - cosj[j]);
             }
 
-            return true;
+            data(0, 0) = 0.0f;
         }
 
-        template <typename data_t>
-        void cvBasedCDT(std::vector<data_t>& data, int nx, int ny, int flags = 0)
+        // replaces data by the retinex solution for all the thresholds, dimensions should be even for the DCT
+        static void retinexProcess(Settings& vars, cv::Mat1f& data, const std::vector<float>& thresholds)
         {
             logEnterFunction();
 
-            cv::Mat1d temp(ny, nx);
-            size_t idx = 0;
-            for (int y = 0; y < ny; y++)
-                for (int x = 0; x < nx; x++)
-                    temp(y, x) = data[idx++];
-
-            cv::dct(temp, temp, flags);
-
-            idx = 0;
-            for (int y = 0; y < ny; y++)
-                for (int x = 0; x < nx; x++)
-                    data[idx++] = (data_t)temp(y, x);
-        }
-
-        template <typename data_t>
-        bool retinexProcess(std::vector<data_t>& data, size_t nx, size_t ny, double thresh)
-        {
-            logEnterFunction();
-            std::vector<data_t> temp(data.size());
+            cv::Mat1f temp;
 
             getLogExt().appendText("Compute discrete laplacian threshold");
-            computeDLT(temp, data, nx, ny, thresh); // data -> temp
+            computeDLT(data, temp, thresholds); // data -> temp
+
+            if (vars.checkTimeLimit())
+                throw ImagoException("Timelimit exceeded");
 
             getLogExt().appendText("Compute simple discrete cosine transform");
-            cvBasedCDT(temp, (int)nx, (int)ny);
+            cv::dct(temp, temp);
 
-            getLogExt().appendText("Solve the Poisson PDE in Fourier space");
-            data_t normDCT = (data_t)(1.0 / (data_t)(nx * ny));
-            retinexPoissonDCT(temp, nx, ny, normDCT);
+            if (vars.checkTimeLimit())
+                throw ImagoException("Timelimit exceeded");
 
-            getLogExt().appendText("Compute inversed discrete cosine transform");
-            cvBasedCDT(temp, (int)nx, (int)ny, cv::DCT_INVERSE);
+            getLogExt().appendText("Solve the Poisson PDE in Fourier space");
+            retinexPoissonDCT(temp, (float)(1.0 / ((double)temp.cols * temp.rows)));
 
-            data = temp; // temp -> data
+            if (vars.checkTimeLimit())
+                throw ImagoException("Timelimit exceeded");
 
-            return true;
+            getLogExt().appendText("Compute inversed discrete cosine transform");
+            cv::dct(temp, data, cv::DCT_INVERSE); // temp -> data
         }
 
         bool prefilterRetinexDownscaleOnly(Settings& vars, Image& raw)
@@ -257,54 +212,58 @@ namespace imago
 
             getLogExt().appendImage("Source image", raw);
 
-            // dimensions should be even for the FFT transform
+            // dimensions should be even for the DCT
             int width = (raw.getWidth() / 2) * 2;
             int height = (raw.getHeight() / 2) * 2;
 
-            typedef std::vector<float> Array;
+            if (width == 0 || height == 0)
+                return false;
+
+            std::vector<float> thresholds;
+            for (int iteration = vars.retinex.StartIteration; iteration < vars.retinex.EndIteration; iteration += vars.retinex.IterationStep)
+                thresholds.push_back((float)iteration);
+            getLogExt().append("Iterations", thresholds.size());
 
-            Array result(width * height);
+            cv::Mat1f result;
+            raw(cv::Rect(0, 0, width, height)).convertTo(result, CV_32F);
 
             // process multi-scale retinex
+            if (thresholds.empty())
             {
-                Array input(width * height);
-
-                for (int y = 0; y < height; y++)
-                    for (int x = 0; x < width; x++)
-                        input[y * width + x] = raw.getByte(x, y);
-
-                for (int iteration = vars.retinex.StartIteration; iteration < vars.retinex.EndIteration; iteration += vars.retinex.IterationStep)
-                {
-                    getLogExt().append("Iteration", iteration);
-
-                    Array temp = input;
-                    double threshold = iteration;
-                    retinexProcess(temp, width, height, threshold);
-                    for (size_t u = 0; u < temp.size(); u++)
-                        result[u] += temp[u];
-                }
+                result.setTo(cv::Scalar(0));
+            }
+            else if (vars.retinex.PyramidLevel > 0)
+            {
+                // solve on the downscaled image, the shading is smooth anyway
+                int scale = 1 << std::min(vars.retinex.PyramidLevel, 16);
+                cv::Size size(std::max(2, (width / scale) / 2 * 2), std::max(2, (height / scale) / 2 * 2));
+                getLogExt().append("Solve width", size.width);
+
+                cv::Mat1f small;
+                cv::resize(result, small, size, 0.0, 0.0, cv::INTER_AREA);
+                retinexProcess(vars, small, thresholds);
+                cv::resize(small, result, cv::Size(width, height), 0.0, 0.0, cv::INTER_LINEAR);
+            }
+            else
+            {
+                retinexProcess(vars, result, thresholds);
             }
 
+            if (vars.checkTimeLimit())
+                throw ImagoException("Timelimit exceeded");
+
             // normalize contrast
             contrastNormalize(result, vars.retinex.ContrastNominal, vars.retinex.ContrastDropPercentage);
 
             // store result back
             getLogExt().appendText("Store image data");
 
+            cv::Mat1b bytes;
+            result.convertTo(bytes, CV_8U); // rounds and saturates
+
             raw.clear();
             raw.init(width, height);
-            for (int y = 0; y < height; y++)
-            {
-                for (int x = 0; x < width; x++)
-                {
-                    int c = imago::round(result[y * width + x]);
-                    if (c < 0)
-                        c = 0;
-                    else if (c > 255)
-                        c = 255;
-                    raw.getByte(x, y) = c;
-                }
-            }
+            bytes.copyTo(raw);
 
             getLogExt().appendImage("Retinex-processed image", raw);
 
@@ -314,4 +273,4 @@ namespace imago
             return true;
         }
     }
-}
\ No newline at end of file
+}
@@ -44,7 +44,8 @@ namespace imago
         if (absolute(factor - 1.0) < EPS)
             return;
 
-        getLogExt().append("Distance map adjust for " + sym_set, factor);
+        if (getLogExt().loggingEnabled())
+            getLogExt().append("Distance map adjust for " + sym_set, factor);
 
         for (size_t u = 0; u < sym_set.size(); u++)
             if (this->find(sym_set[u]) != this->end())
@@ -55,6 +55,4 @@ namespace imago
         /// multiply distance for specified sym_set by factor
         void adjust(double factor, const std::string& sym_set);
     };
-
-    typedef std::map<qword, RecognitionDistance> RecognitionDistanceCacheType;
 }
@@ -0,0 +1,127 @@
+/****************************************************************************
+ * Copyright (C) from 2009 to Present EPAM Systems.
+ *
+ * This file is part of Imago toolkit.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ ***************************************************************************/
+
+#include "recognition_statistics.h"
+
+#include <sstream>
+
+namespace imago
+{
+    static const char* STAGE_NAMES[RecognitionStatistics::STAGES_COUNT] = {"prefilter",
+                                                                           "segmentation",
+                                                                           "wedge_extraction",
+                                                                           "separation",
+                                                                           "caption_removal",
+                                                                           "label_combining",
+                                                                           "vectorization",
+                                                                           "skeleton_modification",
+                                                                           "label_mapping",
+                                                                           "superatom_expansion"};
+
+#if (_MSC_VER >= 1800)
+    __declspec(thread) RecognitionStatistics* boundStatistics = NULL;
+#else
+    thread_local RecognitionStatistics* boundStatistics = NULL;
+#endif
+
+    RecognitionStatistics::RecognitionStatistics()
+    {
+        clear();
+    }
+
+    void RecognitionStatistics::clear()
+    {
+        for (int u = 0; u < STAGES_COUNT; u++)
+            stageMs[u] = 0.0;
+
+        filterIndex = -1;
+        filterName.clear();
+
+        segments = symbols = graphics = captions = 0;
+        templatesCompared = glyphCacheHits = glyphCacheMisses = 0;
+
+        _active = -1;
+    }
+
+    int RecognitionStatistics::switchStage(int stage)
+    {
+        std::chrono::steady_clock::time_point now = std::chrono::steady_clock::now();
+        if (_active >= 0)
+            stageMs[_active] += std::chrono::duration<double, std::milli>(now - _since).count();
+
+        int previous = _active;
+        _active = stage;
+        _since = now;
+        return previous;
+    }
+
+    std::string RecognitionStatistics::toJson() const
+    {
+        std::ostringstream out;
+        double total = 0.0;
+
+        out << "{\"stages_ms\":{";
+        for (int u = 0; u < STAGES_COUNT; u++)
+        {
+            out << (u ? "," : "") << "\"" << STAGE_NAMES[u] << "\":" << stageMs[u];
+            total += stageMs[u];
+        }
+        out << "},\"total_ms\":" << total;
+
+        // filter names are plain identifiers, no escaping required
+        out << ",\"filter\":{\"index\":" << filterIndex << ",\"name\":\"" << filterName << "\"}";
+
+        out << ",\"counters\":{\"segments\":" << segments << ",\"symbols\":" << symbols << ",\"graphics\":" << graphics
+            << ",\"captions\":" << captions << ",\"templates_compared\":" << templatesCompared << ",\"glyph_cache_hits\":" << glyphCacheHits
+            << ",\"glyph_cache_misses\":" << glyphCacheMisses << "}}";
+
+        return out.str();
+    }
+
+    const char* RecognitionStatistics::getStageName(int stage)
+    {
+        return (stage >= 0 && stage < STAGES_COUNT) ? STAGE_NAMES[stage] : "";
+    }
+
+    RecognitionStatistics* getThreadStatistics()
+    {
+        return boundStatistics;
+    }
+
+    StatisticsScope::StatisticsScope(RecognitionStatistics& statistics) : _previous(boundStatistics)
+    {
+        boundStatistics = &statistics;
+    }
+
+    StatisticsScope::~StatisticsScope()
+    {
+        boundStatistics = _previous;
+    }
+
+    StageTimer::StageTimer(RecognitionStatistics::Stage stage) : _statistics(boundStatistics), _outer(-1)
+    {
+        if (_statistics)
+            _outer = _statistics->switchStage(stage);
+    }
+
+    StageTimer::~StageTimer()
+    {
+        if (_statistics)
+            _statistics->switchStage(_outer);
+    }
+}
@@ -0,0 +1,113 @@
+/****************************************************************************
+ * Copyright (C) from 2009 to Present EPAM Systems.
+ *
+ * This file is part of Imago toolkit.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ ***************************************************************************/
+
+/**
+ * @file recognition_statistics.h
+ *
+ * @brief   Declares always available stage timings and counters of the recognition
+ */
+
+#pragma once
+
+#include <chrono>
+#include <string>
+
+#include "comdef.h"
+
+namespace imago
+{
+    // wall time of pipeline stages and work counters, collected without the debug log.
+    // nested stages are exclusive: time of the inner stage is not added to the outer one
+    class RecognitionStatistics
+    {
+    public:
+        enum Stage
+        {
+            stPrefilter,
+            stSegmentation,
+            stWedgeExtraction,
+            stSeparation,
+            stCaptionRemoval,
+            stLabelCombining,
+            stVectorization,
+            stSkeletonModification,
+            stLabelMapping,
+            stSuperatomExpansion,
+            STAGES_COUNT
+        };
+
+        double stageMs[STAGES_COUNT];
+
+        int filterIndex; // -1 if the image was not prefiltered
+        std::string filterName;
+
+        int segments;
+        int symbols;
+        int graphics;
+        int captions; // caption blocks removed from the image
+        qword templatesCompared;
+        qword glyphCacheHits;
+        qword glyphCacheMisses;
+
+        RecognitionStatistics();
+
+        void clear();
+
+        // makes the stage active, returns the previously active one (-1 if none)
+        int switchStage(int stage);
+
+        // single line JSON object with all the fields
+        std::string toJson() const;
+
+        static const char* getStageName(int stage);
+
+    private:
+        int _active;
+        std::chrono::steady_clock::time_point _since;
+    };
+
+    // statistics collected in the calling thread, NULL if nobody collects them
+    RecognitionStatistics* getThreadStatistics();
+
+    // binds statistics to the calling thread for the scope lifetime
+    class StatisticsScope
+    {
+    public:
+        explicit StatisticsScope(RecognitionStatistics& statistics);
+        ~StatisticsScope();
+
+    private:
+        RecognitionStatistics* _previous;
+
+        StatisticsScope(const StatisticsScope&);
+    };
+
+    // counts the scope wall time into the stage of the thread statistics, if any
+    class StageTimer
+    {
+    public:
+        explicit StageTimer(RecognitionStatistics::Stage stage);
+        ~StageTimer();
+
+    private:
+        RecognitionStatistics* _statistics;
+        int _outer;
+
+        StageTimer(const StageTimer&);
+    };
+}
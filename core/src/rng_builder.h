@@ -18,14 +18,23 @@
 
 #pragma once
 
+#include <algorithm>
+#include <cmath>
+#include <map>
+
+#include <opencv2/opencv.hpp>
+
 #include "comdef.h"
+#include "spatial_index.h"
 #include "stl_fwd.h"
 
 namespace imago
 {
+    // relative neighbourhood graph: points are connected unless a third one is closer to both of them
     class RNGBuilder
     {
     public:
+        // brute force, O(n^3) time and O(n^2) memory
         template <class EuclideanGraph>
         static void build(EuclideanGraph& g)
         {
@@ -86,5 +95,121 @@ namespace imago
                 }
             }
         }
+
+        // the same graph from the Delaunay triangulation, O(n log n) for points in general position.
+        // a relative neighbours pair has no other points in the closed circle on it as on a diameter,
+        // so it is a Delaunay edge. the triangulation is done in float precision, so the graph is
+        // exact while the points are representable as floats (segment centers are)
+        template <class EuclideanGraph>
+        static void buildDelaunay(EuclideanGraph& g)
+        {
+            int n = (int)g.vertexCount();
+
+            std::vector<typename EuclideanGraph::vertex_descriptor> ind2vert(n);
+            Points2d positions(n);
+
+            int i = 0;
+            for (typename EuclideanGraph::vertex_iterator begin = g.vertexBegin(), end = g.vertexEnd(); begin != end; ++begin)
+            {
+                typename EuclideanGraph::vertex_descriptor v = *begin;
+                ind2vert[i] = v;
+                positions[i] = g.getVertexPosition(v);
+                g.setVertexIndex(v, i++);
+            }
+
+            if (n < 2)
+                return;
+
+            // points with the same float position share the triangulation vertex
+            std::map<std::pair<float, float>, int> sites;
+            std::vector<std::vector<int>> members;
+            double min_x = positions[0].x, min_y = positions[0].y, max_x = min_x, max_y = min_y;
+            for (int i = 0; i < n; i++)
+            {
+                std::pair<float, float> key((float)positions[i].x, (float)positions[i].y);
+                auto site = sites.insert(std::make_pair(key, (int)members.size()));
+                if (site.second)
+                    members.push_back(std::vector<int>());
+                members[site.first->second].push_back(i);
+
+                min_x = std::min(min_x, positions[i].x);
+                min_y = std::min(min_y, positions[i].y);
+                max_x = std::max(max_x, positions[i].x);
+                max_y = std::max(max_y, positions[i].y);
+            }
+
+            std::vector<IntPair> candidates;
+            for (size_t s = 0; s < members.size(); s++)
+            {
+                for (size_t a = 0; a < members[s].size(); a++)
+                    for (size_t b = a + 1; b < members[s].size(); b++)
+                        candidates.push_back(IntPair(members[s][a], members[s][b]));
+            }
+
+            if (members.size() > 1)
+            {
+                int left = (int)floor(min_x) - 1, top = (int)floor(min_y) - 1;
+                cv::Subdiv2D subdiv(cv::Rect(left, top, (int)ceil(max_x) - left + 2, (int)ceil(max_y) - top + 2));
+                for (auto it = sites.begin(); it != sites.end(); ++it)
+                    subdiv.insert(cv::Point2f(it->first.first, it->first.second));
+
+                // edges to the outer vertices of the triangulation are not found among the sites
+                std::vector<cv::Vec4f> edges;
+                subdiv.getEdgeList(edges);
+                for (size_t e = 0; e < edges.size(); e++)
+                {
+                    auto org = sites.find(std::make_pair(edges[e][0], edges[e][1]));
+                    auto dst = sites.find(std::make_pair(edges[e][2], edges[e][3]));
+                    if (org == sites.end() || dst == sites.end() || org == dst)
+                        continue;
+
+                    for (int a : members[org->second])
+                        for (int b : members[dst->second])
+                            candidates.push_back(IntPair(std::min(a, b), std::max(a, b)));
+                }
+            }
+
+            std::sort(candidates.begin(), candidates.end());
+            candidates.erase(std::unique(candidates.begin(), candidates.end()), candidates.end());
+
+            // the lune of a pair lies within sqrt(3) / 2 of the distance from its middle
+            SpatialIndex index(std::max(sqrt((max_x - min_x) * (max_y - min_y) / n), std::max(max_x - min_x, max_y - min_y) / n));
+            for (int i = 0; i < n; i++)
+                index.insert(positions[i], i);
+
+            std::vector<size_t> found;
+            for (size_t c = 0; c < candidates.size(); c++)
+            {
+                int i = candidates[c].first, j = candidates[c].second;
+                double d = Vec2d::distance(positions[i], positions[j]);
+
+                Vec2d middle;
+                middle.middle(positions[i], positions[j]);
+                index.queryRadius(middle, d * 0.8660254037844387 * (1 + 1e-9), found);
+
+                bool add_edge = true;
+                for (size_t f = 0; f < found.size(); f++)
+                {
+                    int k = (int)found[f];
+                    if (k != i && k != j && d > std::max(Vec2d::distance(positions[i], positions[k]), Vec2d::distance(positions[k], positions[j])))
+                    {
+                        add_edge = false;
+                        break;
+                    }
+                }
+
+                if (add_edge)
+                {
+                    std::pair<typename EuclideanGraph::edge_descriptor, bool> added = g.addEdge(ind2vert[i], ind2vert[j]);
+
+                    if (!added.second)
+                    {
+                        getLogExt().appendText("Warning: <RNG::buildDelaunay> edge is not added");
+                    }
+
+                    g.setWeight(added.first, d);
+                }
+            }
+        }
     };
 }
@@ -0,0 +1,53 @@
+/****************************************************************************
+ * Copyright (C) from 2009 to Present EPAM Systems.
+ *
+ * This file is part of Imago toolkit.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ ***************************************************************************/
+
+#include "segment_arena.h"
+
+#include <climits>
+
+namespace imago
+{
+    SegmentArena::SegmentArena(size_t pixels) : _used(0)
+    {
+        if (pixels > 0 && pixels <= (size_t)INT_MAX)
+            _buffer = cv::Mat1b(1, (int)pixels, (byte)255);
+    }
+
+    Segment* SegmentArena::create(int width, int height, int x, int y)
+    {
+        Segment* s = new Segment();
+        size_t pixels = (size_t)width * height;
+
+        if (pixels > 0 && _used + pixels <= (size_t)_buffer.cols)
+        {
+            // a continuous row range reshaped to the segment size, shares the buffer reference counter
+            cv::Mat1b& view = *s;
+            view = _buffer.colRange((int)_used, (int)(_used + pixels)).reshape(1, height);
+            _used += pixels;
+        }
+        else
+        {
+            s->init(width, height);
+            s->fillWhite();
+        }
+
+        s->getX() = x;
+        s->getY() = y;
+        return s;
+    }
+}
@@ -0,0 +1,51 @@
+/****************************************************************************
+ * Copyright (C) from 2009 to Present EPAM Systems.
+ *
+ * This file is part of Imago toolkit.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ ***************************************************************************/
+
+/**
+ * @file segment_arena.h
+ *
+ * @brief   Declares the shared pixel buffer for segments
+ */
+
+#pragma once
+
+#include <cstddef>
+
+#include "image.h"
+#include "segment.h"
+
+namespace imago
+{
+    // one white pixel buffer carved into many segments, every segment is a view into its own part.
+    // the buffer is reference counted, so it is released in one shot with the last segment using it
+    class SegmentArena
+    {
+    public:
+        // allocates the buffer for segments of the given total pixels count
+        explicit SegmentArena(size_t pixels);
+
+        // returns the new white segment, backed by its own buffer when the arena is exhausted
+        Segment* create(int width, int height, int x, int y);
+
+    private:
+        cv::Mat1b _buffer;
+        size_t _used;
+
+        SegmentArena(const SegmentArena&);
+    };
+}
@@ -47,31 +47,31 @@ namespace imago
             }
             Segment* getVertexSegment(vertex_descriptor v) const
             {
-                return _vertex_indices[v.id]->data.segment;
+                return _vertices[v.id].data.segment;
             }
             const Vec2d& getVertexPosition(vertex_descriptor v) const
             {
-                return _vertex_indices[v.id]->data.position;
+                return _vertices[v.id].data.position;
             }
             size_t getVertexIndex(vertex_descriptor v) const
             {
-                return _vertex_indices[v.id]->data.index;
+                return _vertices[v.id].data.index;
             }
             void setVertexSegment(vertex_descriptor v, Segment* val)
             {
-                _vertex_indices[v.id]->data.segment = val;
+                _vertices[v.id].data.segment = val;
             }
             void setVertexPosition(vertex_descriptor v, const Vec2d& val)
             {
-                _vertex_indices[v.id]->data.position = val;
+                _vertices[v.id].data.position = val;
             }
             void setVertexIndex(vertex_descriptor v, size_t val)
             {
-                _vertex_indices[v.id]->data.index = val;
+                _vertices[v.id].data.index = val;
             }
             void setWeight(edge_descriptor e, double val)
             {
-                _edge_indices[e.id]->data.weight = val;
+                _edges[e.id].data.weight = val;
             }
 
         private:
@@ -307,8 +307,8 @@ void Separator::SeparateStuckedSymbols(const Settings& vars, SegmentDeque& layer
                 imago::ImageDrawUtils::putLineSegment(largeLines, lsegments[2 * i], lsegments[2 * i + 1], 0);
         }
 
-        getLogExt().appendImage(std::string("clustered small lines"), smallLines);
-        getLogExt().appendImage(std::string("clustered large lines"), largeLines);
+        getLogExt().appendImage("clustered small lines", smallLines);
+        getLogExt().appendImage("clustered large lines", largeLines);
     }
 
     std::vector<Rectangle> symbRects;
@@ -544,8 +544,8 @@ void Separator::SeparateStuckedSymbols(const Settings& vars, SegmentDeque& layer
         GraphicsDetector gd2(&cvApprox, round(line_thick / 2.0));
         gd2.detect(vars, _2BClassified, linesegs);
 
-        getLogExt().appendImage(std::string("assembled image"), _2BClassified);
-        getLogExt().appendImage(std::string("assembled segment"), *s);
+        getLogExt().appendImage("assembled image", _2BClassified);
+        getLogExt().appendImage("assembled segment", *s);
 
         if ((int)(linesegs.size() / 2) > LineCount[i])
         {
@@ -578,7 +578,7 @@ void Separator::SeparateStuckedSymbols(const Settings& vars, SegmentDeque& layer
                     for (int m = 0; m < s->getHeight(); m++)
                         for (int n = limit; n < s->getWidth(); n++)
                             s->getByte(n, m) = 255;
-                    getLogExt().appendSegment(std::string("after removing right redudant lines"), *s);
+                    getLogExt().appendSegment("after removing right redudant lines", *s);
                 }
                 else if (xmax < symbRects[i].x)
                 {
@@ -588,7 +588,7 @@ void Separator::SeparateStuckedSymbols(const Settings& vars, SegmentDeque& layer
                     for (int m = 0; m < s->getHeight(); m++)
                         for (int n = 0; n < limit; n++)
                             s->getByte(n, m) = 255;
-                    getLogExt().appendSegment(std::string("after removing left redudant lines"), *s);
+                    getLogExt().appendSegment("after removing left redudant lines", *s);
                 }
                 else if (ymin > symbRects[i].y + symbRects[i].height)
                 {
@@ -598,7 +598,7 @@ void Separator::SeparateStuckedSymbols(const Settings& vars, SegmentDeque& layer
                     for (int m = limit; m < s->getHeight(); m++)
                         for (int n = 0; n < s->getWidth(); n++)
                             s->getByte(n, m) = 255;
-                    getLogExt().appendSegment(std::string("after removing bottom redudant lines"), *s);
+                    getLogExt().appendSegment("after removing bottom redudant lines", *s);
                 }
                 else if (ymax < symbRects[i].y)
                 {
@@ -608,7 +608,7 @@ void Separator::SeparateStuckedSymbols(const Settings& vars, SegmentDeque& layer
                     for (int m = 0; m < limit; m++)
                         for (int n = 0; n < s->getWidth(); n++)
                             s->getByte(n, m) = 255;
-                    getLogExt().appendSegment(std::string("after removing top redudant lines"), *s);
+                    getLogExt().appendSegment("after removing top redudant lines", *s);
                 }
             }
         }
@@ -750,7 +750,7 @@ void Separator::ClassifySegment(const Settings& vars, SegmentDeque& layer_symbol
 
     // if(mark == SEP_SUSPICIOUS || mark == SEP_BOND)
     {
-        ThinFilter2 tfilt(temp);
+        ThinFilter2 tfilt(vars, temp);
         tfilt.apply();
 
         Segment* thinseg = new Segment();
@@ -985,9 +985,7 @@ pre_classify:
             layer_graphics.push_back(s);
             getLogExt().appendText("Classified as graphics on first stage");
         }
-        else if (CharacterRecognizer::like_bonds.find(c) == std::string::npos &&
-                 (vars.dynamic.CapitalHeight < 0 || s->getHeight() > vars.characters.HeightMinBound * vars.dynamic.CapitalHeight &&
-                                                        s->getHeight() < vars.characters.HeightMaxBound * vars.dynamic.CapitalHeight))
+        else if (_firstStageSymbol(vars, *s, c, vars.dynamic.CapitalHeight))
         {
             if (dist < vars.characters.DistanceAbsolutelySure)
             {
@@ -1098,6 +1096,51 @@ int Separator::_getApproximationSegmentsCount(const Settings& vars, Segment* seg
     return (int)lsegments.size();
 }
 
+void Separator::ReestimateCapHeight(Settings& vars, CharacterRecognizer& rec, const SegmentDeque& layer_symbols)
+{
+    logEnterFunction();
+
+    int guessedHeight = -1;
+    if (!_segs.empty())
+    {
+        bool _heightRestricted = false;
+        guessedHeight = _estimateCapHeight(vars, _heightRestricted);
+    }
+    getLogExt().append("Guessed height", guessedHeight);
+
+    double height_sum = 0.0;
+    int height_count = 0;
+
+    for (Segment* s : layer_symbols)
+    {
+        RecognitionDistance rd = rec.recognize(vars, *s, CharacterRecognizer::all + CharacterRecognizer::graphics);
+        double dist;
+        char c = rd.getBest(&dist);
+        if (dist < vars.characters.DistanceAbsolutelySure && CharacterRecognizer::upper.find(c) != std::string::npos &&
+            _firstStageSymbol(vars, *s, c, guessedHeight))
+        {
+            height_sum += s->getHeight();
+            height_count += 1;
+        }
+    }
+
+    if (height_count >= vars.characters.ReestimateMinimalCharacters || (height_count > 0 && guessedHeight < 0))
+        vars.dynamic.CapitalHeight = height_sum / height_count;
+    else if (guessedHeight > 0)
+        vars.dynamic.CapitalHeight = guessedHeight;
+
+    getLogExt().append("Capital height", vars.dynamic.CapitalHeight);
+}
+
+bool Separator::_firstStageSymbol(const Settings& vars, const Segment& seg, char c, double cap_height)
+{
+    if (CharacterRecognizer::like_bonds.find(c) != std::string::npos)
+        return false;
+
+    return cap_height < 0 ||
+           (seg.getHeight() > vars.characters.HeightMinBound * cap_height && seg.getHeight() < vars.characters.HeightMaxBound * cap_height);
+}
+
 int Separator::_estimateCapHeight(const Settings& vars, bool& restrictedHeight)
 {
     logEnterFunction();
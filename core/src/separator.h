@@ -62,6 +62,9 @@ namespace imago
 
         void SeparateStuckedSymbols(const Settings& vars, SegmentDeque& layer_symbols, SegmentDeque& layer_graphics, CharacterRecognizer& rec);
 
+        /// Estimates the capital height again from the segments left after Separate(), as the first stage of it does
+        void ReestimateCapHeight(Settings& vars, CharacterRecognizer& rec, const SegmentDeque& layer_symbols);
+
     private:
         SegmentDeque& _segs;
         const Image& _img;
@@ -76,6 +79,10 @@ namespace imago
 
         int _estimateCapHeight(const Settings& vars, bool& restrictedHeight);
 
+        // first stage rule of Separate() for the segment recognized as c: not like a bond and
+        // within the height bounds of cap_height, negative one means unknown
+        static bool _firstStageSymbol(const Settings& vars, const Segment& seg, char c, double cap_height);
+
         bool _testDoubleBondV(const Settings& vars, Segment& segment);
 
         int _getApproximationSegmentsCount(const Settings& vars, Segment* cur_seg);
@@ -19,9 +19,12 @@
 #include "settings.h"
 
 #include <algorithm>
+#include <chrono>
 #include <cstdio>
 #include <cstring>
 
+#include "cancellation.h"
+#include "glyph_cache.h"
 #include "log_ext.h"
 #include "platform_tools.h"
 #include "scanner.h"
@@ -36,12 +39,16 @@ namespace imago
 
     imago::GeneralSettings::GeneralSettings()
     {
-        LogEnabled = LogVFSEnabled = ExtractCharactersOnly = false;
+        LogEnabled = LogVFSEnabled = ExtractCharactersOnly = ParallelFilters = TiledPage = false;
         UseProbablistics = false;
         OriginalImageWidth = OriginalImageHeight = ImageWidth = ImageHeight = 0;
         ImageAlreadyBinarized = false; // we don't know yet
         ClusterIndex = 0;              // default
-        StartTime = TimeLimit = 0;
+        Deadline = 0;
+        TimeLimit = 0;
+        DeadlineCountdown = 0;
+        DeadlinePassed = false;
+        PCancellation = NULL;
         ExpandAbbreviations = true;
     }
 
@@ -71,6 +78,7 @@ namespace imago
             APPLY(p_estimator);
             APPLY(lab_remover);
             APPLY(retinex);
+            APPLY(page);
 
 #undef APPLY
         }
@@ -105,6 +113,7 @@ namespace imago
             APPLY(p_estimator);
             APPLY(lab_remover);
             APPLY(retinex);
+            APPLY(page);
 
 #undef APPLY
         }
@@ -134,6 +143,8 @@ namespace imago
         ASSIGN_REF(characters.ReestimateMinimalCharacters);
         ASSIGN_REF(characters.MinimalRecognizableHeight);
         ASSIGN_REF(characters.RatioDiffThresh);
+        ASSIGN_REF(characters.PruningTopK);
+        ASSIGN_REF(characters.PruningSignatureMargin);
 
         ASSIGN_REF(csr.DeleteBadTriangles);
         ASSIGN_REF(csr.Dissolve);
@@ -183,6 +194,7 @@ namespace imago
 
         ASSIGN_REF(lcomb.MaximalDistanceFactor);
         ASSIGN_REF(lcomb.MaximalYDistanceFactor);
+        ASSIGN_REF(lcomb.DelaunayRNG);
 
         ASSIGN_REF(main.DissolvingsFactor);
         ASSIGN_REF(main.WarningsRecalcTreshold);
@@ -256,6 +268,17 @@ namespace imago
         ASSIGN_REF(p_estimator.MinRatio2ConsiderGrPr);
         ASSIGN_REF(p_estimator.UsePerimeterNormalization);
 
+        ASSIGN_REF(page.CaptionDistanceFactor);
+        ASSIGN_REF(page.CaptionLineFactor);
+        ASSIGN_REF(page.GraphicsFactor);
+        ASSIGN_REF(page.MaxCandidates);
+        ASSIGN_REF(page.MaxCaptionLines);
+        ASSIGN_REF(page.MinComponentPixels);
+        ASSIGN_REF(page.MinRegionFactor);
+        ASSIGN_REF(page.RegionGapFactor);
+        ASSIGN_REF(page.TileOverlap);
+        ASSIGN_REF(page.TileSize);
+
         ASSIGN_REF(routines.Algebra_IntersectionEps);
         ASSIGN_REF(routines.Algebra_SameLineEps);
         ASSIGN_REF(routines.Circle_AsCharFactor);
@@ -344,6 +367,7 @@ namespace imago
         ASSIGN_REF(retinex.ContrastNominal);
         ASSIGN_REF(retinex.EndIteration);
         ASSIGN_REF(retinex.IterationStep);
+        ASSIGN_REF(retinex.PyramidLevel);
         ASSIGN_REF(retinex.StartIteration);
     }
 
@@ -405,7 +429,8 @@ namespace imago
                         }
                         else
                         {
-                            getLogExt().append("Double value not expected for " + variable, value);
+                            if (getLogExt().loggingEnabled())
+                                getLogExt().append("Double value not expected for " + variable, value);
                             bad_vars++;
                         }
                     }
@@ -424,7 +449,8 @@ namespace imago
                         }
                         else
                         {
-                            getLogExt().append("Value not expected for " + variable, value);
+                            if (getLogExt().loggingEnabled())
+                                getLogExt().append("Value not expected for " + variable, value);
                             bad_vars++;
                         }
                     }
@@ -475,16 +501,7 @@ namespace imago
 
     imago::RecognitionCaches::RecognitionCaches()
     {
-        PCacheSymbolsRecognition = new RecognitionDistanceCacheType();
-    }
-
-    imago::RecognitionCaches::~RecognitionCaches()
-    {
-        if (PCacheSymbolsRecognition)
-        {
-            delete PCacheSymbolsRecognition;
-            PCacheSymbolsRecognition = NULL;
-        }
+        PGlyphCache = &GlyphCache::getInstance();
     }
 
     bool imago::Settings::forceSelectCluster(const std::string& clusterFileName)
@@ -509,23 +526,46 @@ namespace imago
         return false;
     }
 
+    static qword monotonicMs()
+    {
+        return (qword)std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+    }
+
+    // calls of checkTimeLimit() between the clock reads
+    static const int DEADLINE_CHECK_STRIDE = 16;
+
     bool imago::Settings::checkTimeLimit() const
     {
-        if (!general.TimeLimit || !general.StartTime)
+        if (general.PCancellation && general.PCancellation->isCancelled())
+            return true;
+
+        if (!general.Deadline || general.DeadlinePassed)
+            return general.DeadlinePassed;
+
+        if (--general.DeadlineCountdown > 0)
             return false;
-        else
-            return (int)(platform::TICKS() - general.StartTime) > general.TimeLimit;
+
+        general.DeadlineCountdown = DEADLINE_CHECK_STRIDE;
+        general.DeadlinePassed = monotonicMs() >= general.Deadline;
+        return general.DeadlinePassed;
     }
 
     bool imago::Settings::checkTimeLimit()
     {
-        if (general.TimeLimit)
+        if (general.TimeLimit > 0 && !general.Deadline)
         {
-            if (!general.StartTime)
-                general.StartTime = platform::TICKS();
-            return (int)(platform::TICKS() - general.StartTime) > general.TimeLimit;
+            general.Deadline = monotonicMs() + general.TimeLimit;
+            general.DeadlineCountdown = 0;
+            general.DeadlinePassed = false;
         }
-        return false;
+        return static_cast<const Settings*>(this)->checkTimeLimit();
+    }
+
+    void imago::Settings::restartTimeLimit()
+    {
+        general.Deadline = 0;
+        general.DeadlineCountdown = 0;
+        general.DeadlinePassed = false;
     }
 
     void imago::Settings::selectBestCluster()
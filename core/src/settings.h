@@ -25,6 +25,8 @@ namespace imago
 {
     /// ------------------ cluster-independ settings ------------------ ///
 
+    class CancellationToken;
+
     struct GeneralSettings
     {
         int ClusterIndex;
@@ -33,14 +35,20 @@ namespace imago
         int OriginalImageHeight;
         int ImageWidth;
         int ImageHeight;
-        int StartTime;
-        int TimeLimit;
+        qword Deadline; // monotonic ms, set by the first non-const checkTimeLimit() if TimeLimit is given
+        int TimeLimit;  // ms, 0 means no limit
+        mutable int DeadlineCountdown; // checkTimeLimit() calls left until the next clock read
+        mutable bool DeadlinePassed;   // the limit once passed stays passed
+        CancellationToken* PCancellation; // shared between settings copies, NULL if can not be cancelled
         bool LogEnabled;
         bool LogVFSEnabled;
         bool ExtractCharactersOnly;
         bool UseProbablistics;
         bool ImageAlreadyBinarized;
         bool ExpandAbbreviations;
+        bool ParallelFilters; // try all the prefilters concurrently, see recognizeFilterRace()
+        bool TiledPage;       // recognize candidate regions of the page found by PageSegmentator
+        std::string FontDirectory; // additional characters templates, empty means built-in font only
         GeneralSettings();
     };
 
@@ -52,12 +60,13 @@ namespace imago
         DynamicEstimationSettings();
     };
 
+    class GlyphCache;
+
     struct RecognitionCaches // caches for character recognizer, etc
     {
-        RecognitionDistanceCacheType* PCacheSymbolsRecognition;
+        GlyphCache* PGlyphCache; // process-wide by default, shared between settings copies; NULL disables
 
         RecognitionCaches();
-        virtual ~RecognitionCaches();
     };
 
     /// ------------------ cluster-depending settings ------------------ ///
@@ -97,6 +106,7 @@ namespace imago
         int IterationStep;
         int ContrastNominal;
         double ContrastDropPercentage;
+        int PyramidLevel; // solve on the image downscaled 2^PyramidLevel times, 0 solves at full size
     };
 
     struct LabelRemoverSettings // POD
@@ -259,6 +269,8 @@ namespace imago
         double DistanceAbsolutelySure;
         double HeightMinBound;
         double HeightMaxBound;
+        int PruningTopK; // full comparison only for K templates closest by signature, 0 compares all
+        double PruningSignatureMargin; // also keep templates within this fraction of the best signature distance
     };
 
     struct ChemicalStructureRecognizerSettings // POD
@@ -335,6 +347,7 @@ namespace imago
     {
         double MaximalDistanceFactor;
         double MaximalYDistanceFactor;
+        bool DelaunayRNG; // build the symbols graph from the Delaunay triangulation, see RNGBuilder::buildDelaunay()
     };
 
     struct ProbabilitySettings // POD
@@ -347,6 +360,20 @@ namespace imago
         bool UsePerimeterNormalization;
     };
 
+    struct PageSettings // POD
+    {
+        int TileSize;           // side of the square tiles the page is processed by
+        int TileOverlap;        // pixels shared by the neighbour tiles, components are stitched there
+        int MinComponentPixels; // smaller components are treated as noise
+        double RegionGapFactor; // components closer than factor * median component height join one region
+        double MinRegionFactor; // candidate regions span at least factor * median component height both ways
+        int MaxCandidates;      // count of the largest candidate regions recognized in the tiled mode
+        double GraphicsFactor;  // components longer than factor * median component height are graphics
+        int MaxCaptionLines;    // text-only regions of more lines are not captions
+        double CaptionLineFactor;     // line height to median component height ratio
+        double CaptionDistanceFactor; // captions are within factor * median component height from the structure
+    };
+
 #pragma pack(pop)
 
     /// ------------------ end of cluster-depending settings ------------------ ///
@@ -367,10 +394,14 @@ namespace imago
         // loads configuration from file
         bool forceSelectCluster(const std::string& clusterFileName);
 
-        // returns true if timelimit occures
+        // returns true if timelimit occures or the recognition is cancelled,
+        // the steady clock is read once per DEADLINE_CHECK_STRIDE calls, that is cheap enough to call in loops
         bool checkTimeLimit();
         bool checkTimeLimit() const;
 
+        // the time limit will be counted from the next checkTimeLimit() call
+        void restartTimeLimit();
+
         // general settings and caches - shouldn't be loaded from config
         int _configVersion;
         GeneralSettings general;
@@ -397,6 +428,7 @@ namespace imago
         ProbabilitySettings p_estimator;
         LabelRemoverSettings lab_remover;
         RetinexFilterSettings retinex;
+        PageSettings page;
 
         void _fillReferenceMap(ReferenceAssignmentMap& result);
     };
@@ -29,6 +29,7 @@
 #include "log_ext.h"
 #include "multiple_bond_checker.h"
 #include "settings.h"
+#include "spatial_index.h"
 #include "triple_bond_maker.h"
 
 using namespace imago;
@@ -642,12 +643,85 @@ void Skeleton::_findMultiple(const Settings& vars)
         if (_g.getEdgeBond(*ei).type == BT_SINGLE)
             toProcess.push_back(*ei);
 
+    // the checker accepts bonds with the sine of the angle between them not above ParBondsEps,
+    // so the bonds are bucketed by direction and compared with the neighbouring buckets only
+    double max_angle = vars.mbond.ParBondsEps < 1 ? asin(std::max(vars.mbond.ParBondsEps, 0.0)) : PI;
+    int buckets = std::min(64, (int)(PI / (max_angle + 1e-6)));
+    if (buckets < 3)
+        buckets = 1;
+
+    // bucket of the bond direction, -1 for the degenerate bonds which may pass any check
+    auto direction = [&](const Edge& e) -> int {
+        Vec2d b = _g.getVertexPosition(e.m_source), d = _g.getVertexPosition(e.m_target);
+        d.sub(b);
+        double length = _g.getEdgeBond(e).length;
+        if ((d.x == 0 && d.y == 0) || !(length > 0))
+            return -1;
+        double angle = atan2(d.y, d.x);
+        if (angle < 0)
+            angle += PI;
+        return std::min(buckets - 1, (int)(angle / PI * buckets));
+    };
+    auto nearDirections = [&](int a, int b) -> bool {
+        int diff = abs(a - b);
+        return a < 0 || b < 0 || buckets == 1 || diff <= 1 || diff == buckets - 1;
+    };
+
     std::map<Edge, bool> used;
     do
     {
         std::vector<std::pair<Edge, Edge>> doubleBonds;
         std::vector<std::tuple<Edge, Edge, Edge>> tripleBonds;
 
+        // single bonds in the order of edges iteration, candidates are the positions in it
+        std::vector<Edge> singles;
+        std::vector<int> directions;
+        std::vector<size_t> degenerate;
+        SpatialIndex index(bondLength());
+        for (SkeletonGraph::edge_iterator begin = _g.edgeBegin(), end = _g.edgeEnd(); begin != end; ++begin)
+        {
+            if (_g.getEdgeBond(*begin).type != BT_SINGLE)
+                continue;
+
+            size_t pos = singles.size();
+            singles.push_back(*begin);
+            directions.push_back(direction(*begin));
+            if (directions.back() < 0)
+            {
+                degenerate.push_back(pos);
+                continue;
+            }
+
+            Vec2d b = _g.getVertexPosition((*begin).m_source), e = _g.getVertexPosition((*begin).m_target);
+            index.insert(Vec2d(std::min(b.x, e.x), std::min(b.y, e.y)), Vec2d(std::max(b.x, e.x), std::max(b.y, e.y)), pos);
+        }
+
+        // a double bond pair is not farther than maxDoubleDistance of its longer bond,
+        // so the longer bond finds the shorter one within that distance
+        std::vector<std::vector<size_t>> partners(singles.size());
+        std::vector<size_t> found;
+        for (size_t p = 0; p < singles.size(); p++)
+        {
+            if (directions[p] < 0)
+                continue;
+
+            double length = _g.getEdgeBond(singles[p]).length;
+            double dist = _checker.maxDoubleDistance(vars, length) * (1 + 1e-9);
+            Vec2d b = _g.getVertexPosition(singles[p].m_source), e = _g.getVertexPosition(singles[p].m_target);
+            index.query(Vec2d(std::min(b.x, e.x) - dist, std::min(b.y, e.y) - dist), Vec2d(std::max(b.x, e.x) + dist, std::max(b.y, e.y) + dist),
+                        found);
+
+            for (size_t q : found)
+            {
+                if (q != p && nearDirections(directions[p], directions[q]) && _g.getEdgeBond(singles[q]).length <= length)
+                {
+                    partners[p].push_back(q);
+                    partners[q].push_back(p);
+                }
+            }
+        }
+
+        std::vector<size_t> candidates;
         size_t end = toProcess.size();
         for (int ii = 0; ii < end; ii++)
         {
@@ -658,10 +732,26 @@ void Skeleton::_findMultiple(const Settings& vars)
             if (used[i])
                 continue;
 
-            for (SkeletonGraph::edge_iterator begin = _g.edgeBegin(), end = _g.edgeEnd(); begin != end; ++begin)
+            size_t pos = std::lower_bound(singles.begin(), singles.end(), i) - singles.begin();
+            int i_direction = direction(i);
+            candidates.clear();
+            if (pos == singles.size() || !(singles[pos] == i) || i_direction < 0)
+            {
+                for (size_t c = 0; c < singles.size(); c++)
+                    candidates.push_back(c);
+            }
+            else
+            {
+                candidates = partners[pos];
+                candidates.insert(candidates.end(), degenerate.begin(), degenerate.end());
+                std::sort(candidates.begin(), candidates.end());
+                candidates.erase(std::unique(candidates.begin(), candidates.end()), candidates.end());
+            }
+
+            for (size_t c = 0; c < candidates.size(); c++)
             {
-                SkeletonGraph::edge_descriptor j = *begin;
-                if (i == j || _g.getEdgeBond(j).type != BT_SINGLE || used[j])
+                Edge j = singles[candidates[c]];
+                if (i == j || used[j])
                     continue;
 
                 if (!_checker.checkDouble(vars, i, j))
@@ -679,13 +769,19 @@ void Skeleton::_findMultiple(const Settings& vars)
 
                     bool is_triple = false;
 
-                    for (SkeletonGraph::edge_iterator begin = _g.edgeBegin(), end = _g.edgeEnd(); begin != end; ++begin)
+                    // the third line is parallel to one of the pair
+                    int j_direction = directions[candidates[c]];
+                    Edge k;
+                    for (size_t t = 0; t < singles.size(); t++)
                     {
-                        SkeletonGraph::edge_descriptor k = *begin;
+                        if (!nearDirections(directions[t], i_direction) && !nearDirections(directions[t], j_direction))
+                            continue;
+
+                        k = singles[t];
                         if (vars.checkTimeLimit())
                             throw ImagoException("Timelimit exceeded");
 
-                        if (k == i || k == j || _g.getEdgeBond(k).type != BT_SINGLE || used[k])
+                        if (k == i || k == j || used[k])
                             continue;
 
                         if (!_checker.checkTriple(vars, k))
@@ -946,51 +1042,91 @@ double Skeleton::_avgEdgeLendth(Vertex v, int& nnei)
 void Skeleton::_joinVertices(double eps)
 {
     logEnterFunction();
-    std::deque<std::deque<Vertex>> nearVertices;
-    std::deque<size_t> join_ind;
 
 #ifdef DEBUG
     LPRINT(0, "joining vertices, eps = %lf", eps);
 #endif /* DEBUG */
 
+    std::vector<Vertex> vertices;
+    std::vector<int> nnei;
+    std::vector<double> avg_edge_len;
     for (SkeletonGraph::vertex_iterator begin = _g.vertexBegin(), end = _g.vertexEnd(); begin != end; ++begin)
     {
-        SkeletonGraph::vertex_descriptor v = *begin;
-        Vec2d v_pos = _g.getVertexPosition(v);
         int v_nnei;
-        double v_avg_edge_len = _avgEdgeLendth(v, v_nnei);
+        vertices.push_back(*begin);
+        avg_edge_len.push_back(_avgEdgeLendth(*begin, v_nnei));
+        nnei.push_back(v_nnei);
+    }
+
+    // the join threshold is a weighted mean of both average lengths, so it never exceeds the larger one
+    // and every pair to join is found by the radius query of one of its vertices
+    double mean_len = 0;
+    for (size_t u = 0; u < avg_edge_len.size(); u++)
+        mean_len += avg_edge_len[u];
+    SpatialIndex index(vertices.empty() ? 0 : eps * mean_len / vertices.size());
+    for (size_t u = 0; u < vertices.size(); u++)
+        index.insert(_g.getVertexPosition(vertices[u]), u);
+
+    // candidates[u] are the vertices before u in the iteration order possibly close to it
+    std::vector<std::vector<size_t>> candidates(vertices.size());
+    std::vector<size_t> found;
+    for (size_t u = 0; u < vertices.size(); u++)
+    {
+        // a little wider for the rounding of the weighted mean
+        index.queryRadius(_g.getVertexPosition(vertices[u]), eps * avg_edge_len[u] * (1 + 1e-9), found);
+        for (size_t k = 0; k < found.size(); k++)
+        {
+            if (found[k] < u)
+                candidates[u].push_back(found[k]);
+            else if (found[k] > u)
+                candidates[found[k]].push_back(u);
+        }
+    }
+
+    // clusters are ordered by creation, merged ones are appended to the earliest and left empty
+    std::vector<std::deque<Vertex>> nearVertices;
+    std::vector<std::vector<size_t>> members;
+    std::vector<size_t> cluster(vertices.size());
+    std::vector<size_t> join_ind;
+
+    for (size_t u = 0; u < vertices.size(); u++)
+    {
+        Vertex v = vertices[u];
+        Vec2d v_pos = _g.getVertexPosition(v);
 
-        for (size_t i = 0; i < nearVertices.size(); i++)
+        for (size_t k = 0; k < candidates[u].size(); k++)
         {
-            for (size_t j = 0; j < nearVertices[i].size(); j++)
-            {
-                const Vertex& nei = nearVertices[i][j];
-                int nei_nnei;
-                double nei_avg_edge_len = _avgEdgeLendth(nei, nei_nnei);
-                double thresh = eps * (nei_nnei * nei_avg_edge_len + v_nnei * v_avg_edge_len) / (v_nnei + nei_nnei);
+            size_t n = candidates[u][k];
+            double thresh = eps * (nnei[n] * avg_edge_len[n] + nnei[u] * avg_edge_len[u]) / (nnei[u] + nnei[n]);
 
-                if (v_nnei + nei_nnei > 0 && Vec2d::distance(v_pos, _g.getVertexPosition(nei)) < thresh)
-                {
-                    join_ind.push_back(i);
-                    break;
-                }
-            }
+            if (nnei[u] + nnei[n] > 0 && Vec2d::distance(v_pos, _g.getVertexPosition(vertices[n])) < thresh)
+                join_ind.push_back(cluster[n]);
         }
+        std::sort(join_ind.begin(), join_ind.end());
+        join_ind.erase(std::unique(join_ind.begin(), join_ind.end()), join_ind.end());
 
         if (join_ind.size() == 0)
         {
+            cluster[u] = nearVertices.size();
             nearVertices.push_back(std::deque<Vertex>(1, v));
+            members.push_back(std::vector<size_t>(1, u));
         }
         else
         {
             size_t first = join_ind[0];
             nearVertices[first].push_back(v);
+            members[first].push_back(u);
+            cluster[u] = first;
 
             for (size_t i = join_ind.size() - 1; i >= 1; i--)
             {
                 size_t ii = join_ind[i];
                 nearVertices[first].insert(nearVertices[first].end(), nearVertices[ii].begin(), nearVertices[ii].end());
-                nearVertices.erase(nearVertices.begin() + ii);
+                nearVertices[ii].clear();
+                for (size_t k = 0; k < members[ii].size(); k++)
+                    cluster[members[ii][k]] = first;
+                members[first].insert(members[first].end(), members[ii].begin(), members[ii].end());
+                members[ii].clear();
             }
         }
         join_ind.clear();
@@ -999,7 +1135,7 @@ void Skeleton::_joinVertices(double eps)
     for (size_t i = 0; i < nearVertices.size(); i++)
     {
         size_t size = nearVertices[i].size();
-        if (size == 1)
+        if (size <= 1)
             continue;
 
         Vec2d newPos;
@@ -1089,25 +1225,45 @@ void Skeleton::_connectBridgedBonds(const Settings& vars)
     getLogExt().append("Group size of edges which could bridge:", edge_groups_k.size());
     std::deque<std::pair<Edge, Edge>> edges_to_connect;
 
+    double LineS = vars.dynamic.LineThickness;
+    double blockS = LineS * vars.skeleton.ConnectBlockS;
+    std::vector<size_t> found;
+
     // check edges to be connected
     for (size_t i = 0; i < edge_groups_k.size(); i++)
     {
         size_t gr_count = edge_groups_k[i].size();
         if (gr_count == 1)
             continue;
-        std::deque<Edge> otherE;
-        for (size_t k = 0; k < edge_groups_k.size(); k++)
+
+        // an edge closer than blockS to an end of another one intersects its bounding box widened by blockS
+        SpatialIndex index(blockS);
+        for (size_t k = 0; k < gr_count; k++)
         {
-            if (k != i)
-                otherE.insert(otherE.end(), edge_groups_k[k].begin(), edge_groups_k[k].end());
+            Vec2d p1 = getVertexPos(getBondBegin(edge_groups_k[i][k]));
+            Vec2d p2 = getVertexPos(getBondEnd(edge_groups_k[i][k]));
+            index.insert(Vec2d(std::min(p1.x, p2.x), std::min(p1.y, p2.y)), Vec2d(std::max(p1.x, p2.x), std::max(p1.y, p2.y)), k);
         }
-        for (int k = 0; k < gr_count; k++)
+
+        // edges of the other groups are needed for the candidate pairs only
+        std::deque<Edge> otherE;
+        bool otherE_ready = false;
+
+        for (size_t k = 0; k < gr_count; k++)
         {
             Vec2d p1 = getVertexPos(getBondBegin(edge_groups_k[i][k]));
             Vec2d p2 = getVertexPos(getBondEnd(edge_groups_k[i][k]));
 
-            for (int l = k + 1; l < gr_count; l++)
+            double margin = blockS * (1 + 1e-9);
+            index.query(Vec2d(std::min(p1.x, p2.x) - margin, std::min(p1.y, p2.y) - margin),
+                        Vec2d(std::max(p1.x, p2.x) + margin, std::max(p1.y, p2.y) + margin), found);
+
+            for (size_t f = 0; f < found.size(); f++)
             {
+                size_t l = found[f];
+                if (l <= k)
+                    continue;
+
                 if (vars.checkTimeLimit())
                     throw ImagoException("Timelimit exceeded");
 
@@ -1119,9 +1275,6 @@ void Skeleton::_connectBridgedBonds(const Settings& vars)
 
                 double min = d1 < d2 ? d1 : d2;
 
-                double LineS = vars.dynamic.LineThickness;
-                double blockS = LineS * vars.skeleton.ConnectBlockS;
-
                 Vec2d nearP1, nearP2;
                 if (d1 < d2)
                     nearP1 = p1;
@@ -1136,12 +1289,24 @@ void Skeleton::_connectBridgedBonds(const Settings& vars)
                 else
                     nearP2 = sp2;
 
-                if (min < blockS && min > vars.skeleton.ConnectFactor * LineS && Algebra::SegmentsOnSameLine(vars, p1, p2, sp1, sp2) &&
-                    _isSegmentIntersectedByEdge(vars, nearP1, nearP2, otherE))
+                if (min < blockS && min > vars.skeleton.ConnectFactor * LineS && Algebra::SegmentsOnSameLine(vars, p1, p2, sp1, sp2))
                 {
-                    getLogExt().appendText("Candidate edges for bridge connections");
-                    getLogExt().append("Distance", min);
-                    edges_to_connect.push_back(std::pair<Edge, Edge>(edge_groups_k[i][l], edge_groups_k[i][k]));
+                    if (!otherE_ready)
+                    {
+                        for (size_t g = 0; g < edge_groups_k.size(); g++)
+                        {
+                            if (g != i)
+                                otherE.insert(otherE.end(), edge_groups_k[g].begin(), edge_groups_k[g].end());
+                        }
+                        otherE_ready = true;
+                    }
+
+                    if (_isSegmentIntersectedByEdge(vars, nearP1, nearP2, otherE))
+                    {
+                        getLogExt().appendText("Candidate edges for bridge connections");
+                        getLogExt().append("Distance", min);
+                        edges_to_connect.push_back(std::pair<Edge, Edge>(edge_groups_k[i][l], edge_groups_k[i][k]));
+                    }
                 }
             }
         }
@@ -77,19 +77,19 @@ namespace imago
             }
             const Vec2d& getVertexPosition(vertex_descriptor v) const
             {
-                return _vertex_indices[v.id]->data.position;
+                return _vertices[v.id].data.position;
             }
             void setVertexPosition(vertex_descriptor v, const Vec2d& val)
             {
-                _vertex_indices[v.id]->data.position = val;
+                _vertices[v.id].data.position = val;
             }
             Bond getEdgeBond(edge_descriptor e) const
             {
-                return _edge_indices[e.id]->data.bond;
+                return _edges[e.id].data.bond;
             }
             void setEdgeBond(edge_descriptor e, Bond& val)
             {
-                _edge_indices[e.id]->data.bond = val;
+                _edges[e.id].data.bond = val;
             }
         };
 
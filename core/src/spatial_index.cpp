@@ -0,0 +1,211 @@
+/****************************************************************************
+ * Copyright (C) from 2009 to Present EPAM Systems.
+ *
+ * This file is part of Imago toolkit.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ ***************************************************************************/
+
+#include "spatial_index.h"
+
+#include <algorithm>
+#include <climits>
+#include <cmath>
+
+namespace imago
+{
+    SpatialIndex::SpatialIndex(double cell_size) : _cell_size(cell_size > 0 ? cell_size : 1.0)
+    {
+        clear();
+    }
+
+    long long SpatialIndex::_cell(double coord) const
+    {
+        return (long long)floor(coord / _cell_size);
+    }
+
+    unsigned long long SpatialIndex::_key(long long x, long long y)
+    {
+        return ((unsigned long long)(unsigned int)x << 32) | (unsigned int)y;
+    }
+
+    template <class Routine>
+    void SpatialIndex::_forCells(const Vec2d& min, const Vec2d& max, Routine routine) const
+    {
+        long long x1 = _cell(min.x), x2 = _cell(max.x);
+        long long y1 = _cell(min.y), y2 = _cell(max.y);
+
+        // a wide box visits the occupied cells only
+        if ((double)(x2 - x1 + 1) * (y2 - y1 + 1) > _cells.size())
+        {
+            for (Cells::const_iterator it = _cells.begin(); it != _cells.end(); ++it)
+                routine(it->second);
+            return;
+        }
+
+        for (long long y = y1; y <= y2; y++)
+        {
+            for (long long x = x1; x <= x2; x++)
+            {
+                Cells::const_iterator it = _cells.find(_key(x, y));
+                if (it != _cells.end())
+                    routine(it->second);
+            }
+        }
+    }
+
+    void SpatialIndex::insert(const Vec2d& pos, size_t id)
+    {
+        insert(pos, pos, id);
+    }
+
+    void SpatialIndex::insert(const Vec2d& min, const Vec2d& max, size_t id)
+    {
+        Item item;
+        item.min = min;
+        item.max = max;
+        item.id = id;
+
+        _min_x = std::min(_min_x, _cell(min.x));
+        _min_y = std::min(_min_y, _cell(min.y));
+        _max_x = std::max(_max_x, _cell(max.x));
+        _max_y = std::max(_max_y, _cell(max.y));
+
+        for (long long y = _cell(min.y), y2 = _cell(max.y); y <= y2; y++)
+            for (long long x = _cell(min.x), x2 = _cell(max.x); x <= x2; x++)
+                _cells[_key(x, y)].push_back(item);
+    }
+
+    void SpatialIndex::erase(const Vec2d& pos, size_t id)
+    {
+        erase(pos, pos, id);
+    }
+
+    void SpatialIndex::erase(const Vec2d& min, const Vec2d& max, size_t id)
+    {
+        for (long long y = _cell(min.y), y2 = _cell(max.y); y <= y2; y++)
+        {
+            for (long long x = _cell(min.x), x2 = _cell(max.x); x <= x2; x++)
+            {
+                Cells::iterator it = _cells.find(_key(x, y));
+                if (it == _cells.end())
+                    continue;
+
+                std::vector<Item>& items = it->second;
+                for (size_t u = 0; u < items.size(); u++)
+                {
+                    if (items[u].id == id)
+                    {
+                        items[u] = items.back();
+                        items.pop_back();
+                        break;
+                    }
+                }
+                if (items.empty())
+                    _cells.erase(it);
+            }
+        }
+    }
+
+    void SpatialIndex::clear()
+    {
+        _cells.clear();
+        _min_x = _min_y = LLONG_MAX;
+        _max_x = _max_y = LLONG_MIN;
+    }
+
+    void SpatialIndex::query(const Vec2d& min, const Vec2d& max, std::vector<size_t>& ids) const
+    {
+        ids.clear();
+        _forCells(min, max, [&](const std::vector<Item>& items) {
+            for (size_t u = 0; u < items.size(); u++)
+            {
+                const Item& item = items[u];
+                if (item.min.x <= max.x && item.max.x >= min.x && item.min.y <= max.y && item.max.y >= min.y)
+                    ids.push_back(item.id);
+            }
+        });
+
+        std::sort(ids.begin(), ids.end());
+        ids.erase(std::unique(ids.begin(), ids.end()), ids.end());
+    }
+
+    void SpatialIndex::queryRadius(const Vec2d& center, double radius, std::vector<size_t>& ids) const
+    {
+        ids.clear();
+        Vec2d min(center.x - radius, center.y - radius), max(center.x + radius, center.y + radius);
+        _forCells(min, max, [&](const std::vector<Item>& items) {
+            for (size_t u = 0; u < items.size(); u++)
+            {
+                const Item& item = items[u];
+                double dx = std::max(0.0, std::max(item.min.x - center.x, center.x - item.max.x));
+                double dy = std::max(0.0, std::max(item.min.y - center.y, center.y - item.max.y));
+                if (dx * dx + dy * dy <= radius * radius)
+                    ids.push_back(item.id);
+            }
+        });
+
+        std::sort(ids.begin(), ids.end());
+        ids.erase(std::unique(ids.begin(), ids.end()), ids.end());
+    }
+
+    void SpatialIndex::queryStrip(const Vec2d& a, const Vec2d& b, double half_width, std::vector<size_t>& ids) const
+    {
+        ids.clear();
+        if (_cells.empty())
+            return;
+
+        auto collect = [&](const std::vector<Item>& items) {
+            for (size_t u = 0; u < items.size(); u++)
+                ids.push_back(items[u].id);
+        };
+
+        double dx = b.x - a.x, dy = b.y - a.y;
+        if (dx == 0 && dy == 0)
+        {
+            for (Cells::const_iterator it = _cells.begin(); it != _cells.end(); ++it)
+                collect(it->second);
+        }
+        else
+        {
+            // walks the cells across the line: columns for the flat lines, rows for the steep ones
+            bool flat = fabs(dx) >= fabs(dy);
+            double along = flat ? dx : dy, across = flat ? dy : dx;
+            double a_along = flat ? a.x : a.y, a_across = flat ? a.y : a.x;
+            double extent = half_width * sqrt(dx * dx + dy * dy) / fabs(along);
+            long long first = flat ? _min_x : _min_y, last = flat ? _max_x : _max_y;
+            long long low = flat ? _min_y : _min_x, high = flat ? _max_y : _max_x;
+
+            for (long long c = first; c <= last; c++)
+            {
+                double c1 = a_across + (c * _cell_size - a_along) * across / along;
+                double c2 = a_across + ((c + 1) * _cell_size - a_along) * across / along;
+                // clamped as doubles, a narrow line gives a huge extent
+                double from_cell = floor((std::min(c1, c2) - extent) / _cell_size);
+                double to_cell = floor((std::max(c1, c2) + extent) / _cell_size);
+                long long from = from_cell < low ? low : (long long)std::min(from_cell, (double)high + 1);
+                long long to = to_cell > high ? high : (long long)std::max(to_cell, (double)low - 1);
+
+                for (long long r = from; r <= to; r++)
+                {
+                    Cells::const_iterator it = _cells.find(flat ? _key(c, r) : _key(r, c));
+                    if (it != _cells.end())
+                        collect(it->second);
+                }
+            }
+        }
+
+        std::sort(ids.begin(), ids.end());
+        ids.erase(std::unique(ids.begin(), ids.end()), ids.end());
+    }
+}
@@ -0,0 +1,83 @@
+/****************************************************************************
+ * Copyright (C) from 2009 to Present EPAM Systems.
+ *
+ * This file is part of Imago toolkit.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ ***************************************************************************/
+
+/**
+ * @file spatial_index.h
+ *
+ * @brief   Declares the uniform grid for neighbourhood queries
+ */
+
+#pragma once
+
+#include <cstddef>
+#include <unordered_map>
+#include <vector>
+
+#include "vec2d.h"
+
+namespace imago
+{
+    // uniform grid of points and axis-aligned boxes, items are identified by the caller's ids.
+    // a box is registered in every cell it covers, so cell size should be about the query radius.
+    // query results are sorted by id and unique, the callers keep the order of a full scan this way
+    class SpatialIndex
+    {
+    public:
+        // non-positive cell size falls back to one pixel
+        explicit SpatialIndex(double cell_size);
+
+        void insert(const Vec2d& pos, size_t id);
+        void insert(const Vec2d& min, const Vec2d& max, size_t id);
+
+        // coordinates should be the ones given on insertion
+        void erase(const Vec2d& pos, size_t id);
+        void erase(const Vec2d& min, const Vec2d& max, size_t id);
+
+        void clear();
+
+        // ids of items intersecting the closed box
+        void query(const Vec2d& min, const Vec2d& max, std::vector<size_t>& ids) const;
+
+        // ids of items not farther than radius from the center
+        void queryRadius(const Vec2d& center, double radius, std::vector<size_t>& ids) const;
+
+        // ids of items in the cells crossed by the band of half_width around the whole line through a and b,
+        // a superset of the items within half_width of the line. all items if a and b coincide
+        void queryStrip(const Vec2d& a, const Vec2d& b, double half_width, std::vector<size_t>& ids) const;
+
+    private:
+        struct Item
+        {
+            Vec2d min, max;
+            size_t id;
+        };
+
+        typedef std::unordered_map<unsigned long long, std::vector<Item>> Cells;
+
+        long long _cell(double coord) const;
+        static unsigned long long _key(long long x, long long y);
+
+        // calls routine for every nonempty cell intersecting the box
+        template <class Routine>
+        void _forCells(const Vec2d& min, const Vec2d& max, Routine routine) const;
+
+        double _cell_size;
+        Cells _cells;
+        long long _min_x, _min_y, _max_x, _max_y; // occupied cells range, not shrunk by erase
+    };
+}
@@ -24,6 +24,7 @@
 #include "molecule.h"
 #include "molfile_saver.h"
 #include "output.h"
+#include "recognition_statistics.h"
 
 namespace imago
 {
@@ -31,6 +32,7 @@ namespace imago
     std::string expandSuperatoms(const Settings& vars, const Molecule& molecule)
     {
         logEnterFunction();
+        StageTimer timer(RecognitionStatistics::stSuperatomExpansion);
 
         std::string molString;
         ArrayOutput so(molString);
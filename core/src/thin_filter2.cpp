@@ -16,127 +16,173 @@
  * limitations under the License.
  ***************************************************************************/
 
+#include <algorithm>
 #include <vector>
 
+#include "exception.h"
 #include "image.h"
 #include "thin_filter2.h"
 
 using namespace imago;
 
-ThinFilter2::ThinFilter2(Image& I) : _img(I)
+namespace
 {
+    // neighbour planes, the 4-neighbours are even, clockwise from the top one
+    enum
+    {
+        TOP,
+        TOP_RIGHT,
+        RIGHT,
+        BOTTOM_RIGHT,
+        BOTTOM,
+        BOTTOM_LEFT,
+        LEFT,
+        TOP_LEFT
+    };
+
+    // the neighbour which must be white to delete a pixel, one per sub-pass
+    const static int sides[] = {TOP, BOTTOM, LEFT, RIGHT};
+
+    // planes of the x-1 and x+1 neighbours, pixels outside of the row are white
+    inline qword leftOf(const qword* row, int j)
+    {
+        return (row[j] << 1) | (j > 0 ? row[j - 1] >> 63 : 0);
+    }
+
+    inline qword rightOf(const qword* row, int j, int words)
+    {
+        return (row[j] >> 1) | (j + 1 < words ? row[j + 1] << 63 : 0);
+    }
+
+    inline int bitCount(qword v)
+    {
+        v = v - ((v >> 1) & 0x5555555555555555ULL);
+        v = (v & 0x3333333333333333ULL) + ((v >> 2) & 0x3333333333333333ULL);
+        v = (v + (v >> 4)) & 0x0F0F0F0F0F0F0F0FULL;
+        return (int)((v * 0x0101010101010101ULL) >> 56);
+    }
+
+    // pixels with at least two ink neighbours and the 8-connectivity number (Yokoi) of one:
+    // deleting them neither shortens a line end nor splits or merges the ink
+    inline qword deletable(const qword* n)
+    {
+        qword one = 0, two = 0;
+        for (int k = 0; k < 8; k++)
+        {
+            two |= one & n[k];
+            one |= n[k];
+        }
+
+        // a white 4-neighbour followed clockwise by some ink starts a run of ink around the pixel
+        qword runs[4];
+        for (int k = 0; k < 4; k++)
+            runs[k] = ~n[2 * k] & (n[2 * k + 1] | n[(2 * k + 2) & 7]);
+
+        qword any = runs[0] | runs[1] | runs[2] | runs[3];
+        qword several = (runs[0] & (runs[1] | runs[2] | runs[3])) | (runs[1] & (runs[2] | runs[3])) | (runs[2] & runs[3]);
+
+        return two & any & ~several;
+    }
 }
 
-void ThinFilter2::apply()
+ThinFilter2::ThinFilter2(Image& I) : _img(I), _vars(NULL), _words(0)
 {
-    const static int masks[] = {0200, 0002, 0040, 0010};
-    const static byte del[512] = {
-        0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 1, 0, 0, 1, 1, 0, 1, 1, 1, 0, 0, 1, 1, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
-        0, 0, 0, 1, 1, 1, 0, 1, 1, 0, 0, 1, 1, 0, 0, 1, 1, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 1, 1, 1, 1, 0, 0,
-        1, 1, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 1, 1, 0, 0, 1, 1, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
-        0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 1, 1, 1, 1, 0, 0, 1, 1, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 1, 0, 1, 1, 1, 0, 1, 1, 1, 1, 1, 1,
-        1, 1, 1, 1, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 1, 0, 0, 0, 0, 0, 0, 0, 1, 1, 1, 1, 0, 0, 1, 1, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
-        0, 0, 0, 0, 0, 1, 0, 1, 1, 1, 0, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
-        0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 1, 0, 1, 1, 1, 0, 1, 1, 0, 0, 1, 1, 0, 0, 1, 1, 0, 0, 0, 0, 0, 0, 0, 0, 0,
-        0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
-        0, 0, 1, 1, 0, 0, 1, 1, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 1, 0, 0, 0, 0, 0, 0, 0, 1, 1, 1, 1, 0, 0, 1, 1, 0, 0, 0, 0, 0, 0, 0,
-        0, 0, 0, 0, 0, 0, 0, 0, 0, 1, 0, 1, 1, 1, 0, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 1, 0, 0, 0, 0, 0,
-        0, 0, 1, 1, 1, 1, 0, 0, 1, 1, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 1, 0, 1, 1, 1, 0, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1};
-
-    int xsize, ysize;
-    int x, y;
-    int i;
-    int pc = 0;
-    int count = 1;
-    int p, q;
-    int it = 0;
-
-    std::vector<byte> qb;
-    int m;
+}
 
-    xsize = _img.getWidth() + 20;
-    ysize = _img.getHeight() + 20;
+ThinFilter2::ThinFilter2(const Settings& vars, Image& I) : _img(I), _vars(&vars), _words(0)
+{
+}
 
-    _img.invertColor();
+void ThinFilter2::apply()
+{
+    if (_img.getWidth() <= 0 || _img.getHeight() <= 0)
+        return;
 
-    qb.resize(xsize);
-    qb[xsize - 1] = 0;
+    pack();
 
-    while (count && it < 20)
+    int count = 1;
+    for (int it = 0; count && it < 20; it++)
     {
-        pc++;
-        count = 0;
-        it++;
-
-        for (i = 0; i < 4; i++)
-        {
-            m = masks[i];
-
-            p = get(0, 0) != 0;
-            for (x = 0; x < xsize - 1; x++)
-                qb[x] = p = ((p << 1) & 0006) | (get(x + 1, 0) != 0);
-
-            for (y = 0; y < ysize - 1; y++)
-            {
-                q = qb[0];
-                p = ((q << 3) & 0110) | (get(0, y + 1) != 0);
-
-                for (x = 0; x < xsize - 1; x++)
-                {
-                    q = qb[x];
-                    p = ((p << 1) & 0666) | ((q << 3) & 0110) | (get(x + 1, y + 1) != 0);
-                    qb[x] = p;
-                    if (((p & m) == 0) && del[p])
-                    {
-                        count++;
-                        set(x, y, 0);
-                    }
-                }
-
-                p = (p << 1) & 0666;
-                if ((p & m) == 0 && del[p])
-                {
-                    count++;
-                    set(xsize - 1, y, 0);
-                }
-            }
-
-            for (x = 0; x < xsize; x++)
-            {
-                q = qb[x];
-                p = ((p << 1) & 0666) | ((q << 3) & 0110);
-                if ((p & m) == 0 && del[p])
-                {
-                    count++;
-                    set(x, ysize - 1, 0);
-                }
-            }
-        }
+        if (_vars && _vars->checkTimeLimit())
+            throw ImagoException("Timelimit exceeded");
 
-        // printf("ThinImage: pass %d, %d pixels deleted\n", pc, count);
+        count = 0;
+        for (int i = 0; i < 4; i++)
+            count += deletePass(i);
     }
 
-    _img.invertColor();
+    unpack();
 }
 
-inline byte ThinFilter2::get(int x, int y)
+void ThinFilter2::pack()
 {
-    x -= 10;
-    y -= 10;
-    if (x < 0 || y < 0 || x >= _img.getWidth() || y >= _img.getHeight())
-        return 0;
+    _words = (_img.getWidth() + 63) / 64;
+    _bits.assign((_img.getHeight() + 2) * _words, 0);
+    _above.assign(_words, 0);
+    _row.assign(_words, 0);
 
-    return _img.getByte(x, y);
+    for (int y = 0; y < _img.getHeight(); y++)
+    {
+        qword* row = &_bits[(y + 1) * _words];
+        for (int x = 0; x < _img.getWidth(); x++)
+            if (_img.getByte(x, y) != 255)
+                row[x >> 6] |= (qword)1 << (x & 63);
+    }
 }
 
-inline void ThinFilter2::set(int x, int y, byte val)
+void ThinFilter2::unpack()
 {
-    x -= 10;
-    y -= 10;
-    if (x < 0 || y < 0 || x >= _img.getWidth() || y >= _img.getHeight())
-        return;
+    for (int y = 0; y < _img.getHeight(); y++)
+    {
+        const qword* row = &_bits[(y + 1) * _words];
+        for (int x = 0; x < _img.getWidth(); x++)
+            if (((row[x >> 6] >> (x & 63)) & 1) == 0)
+                _img.getByte(x, y) = 255;
+    }
+}
+
+// deletes pixels of one direction, all neighbourhoods are taken before the pass
+int ThinFilter2::deletePass(int direction)
+{
+    int count = 0;
+    const int side = sides[direction];
+
+    std::fill(_above.begin(), _above.end(), 0);
+
+    for (int y = 1; y <= _img.getHeight(); y++)
+    {
+        qword* cur = &_bits[y * _words];
+        const qword* below = &_bits[(y + 1) * _words];
+        std::copy(cur, cur + _words, _row.begin());
+
+        const qword* up = &_above[0];
+        const qword* row = &_row[0];
+
+        for (int j = 0; j < _words; j++)
+        {
+            if (row[j] == 0)
+                continue;
+
+            qword n[8];
+            n[TOP] = up[j];
+            n[TOP_RIGHT] = rightOf(up, j, _words);
+            n[RIGHT] = rightOf(row, j, _words);
+            n[BOTTOM_RIGHT] = rightOf(below, j, _words);
+            n[BOTTOM] = below[j];
+            n[BOTTOM_LEFT] = leftOf(below, j);
+            n[LEFT] = leftOf(row, j);
+            n[TOP_LEFT] = leftOf(up, j);
+
+            qword deleted = row[j] & ~n[side] & deletable(n);
+            count += bitCount(deleted);
+
+            cur[j] &= ~deleted;
+        }
+
+        _above.swap(_row);
+    }
 
-    _img.getByte(x, y) = val;
+    return count;
 }
 
 ThinFilter2::~ThinFilter2()
@@ -24,23 +24,36 @@
 
 #pragma once
 
+#include <vector>
+
 #include "comdef.h"
 #include "image.h"
+#include "settings.h"
 
 namespace imago
 {
+    // thins the ink (non-white pixels) of the image in place, deleted pixels become white.
+    // the ink is bit-packed, 64 pixels per word, neighbourhoods are evaluated word-parallel
     class ThinFilter2
     {
     public:
         ThinFilter2(Image& I);
+        // the filter throws if the time limit of vars occurs between iterations
+        ThinFilter2(const Settings& vars, Image& I);
         void apply();
         ~ThinFilter2();
 
     private:
         Image& _img;
+        const Settings* _vars;
+        int _words;                // words per packed row
+        std::vector<qword> _bits;  // packed ink rows, with an empty row above and below the image
+        std::vector<qword> _above; // unmodified copy of the previous row during the pass
+        std::vector<qword> _row;   // unmodified copy of the current row during the pass
 
         ThinFilter2(const ThinFilter2&);
-        byte get(int x, int y);
-        void set(int x, int y, byte val);
+        void pack();
+        void unpack();
+        int deletePass(int direction);
     };
 }
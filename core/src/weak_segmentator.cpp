@@ -18,8 +18,10 @@
 
 #include "weak_segmentator.h"
 
-#include <queue>
+#include <algorithm>
+#include <cstdlib>
 #include <cstring>
+#include <queue>
 
 #include "log_ext.h"
 #include "pixel_boundings.h"
@@ -52,6 +54,133 @@ namespace imago
         return result;
     }
 
+    // disjoint set of runs, the root is always the earliest run of the set
+    static int findRoot(std::vector<int>& parent, int u)
+    {
+        while (parent[u] != u)
+        {
+            parent[u] = parent[parent[u]];
+            u = parent[u];
+        }
+        return u;
+    }
+
+    static void uniteRuns(std::vector<int>& parent, int a, int b)
+    {
+        a = findRoot(parent, a);
+        b = findRoot(parent, b);
+        if (a < b)
+            parent[b] = a;
+        else if (b < a)
+            parent[a] = b;
+    }
+
+    void WeakSegmentator::labelRuns(const Image& img, int range, RunComponents& components)
+    {
+        components.clear();
+
+        PixelRuns runs;
+        std::vector<int> parent;
+        std::vector<int> row_start(img.getHeight() + 1, 0);
+
+        for (int y = 0; y < img.getHeight(); y++)
+        {
+            const int first = row_start[y] = (int)runs.size();
+
+            for (int x = 0; x < img.getWidth(); x++)
+            {
+                if (!img.isFilled(x, y))
+                    continue;
+
+                PixelRun run;
+                run.y = y;
+                run.x1 = x;
+                while (x + 1 < img.getWidth() && img.isFilled(x + 1, y))
+                    x++;
+                run.x2 = x;
+
+                runs.push_back(run);
+                parent.push_back((int)parent.size());
+            }
+
+            const int last = (int)runs.size();
+
+            // runs of the same row separated by less than range white pixels
+            for (int u = first + 1; u < last; u++)
+                if (runs[u].x1 - runs[u - 1].x2 <= range)
+                    uniteRuns(parent, u - 1, u);
+
+            // runs of the previous rows within the range, both rows are sorted by x
+            for (int d = 1; d <= range && d <= y; d++)
+            {
+                int k = row_start[y - d];
+                const int k_end = row_start[y - d + 1];
+                for (int u = first; u < last; u++)
+                {
+                    while (k < k_end && runs[k].x2 < runs[u].x1 - range)
+                        k++;
+                    for (int j = k; j < k_end && runs[j].x1 <= runs[u].x2 + range; j++)
+                        uniteRuns(parent, j, u);
+                }
+            }
+        }
+
+        // roots precede the rest of their runs, so components get numbered in raster order
+        std::vector<int> index(runs.size());
+        for (size_t u = 0; u < runs.size(); u++)
+        {
+            int root = findRoot(parent, (int)u);
+            if (root == (int)u)
+            {
+                index[u] = (int)components.size();
+                components.push_back(RunComponent());
+                components.back().pixels = 0;
+            }
+            else
+            {
+                index[u] = index[root];
+            }
+
+            RunComponent& c = components[index[u]];
+            c.runs.push_back(runs[u]);
+            c.pixels += runs[u].x2 - runs[u].x1 + 1;
+        }
+
+        for (size_t c = 0; c < components.size(); c++)
+        {
+            const PixelRuns& r = components[c].runs;
+            int min_x = r[0].x1, max_x = r[0].x2;
+            for (size_t u = 1; u < r.size(); u++)
+            {
+                min_x = std::min(min_x, r[u].x1);
+                max_x = std::max(max_x, r[u].x2);
+            }
+            components[c].bounds = Rectangle(min_x, r.front().y, max_x, r.back().y, 0);
+        }
+    }
+
+    bool WeakSegmentator::isSquarePattern(const Points2i& lookup_pattern, int& range)
+    {
+        range = 0;
+        for (size_t u = 0; u < lookup_pattern.size(); u++)
+            range = std::max(range, std::max(abs(lookup_pattern[u].x), abs(lookup_pattern[u].y)));
+
+        const int side = 2 * range + 1;
+        if (range < 1 || (int)lookup_pattern.size() != side * side - 1)
+            return false;
+
+        std::vector<bool> seen(side * side, false);
+        seen[range * side + range] = true;
+        for (size_t u = 0; u < lookup_pattern.size(); u++)
+        {
+            int idx = (lookup_pattern[u].y + range) * side + lookup_pattern[u].x + range;
+            if (seen[idx])
+                return false;
+            seen[idx] = true;
+        }
+        return true;
+    }
+
     void WeakSegmentator::decorner(Image& img, byte set_to)
     {
         logEnterFunction();
@@ -77,14 +206,39 @@ namespace imago
 
         int added_pixels = 0;
 
-        for (int y = 0; y < height(); y++)
-            for (int x = 0; x < width(); x++)
-                if (at(x, y) == 0 && (img.getByte(x, y) != 255))
-                {
-                    int id = (int)SegmentPoints.size() + 1;
-                    fill(img, id, x, y, lookup_pattern, reconnect);
-                    added_pixels += (int)SegmentPoints[id].size();
-                }
+        // reconnection adds middle points of long jumps, flood fill is required for it
+        int range = 0;
+        if (SegmentPoints.empty() && img.getWidth() == width() && img.getHeight() == height() && isSquarePattern(lookup_pattern, range) &&
+            (range == 1 || !reconnect))
+        {
+            RunComponents components;
+            labelRuns(img, range, components);
+
+            for (size_t c = 0; c < components.size(); c++)
+            {
+                int id = (int)SegmentPoints.size() + 1;
+                Points2i& points = SegmentPoints[id];
+                points.reserve(components[c].pixels);
+                for (PixelRuns::const_iterator it = components[c].runs.begin(); it != components[c].runs.end(); ++it)
+                    for (int x = it->x1; x <= it->x2; x++)
+                    {
+                        at(x, it->y) = id;
+                        points.push_back(Vec2i(x, it->y));
+                    }
+                added_pixels += components[c].pixels;
+            }
+        }
+        else
+        {
+            for (int y = 0; y < height(); y++)
+                for (int x = 0; x < width(); x++)
+                    if (at(x, y) == 0 && (img.getByte(x, y) != 255))
+                    {
+                        int id = (int)SegmentPoints.size() + 1;
+                        fill(img, id, x, y, lookup_pattern, reconnect);
+                        added_pixels += (int)SegmentPoints[id].size();
+                    }
+        }
 
         getLogExt().append("Currently added pixels", added_pixels);
         getLogExt().append("Total segments count", SegmentPoints.size());
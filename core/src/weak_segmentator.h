@@ -29,6 +29,24 @@
 
 namespace imago
 {
+    // horizontal run of filled pixels from x1 to x2 inclusive in the row y
+    struct PixelRun
+    {
+        int y, x1, x2;
+    };
+
+    typedef std::vector<PixelRun> PixelRuns;
+
+    // connected component stored as its runs, ordered by rows then columns
+    struct RunComponent
+    {
+        Rectangle bounds; // the same as RectShapedBounding of the component pixels
+        int pixels;
+        PixelRuns runs;
+    };
+
+    typedef std::vector<RunComponent> RunComponents;
+
     class WeakSegmentator : public Basic2dStorage<int /*id*/>
     {
     public:
@@ -38,7 +56,15 @@ namespace imago
         {
         }
 
+        // labels filled pixels connected when both |dx| and |dy| are within the range (the filled square pattern),
+        // two-pass run-length union-find; components are ordered by their first pixel in raster order
+        static void labelRuns(const Image& img, int range, RunComponents& components);
+
+        // returns true if the pattern is getLookupPattern(range) for some range >= 1
+        static bool isSquarePattern(const Points2i& lookup_pattern, int& range);
+
         // addend data from image (img.isFilled() called)
+        // square patterns on the empty segmentator go through labelRuns, others are flood filled
         int appendData(const Image& img, const Points2i& lookup_pattern = getLookupPattern(), bool connectMode = false);
 
         // updates crop if required
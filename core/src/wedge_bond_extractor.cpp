@@ -18,7 +18,9 @@
 
 #include "wedge_bond_extractor.h"
 
+#include <algorithm>
 #include <deque>
+#include <map>
 #include <vector>
 
 #include "algebra.h"
@@ -31,6 +33,7 @@
 #include "segment.h"
 #include "settings.h"
 #include "skeleton.h"
+#include "spatial_index.h"
 #include "stat_utils.h"
 #include "vec2d.h"
 
@@ -147,6 +150,17 @@ void WedgeBondExtractor::_fitSingleDownBorders(Vec2d& p1, Vec2d& p2, const Vec2d
         p2 = ic.intersection_point;
 }
 
+bool WedgeBondExtractor::_maybeSlashLine(const Segment& seg)
+{
+    // testSlashLine divides by the density of the thinned segment, an empty one never passes
+    for (int y = 0; y < seg.getHeight(); y++)
+        for (int x = 0; x < seg.getWidth(); x++)
+            if (seg.isFilled(x, y))
+                return true;
+
+    return false;
+}
+
 int WedgeBondExtractor::singleDownFetch(const Settings& vars, Skeleton& g)
 {
     int sdb_count = 0;
@@ -157,7 +171,7 @@ int WedgeBondExtractor::singleDownFetch(const Settings& vars, Skeleton& g)
 
     for (SegmentDeque::iterator it = _segs.begin(); it != _segs.end(); ++it)
     {
-        if (ImageUtils::testSlashLine(vars, **it, &angle, eps))
+        if (_maybeSlashLine(**it) && ImageUtils::testSlashLine(vars, **it, &angle, eps))
         {
             Vec2d a = (*it)->getCenter();
             segs_info.push_back(SegCenter(it, a, angle));
@@ -172,9 +186,40 @@ int WedgeBondExtractor::singleDownFetch(const Settings& vars, Skeleton& g)
         segs_info[i].seginfo_index = i;
     }
 
+    // the pairs differ in angle by less than SomeTresh, so they are looked for among the marks of the own
+    // and the adjacent ranges of angles, a bit wider than SomeTresh against the rounding of the division
+    double angle_step = vars.wbe.SomeTresh > 0 ? vars.wbe.SomeTresh * (1 + 1e-9) : 1.0;
+    std::map<long long, std::vector<size_t>> angle_buckets;
+    SpatialIndex centers(vars.wbe.SingleDownLengthMax);
+
+    for (size_t i = 0; i < segs_info.size(); i++)
+    {
+        long long bucket = (long long)floor(segs_info[i].angle / angle_step);
+        angle_buckets[bucket].push_back(i);
+        centers.insert(segs_info[i].center, i);
+    }
+
+    std::vector<size_t> partners, candidates, found;
+    double slack = 1 + 1e-9;
+
     for (size_t i = 0; i < segs_info.size(); i++)
-        for (size_t j = i + 1; j < segs_info.size(); j++)
+    {
+        partners.clear();
+        long long bucket = (long long)floor(segs_info[i].angle / angle_step);
+        for (long long b = bucket - 1; b <= bucket + 1; b++)
+        {
+            std::map<long long, std::vector<size_t>>::const_iterator it = angle_buckets.find(b);
+            if (it != angle_buckets.end())
+                partners.insert(partners.end(), it->second.begin(), it->second.end());
+        }
+        std::sort(partners.begin(), partners.end());
+
+        for (size_t u = 0; u < partners.size(); u++)
         {
+            size_t j = partners[u];
+            if (j <= i)
+                continue;
+
             if (segs_info[i].used && segs_info[j].used && fabs(segs_info[i].angle - segs_info[j].angle) < vars.wbe.SomeTresh)
             {
                 Vec2d p1 = segs_info[i].center, p2 = segs_info[j].center;
@@ -184,8 +229,30 @@ int WedgeBondExtractor::singleDownFetch(const Settings& vars, Skeleton& g)
                 cur_points.push_back(segs_info[i]);
                 cur_points.push_back(segs_info[j]);
 
-                for (size_t k = 0; k < segs_info.size(); k++)
+                // the marks near the line through p1 and p2, and near the common column or row of them
+                double dist = Vec2d::distance(p1, p2);
+                centers.queryStrip(p1, p2, dist > 0 ? slack * vars.wbe.SingleDownAngleMax / dist : 0, candidates);
+
+                if (absolute(p1.x - p2.x) <= vars.wbe.SingleDownCompareDist)
+                {
+                    Vec2d m(0.5 * (p1.x + p2.x), p1.y), n(m.x, m.y + 1);
+                    centers.queryStrip(m, n, slack * (vars.wbe.SingleDownCompareDist + 0.5 * absolute(p1.x - p2.x)), found);
+                    candidates.insert(candidates.end(), found.begin(), found.end());
+                }
+
+                if (absolute(p1.y - p2.y) <= vars.wbe.SingleDownCompareDist)
+                {
+                    Vec2d m(p1.x, 0.5 * (p1.y + p2.y)), n(m.x + 1, m.y);
+                    centers.queryStrip(m, n, slack * (vars.wbe.SingleDownCompareDist + 0.5 * absolute(p1.y - p2.y)), found);
+                    candidates.insert(candidates.end(), found.begin(), found.end());
+                }
+
+                std::sort(candidates.begin(), candidates.end());
+                candidates.erase(std::unique(candidates.begin(), candidates.end()), candidates.end());
+
+                for (size_t v = 0; v < candidates.size(); v++)
                 {
+                    size_t k = candidates[v];
                     Vec2d p3;
 
                     if (k != i && k != j && segs_info[k].used)
@@ -301,13 +368,14 @@ int WedgeBondExtractor::singleDownFetch(const Settings& vars, Skeleton& g)
                 cur_points.clear();
             }
         }
+    }
 
     // delete elements from queue (note: iterators invalidation after erase)
+    std::sort(to_delete_segs.begin(), to_delete_segs.end());
+
     for (SegmentDeque::iterator it = _segs.begin(); it != _segs.end();)
     {
-        std::vector<Segment*>::iterator res = std::find(to_delete_segs.begin(), to_delete_segs.end(), *it);
-
-        if (res != to_delete_segs.end())
+        if (std::binary_search(to_delete_segs.begin(), to_delete_segs.end(), *it))
         {
             delete *it;
             it = _segs.erase(it);
@@ -318,8 +386,6 @@ int WedgeBondExtractor::singleDownFetch(const Settings& vars, Skeleton& g)
 
     g.recalcAvgBondLength();
 
-    Skeleton::SkeletonGraph graph = g.getGraph();
-
     return sdb_count;
 }
 
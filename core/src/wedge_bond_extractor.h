@@ -76,6 +76,9 @@ namespace imago
             bool white_found;
         };
 
+        // cheap test run before ImageUtils::testSlashLine, rejects only the segments it rejects as well
+        static bool _maybeSlashLine(const Segment& seg);
+
         void _fitSingleDownBorders(Vec2d& p1, Vec2d& p2, const Vec2d& v1, const Vec2d& v2);
         static bool _intersectionFinderPlotCallBack(int x, int y, int color, void* userdata);
 
@@ -0,0 +1,72 @@
+/****************************************************************************
+ * Copyright (C) from 2009 to Present EPAM Systems.
+ *
+ * This file is part of Imago toolkit.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ ***************************************************************************/
+
+#pragma once
+
+#include <chrono>
+#include <string>
+#include <vector>
+
+#include "file_helpers.h"
+#include "image.h"
+#include "settings.h"
+
+namespace benchmark
+{
+    class Timer
+    {
+    public:
+        Timer()
+        {
+            reset();
+        }
+
+        void reset()
+        {
+            _start = std::chrono::steady_clock::now();
+        }
+
+        double elapsedMs() const
+        {
+            return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - _start).count();
+        }
+
+    private:
+        std::chrono::steady_clock::time_point _start;
+    };
+
+    // loads all supported images from the directory, returns count of loaded ones
+    size_t loadImages(const std::string& dir, std::vector<imago::Image>& images, strings* names = NULL);
+
+    // first prefilter and full recognition of every image, returns elapsed time in ms.
+    // molfiles of the last round are stored without the timestamp line, empty on failure
+    double recognizeImages(const imago::Settings& vars, const std::vector<imago::Image>& images, int rounds, strings* molfiles = NULL);
+
+    // benchmarks, args are the command line parameters after the benchmark name
+    int benchmarkLogging(const strings& args);
+    int benchmarkTemplates(const strings& args);
+    int benchmarkPruning(const strings& args);
+    int benchmarkThinning(const strings& args);
+    int benchmarkLabelling(const strings& args);
+    int benchmarkBinarized(const strings& args);
+    int benchmarkPage(const strings& args);
+    int benchmarkCaptions(const strings& args);
+    int benchmarkGraph(const strings& args);
+    int benchmarkRNG(const strings& args);
+    int benchmarkHashes(const strings& args);
+}
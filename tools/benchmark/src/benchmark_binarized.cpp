@@ -0,0 +1,131 @@
+/****************************************************************************
+ * Copyright (C) from 2009 to Present EPAM Systems.
+ *
+ * This file is part of Imago toolkit.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ ***************************************************************************/
+
+#include <cstdio>
+#include <cstdlib>
+#include <random>
+
+#include "benchmark.h"
+#include "image_utils.h"
+
+namespace benchmark
+{
+    // pixel-wise passes of prefilterBinarizedFullsize before the row kernels, kept as the reference
+    static void legacyBinarized(imago::Image& image, int threshold, int gap, int& black_count, int& white_count)
+    {
+        int others_count = 0;
+        black_count = white_count = 0;
+        for (int y = 0; y < image.getHeight(); y++)
+            for (int x = 0; x < image.getWidth(); x++)
+                if (image.getByte(x, y) == 0)
+                    black_count++;
+                else if (image.getByte(x, y) == 255)
+                    white_count++;
+                else
+                    others_count++;
+
+        for (int y = 0; y < image.getHeight(); y++)
+            for (int x = 0; x < image.getWidth(); x++)
+                if (image.getByte(x, y) != 0 && image.getByte(x, y) != 255)
+                {
+                    if (x > gap && y > gap && x + gap < image.getWidth() && y + gap < image.getHeight() && image.getByte(x, y) < threshold)
+                        image.getByte(x, y) = 0;
+                    else
+                        image.getByte(x, y) = 255;
+                }
+
+        for (int y = 0; y < image.getHeight(); y++)
+            for (int x = 0; x < image.getWidth(); x++)
+                image.getByte(x, y) = image.getByte(x, y) == 0 ? 255 : 0;
+    }
+
+    static void kernelsBinarized(imago::Image& image, int threshold, int gap, int& black_count, int& white_count)
+    {
+        int others_count = 0;
+        imago::ImageUtils::countBlackWhite(image, black_count, white_count, others_count);
+        imago::ImageUtils::thresholdWithBorder(image, threshold, gap);
+        imago::ImageUtils::invertBinary(image);
+    }
+
+    static bool samePixels(const imago::Image& a, const imago::Image& b)
+    {
+        for (int y = 0; y < a.getHeight(); y++)
+            for (int x = 0; x < a.getWidth(); x++)
+                if (a.getByte(x, y) != b.getByte(x, y))
+                    return false;
+        return true;
+    }
+
+    // mostly black and white page with antialiased grey pixels
+    static void drawBinarized(imago::Image& img, std::mt19937& rng)
+    {
+        for (int y = 0; y < img.getHeight(); y++)
+            for (int x = 0; x < img.getWidth(); x++)
+            {
+                int v = rng() % 100;
+                img.getByte(x, y) = v < 10 ? 0 : (v < 97 ? 255 : rng() % 256);
+            }
+    }
+
+    int benchmarkBinarized(const strings& args)
+    {
+        int rounds = args.size() > 0 ? atoi(args[0].c_str()) : 5;
+
+        std::mt19937 rng(2024);
+        const int sides[] = {1000, 2000, 3000, 4000, 5000};
+        const int threshold = 190, gap = 10;
+        int mismatches = 0;
+
+        printf("%10s %12s %12s %12s %10s\n", "size", "legacy, ms", "kernels, ms", "GB/s", "speedup");
+        for (size_t s = 0; s < sizeof(sides) / sizeof(sides[0]); s++)
+        {
+            imago::Image source(sides[s], sides[s]);
+            drawBinarized(source, rng);
+
+            imago::Image legacy, fast;
+            int legacy_black = 0, legacy_white = 0, fast_black = 0, fast_white = 0;
+            double legacy_ms = 0.0, fast_ms = 0.0;
+
+            for (int r = 0; r < rounds; r++)
+            {
+                legacy.copy(source);
+                Timer timer;
+                legacyBinarized(legacy, threshold, gap, legacy_black, legacy_white);
+                legacy_ms += timer.elapsedMs();
+
+                fast.copy(source);
+                timer.reset();
+                kernelsBinarized(fast, threshold, gap, fast_black, fast_white);
+                fast_ms += timer.elapsedMs();
+            }
+            legacy_ms /= rounds;
+            fast_ms /= rounds;
+
+            if (legacy_black != fast_black || legacy_white != fast_white || !samePixels(legacy, fast))
+                mismatches++;
+
+            // every pass reads the image, two of them also write it
+            double bytes = 5.0 * sides[s] * sides[s];
+            printf("%5dx%-4d %12.2f %12.2f %12.2f %9.1fx\n", sides[s], sides[s], legacy_ms, fast_ms, bytes / (fast_ms * 1e6),
+                   legacy_ms / fast_ms);
+        }
+
+        printf("mismatches: %d\n", mismatches);
+        return mismatches > 0 ? 1 : 0;
+    }
+}
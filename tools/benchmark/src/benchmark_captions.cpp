@@ -0,0 +1,111 @@
+/****************************************************************************
+ * Copyright (C) from 2009 to Present EPAM Systems.
+ *
+ * This file is part of Imago toolkit.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ ***************************************************************************/
+
+#include <cstdio>
+#include <cstdlib>
+
+#include "benchmark.h"
+#include "chemical_structure_recognizer.h"
+#include "filters_list.h"
+#include "molecule.h"
+#include "prefilter_entry.h"
+#include "recognition_statistics.h"
+
+namespace benchmark
+{
+    int benchmarkCaptions(const strings& args)
+    {
+        std::string dir = args.size() > 0 ? args[0] : "../imago/tests/images";
+        int rounds = args.size() > 1 ? atoi(args[1].c_str()) : 3;
+
+        std::vector<imago::Image> images;
+        if (loadImages(dir, images) == 0)
+        {
+            printf("No images loaded from '%s'\n", dir.c_str());
+            return 1;
+        }
+
+        int filter = -1;
+        const imago::FilterEntries& filters = imago::getFiltersList();
+        for (size_t u = 0; u < filters.size(); u++)
+            if (filters[u].name == "prefilter_binarized")
+                filter = (int)u;
+
+        // stages the former restart spent once more on the cleaned image
+        const imago::RecognitionStatistics::Stage restarted[] = {imago::RecognitionStatistics::stSegmentation,
+                                                                 imago::RecognitionStatistics::stWedgeExtraction,
+                                                                 imago::RecognitionStatistics::stSeparation};
+        const size_t restarted_count = sizeof(restarted) / sizeof(restarted[0]);
+
+        double recognition = 0.0, incremental = 0.0;
+        double repeated[restarted_count] = {0.0};
+        int captioned = 0;
+        for (int r = 0; r < rounds; r++)
+        {
+            for (size_t u = 0; u < images.size(); u++)
+            {
+                imago::Settings local;
+                imago::Image img;
+                imago::Molecule mol;
+                imago::ChemicalStructureRecognizer csr;
+                imago::RecognitionStatistics statistics;
+                imago::StatisticsScope scope(statistics);
+                try
+                {
+                    if (!imago::applyPrefilter(local, img, images[u], filter))
+                        continue;
+
+                    Timer timer;
+                    csr.image2mol(local, img, mol);
+                    recognition += timer.elapsedMs();
+                }
+                catch (std::exception&)
+                {
+                    // recognition failures are the part of workload
+                }
+
+                if (statistics.captions > 0)
+                {
+                    captioned++;
+                    for (size_t s = 0; s < restarted_count; s++)
+                        repeated[s] += statistics.stageMs[restarted[s]];
+                    // captions detection, segments drop and the capital height re-estimation
+                    incremental += statistics.stageMs[imago::RecognitionStatistics::stCaptionRemoval];
+                }
+            }
+        }
+
+        printf("Binarized images: %u x %d rounds, %d recognitions with captions removed, recognition: %.1f ms\n", (unsigned)images.size(), rounds,
+               captioned, recognition);
+
+        double restart = 0.0;
+        printf("%24s %12s\n", "restart stage", "time, ms");
+        for (size_t s = 0; s < restarted_count; s++)
+        {
+            printf("%24s %12.1f\n", imago::RecognitionStatistics::getStageName(restarted[s]), repeated[s]);
+            restart += repeated[s];
+        }
+        printf("%24s %12.1f\n", "restart total", restart);
+        printf("%24s %12.1f\n", "incremental update", incremental);
+
+        // the restart detected the captions as well, so the difference is the lower bound of the saved time
+        printf("Saved against the restart: at least %.1f ms (%.1f%% of recognition)\n", restart - incremental,
+               recognition > 0.0 ? 100.0 * (restart - incremental) / (recognition + restart - incremental) : 0.0);
+        return 0;
+    }
+}
@@ -0,0 +1,138 @@
+/****************************************************************************
+ * Copyright (C) from 2009 to Present EPAM Systems.
+ *
+ * This file is part of Imago toolkit.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ ***************************************************************************/
+
+#include <cstdio>
+#include <cstdlib>
+
+#include "beast.h"
+#include "benchmark.h"
+
+namespace benchmark
+{
+    struct GraphVertexData
+    {
+        double x, y;
+    };
+
+    struct GraphEdgeData
+    {
+        double length;
+    };
+
+    class BenchmarkGraph : public beast::Graph<GraphVertexData, GraphEdgeData>
+    {
+    public:
+        GraphVertexData* getVertexData(const vertex_descriptor& v)
+        {
+            return &_vertices[v.id].data;
+        }
+        GraphEdgeData* getEdgeData(const edge_descriptor& e)
+        {
+            return &_edges[e.id].data;
+        }
+    };
+
+    // square lattice of side x side vertices, about 2 * side * side edges
+    static void buildLattice(BenchmarkGraph& g, int side, std::vector<BenchmarkGraph::vertex_descriptor>& vertices)
+    {
+        vertices.clear();
+        for (int y = 0; y < side; y++)
+            for (int x = 0; x < side; x++)
+            {
+                BenchmarkGraph::vertex_descriptor v = g.addVertex();
+                g.getVertexData(v)->x = x;
+                g.getVertexData(v)->y = y;
+                vertices.push_back(v);
+            }
+
+        for (int y = 0; y < side; y++)
+            for (int x = 0; x < side; x++)
+            {
+                if (x + 1 < side)
+                    g.getEdgeData(g.addEdge(vertices[y * side + x], vertices[y * side + x + 1]).first)->length = 1.0;
+                if (y + 1 < side)
+                    g.getEdgeData(g.addEdge(vertices[y * side + x], vertices[(y + 1) * side + x]).first)->length = 1.0;
+            }
+    }
+
+    int benchmarkGraph(const strings& args)
+    {
+        int rounds = args.size() > 0 ? atoi(args[0].c_str()) : 10;
+        const int side = 71; // 5041 vertices, 9940 edges
+
+        double build = 0, lookup = 0, iterate = 0, edit = 0;
+        size_t found = 0, visited = 0, edges = 0, vertices_left = 0;
+        for (int r = 0; r < rounds; r++)
+        {
+            BenchmarkGraph g;
+            std::vector<BenchmarkGraph::vertex_descriptor> vertices;
+
+            Timer timer;
+            buildLattice(g, side, vertices);
+            build += timer.elapsedMs();
+            edges = g.edgeCount();
+
+            // every lattice neighbour pair and the same number of absent diagonal ones
+            timer.reset();
+            for (int y = 0; y + 1 < side; y++)
+                for (int x = 0; x + 1 < side; x++)
+                {
+                    const BenchmarkGraph::vertex_descriptor& v = vertices[y * side + x];
+                    found += g.getEdge(v, vertices[y * side + x + 1]).second;
+                    found += g.getEdge(vertices[(y + 1) * side + x], v).second;
+                    found += g.getEdge(v, vertices[(y + 1) * side + x + 1]).second;
+                }
+            lookup += timer.elapsedMs();
+
+            timer.reset();
+            double length = 0;
+            for (BenchmarkGraph::edge_iterator it = g.edgeBegin(); it != g.edgeEnd(); ++it)
+                length += g.getEdgeData(*it)->length;
+            for (BenchmarkGraph::vertex_iterator it = g.vertexBegin(); it != g.vertexEnd(); ++it)
+                for (BenchmarkGraph::adjacency_iterator a = g.adjacencyBegin(*it); a != g.adjacencyEnd(*it); ++a)
+                    visited++;
+            iterate += timer.elapsedMs();
+            if (length < 0)
+                printf("unreachable\n");
+
+            // the edits made by the skeleton cleanup: drop every third vertex, join its former neighbours
+            timer.reset();
+            for (size_t u = 0; u < vertices.size(); u += 3)
+            {
+                std::vector<BenchmarkGraph::vertex_descriptor> neighbors;
+                for (BenchmarkGraph::adjacency_iterator a = g.adjacencyBegin(vertices[u]); a != g.adjacencyEnd(vertices[u]); ++a)
+                    neighbors.push_back(*a);
+                g.removeVertex(vertices[u]);
+                for (size_t i = 1; i < neighbors.size(); i++)
+                    g.getEdgeData(g.addEdge(neighbors[0], neighbors[i]).first)->length = 2.0;
+            }
+            edit += timer.elapsedMs();
+            vertices_left = g.vertexCount();
+        }
+
+        printf("%u edges lattice, %d rounds\n", (unsigned)edges, rounds);
+        printf("%12s %12s\n", "operation", "ms/round");
+        printf("%12s %12.2f\n", "build", build / rounds);
+        printf("%12s %12.2f\n", "getEdge", lookup / rounds);
+        printf("%12s %12.2f\n", "iterate", iterate / rounds);
+        printf("%12s %12.2f\n", "edit", edit / rounds);
+        printf("found %u edges, visited %u neighbours, %u vertices left\n", (unsigned)(found / rounds), (unsigned)(visited / rounds),
+               (unsigned)vertices_left);
+        return 0;
+    }
+}
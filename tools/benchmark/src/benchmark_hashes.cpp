@@ -0,0 +1,118 @@
+/****************************************************************************
+ * Copyright (C) from 2009 to Present EPAM Systems.
+ *
+ * This file is part of Imago toolkit.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ ***************************************************************************/
+
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <random>
+
+#include "benchmark.h"
+#include "molecule.h"
+#include "segment.h"
+#include "segmentator.h"
+#include "wedge_bond_extractor.h"
+
+namespace benchmark
+{
+    static void putDot(imago::Image& img, int x, int y)
+    {
+        if (x >= 0 && y >= 0 && x < img.getWidth() && y < img.getHeight())
+            img.getByte(x, y) = 0;
+    }
+
+    // grid of hash bonds among the noise specks of one to four pixels, returns count of the bonds
+    static int drawHashes(imago::Image& img, int specks, std::mt19937& rng)
+    {
+        img.fillWhite();
+
+        const int step = 180, marks = 7;
+        int bonds = 0;
+        for (int cy = step / 2; cy + step / 2 <= img.getHeight(); cy += step)
+            for (int cx = step / 2; cx + step / 2 <= img.getWidth(); cx += step, bonds++)
+            {
+                double angle = (rng() % 360) * imago::PI / 180;
+                double dx = cos(angle), dy = sin(angle);
+                for (int m = 0; m < marks; m++)
+                {
+                    // marks 9 pixels apart growing from 4 to 16 pixels, two pixels thick
+                    double mx = cx + (m - marks / 2) * 9 * dx, my = cy + (m - marks / 2) * 9 * dy;
+                    double half = 2 + m;
+                    for (double t = -half; t <= half; t += 0.25)
+                    {
+                        int x = (int)floor(mx - t * dy), y = (int)floor(my + t * dx);
+                        putDot(img, x, y);
+                        putDot(img, x + 1, y);
+                    }
+                }
+            }
+
+        for (int s = 0; s < specks; s++)
+        {
+            int x = rng() % img.getWidth(), y = rng() % img.getHeight();
+            int size = 1 + rng() % 4;
+            putDot(img, x, y);
+            if (size > 1)
+                putDot(img, x + 1, y);
+            if (size > 2)
+                putDot(img, x, y + 1);
+            if (size > 3)
+                putDot(img, x + 1, y + 1);
+        }
+
+        return bonds;
+    }
+
+    int benchmarkHashes(const strings& args)
+    {
+        int rounds = args.size() > 0 ? atoi(args[0].c_str()) : 3;
+
+        imago::Settings vars;
+        std::mt19937 rng(2024);
+        const int specks[] = {0, 1000, 5000, 20000, 50000};
+
+        printf("%10s %10s %10s %10s %12s\n", "specks", "segments", "drawn", "found", "time, ms");
+        for (size_t s = 0; s < sizeof(specks) / sizeof(specks[0]); s++)
+        {
+            imago::Image img(1800, 1800);
+            int drawn = drawHashes(img, specks[s], rng);
+
+            size_t segments_count = 0;
+            int found = 0;
+            double ms = 0;
+            for (int r = 0; r < rounds; r++)
+            {
+                imago::SegmentDeque segments;
+                imago::Segmentator::segmentate(img, segments);
+                segments_count = segments.size();
+
+                imago::Molecule mol;
+                imago::WedgeBondExtractor wbe(segments, img);
+
+                Timer timer;
+                found = wbe.singleDownFetch(vars, mol);
+                ms += timer.elapsedMs();
+
+                for (imago::SegmentDeque::iterator it = segments.begin(); it != segments.end(); ++it)
+                    delete *it;
+            }
+
+            printf("%10d %10u %10d %10d %12.1f\n", specks[s], (unsigned)segments_count, drawn, found, ms / rounds);
+        }
+        return 0;
+    }
+}
@@ -0,0 +1,79 @@
+/****************************************************************************
+ * Copyright (C) from 2009 to Present EPAM Systems.
+ *
+ * This file is part of Imago toolkit.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ ***************************************************************************/
+
+#include <cstdio>
+#include <cstdlib>
+#include <random>
+
+#include "benchmark.h"
+#include "weak_segmentator.h"
+
+namespace benchmark
+{
+    // synthetic scan: short thick strokes and sparse noise on the white page
+    static void drawScan(imago::Image& img, std::mt19937& rng)
+    {
+        img.fillWhite();
+
+        const int strokes = img.getWidth() * img.getHeight() / 2000;
+        for (int s = 0; s < strokes; s++)
+        {
+            int x = rng() % img.getWidth();
+            int y = rng() % img.getHeight();
+            int dx = (int)(rng() % 3) - 1;
+            int dy = (int)(rng() % 3) - 1;
+            int length = 10 + rng() % 40;
+            for (int u = 0; u < length; u++, x += dx, y += dy)
+                for (int t = 0; t < 3; t++)
+                    if (x + t >= 0 && y >= 0 && x + t < img.getWidth() && y < img.getHeight())
+                        img.getByte(x + t, y) = 0;
+        }
+
+        const int noise = img.getWidth() * img.getHeight() / 500;
+        for (int s = 0; s < noise; s++)
+            img.getByte(rng() % img.getWidth(), rng() % img.getHeight()) = 0;
+    }
+
+    int benchmarkLabelling(const strings& args)
+    {
+        int rounds = args.size() > 0 ? atoi(args[0].c_str()) : 3;
+
+        std::mt19937 rng(2024);
+        const int sides[] = {1000, 2000, 3000, 4000, 5000};
+
+        printf("%10s %8s %12s %12s %12s\n", "size", "range", "components", "time, ms", "ns/pixel");
+        for (size_t s = 0; s < sizeof(sides) / sizeof(sides[0]); s++)
+        {
+            imago::Image img(sides[s], sides[s]);
+            drawScan(img, rng);
+
+            for (int range = 1; range <= 3; range += 2)
+            {
+                imago::RunComponents components;
+                Timer timer;
+                for (int r = 0; r < rounds; r++)
+                    imago::WeakSegmentator::labelRuns(img, range, components);
+                double ms = timer.elapsedMs() / rounds;
+
+                printf("%5dx%-4d %8d %12u %12.1f %12.2f\n", sides[s], sides[s], range, (unsigned)components.size(), ms,
+                       ms * 1e6 / ((double)sides[s] * sides[s]));
+            }
+        }
+        return 0;
+    }
+}
@@ -0,0 +1,66 @@
+/****************************************************************************
+ * Copyright (C) from 2009 to Present EPAM Systems.
+ *
+ * This file is part of Imago toolkit.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ ***************************************************************************/
+
+#include <cstdio>
+#include <cstdlib>
+
+#include "benchmark.h"
+#include "log_ext.h"
+
+namespace benchmark
+{
+    static int loggedFunction(int value)
+    {
+        logEnterFunction();
+        imago::getLogExt().append("Value", value);
+        return value + 1;
+    }
+
+    int benchmarkLogging(const strings& args)
+    {
+        std::string dir = args.size() > 0 ? args[0] : "../imago/tests/images";
+        int rounds = args.size() > 1 ? atoi(args[1].c_str()) : 3;
+
+#ifdef IMAGO_DISABLE_DEBUG_LOG
+        printf("Debug log is compiled out (IMAGO_ENABLE_DEBUG_LOG=OFF)\n");
+#else
+        printf("Debug log is compiled in, disabled at runtime\n");
+#endif
+        imago::getLogExt().setLoggingEnabled(false);
+
+        const int calls = 10000000;
+        volatile int sink = 0;
+        Timer timer;
+        for (int u = 0; u < calls; u++)
+            sink = loggedFunction(sink);
+        double ms = timer.elapsedMs();
+        printf("Logged function calls: %d in %.1f ms (%.2f ns per call)\n", calls, ms, ms * 1e6 / calls);
+
+        std::vector<imago::Image> images;
+        if (loadImages(dir, images) == 0)
+        {
+            printf("No images loaded from '%s'\n", dir.c_str());
+            return 1;
+        }
+
+        imago::Settings vars;
+        ms = recognizeImages(vars, images, rounds);
+        printf("Recognized %u images x %d rounds in %.1f ms (%.1f ms per image)\n", (unsigned)images.size(), rounds, ms, ms / (images.size() * rounds));
+        return 0;
+    }
+}
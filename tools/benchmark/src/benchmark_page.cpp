@@ -0,0 +1,93 @@
+/****************************************************************************
+ * Copyright (C) from 2009 to Present EPAM Systems.
+ *
+ * This file is part of Imago toolkit.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ ***************************************************************************/
+
+#include <cstdio>
+#include <cstdlib>
+#include <random>
+
+#include "benchmark.h"
+#include "page_segmentator.h"
+
+namespace benchmark
+{
+    // page with text lines and a few drawings of long strokes
+    static void drawPage(imago::Image& page, std::mt19937& rng)
+    {
+        page.fillWhite();
+
+        const int glyph = page.getHeight() / 250;
+        for (int y = glyph * 4; y + glyph < page.getHeight(); y += glyph * 2)
+            for (int x = glyph * 4; x + glyph < page.getWidth() - glyph * 4; x += glyph)
+            {
+                if (rng() % 7 == 0)
+                    continue;
+                for (int t = 0; t < glyph * 2; t++)
+                    page.getByte(x + rng() % (glyph - 1), y + rng() % glyph) = (imago::byte)(rng() % 60);
+            }
+
+        for (int d = 0; d < 3; d++)
+        {
+            int cx = page.getWidth() / 4 + rng() % (page.getWidth() / 2);
+            int cy = page.getHeight() / 4 + rng() % (page.getHeight() / 2);
+            for (int s = 0; s < 40; s++)
+            {
+                int x = cx, y = cy;
+                int dx = (int)(rng() % 3) - 1, dy = (int)(rng() % 3) - 1;
+                for (int u = 0; u < glyph * 10; u++, x += dx, y += dy)
+                    for (int t = 0; t < 3; t++)
+                        if (x + t >= 0 && y >= 0 && x + t < page.getWidth() && y < page.getHeight())
+                            page.getByte(x + t, y) = 0;
+            }
+        }
+    }
+
+    int benchmarkPage(const strings& args)
+    {
+        int rounds = args.size() > 0 ? atoi(args[0].c_str()) : 3;
+
+        imago::Settings vars;
+        std::mt19937 rng(2024);
+        const int widths[] = {2480, 4960, 7440};
+
+        printf("%11s %8s %10s %12s %12s %12s\n", "size", "tile", "regions", "candidates", "time, ms", "ns/pixel");
+        for (size_t s = 0; s < sizeof(widths) / sizeof(widths[0]); s++)
+        {
+            // A4 at 300, 600 and 900 dpi
+            imago::Image page(widths[s], widths[s] * 297 / 210);
+            drawPage(page, rng);
+
+            for (int tile = 512; tile <= 2048; tile *= 2)
+            {
+                vars.page.TileSize = tile;
+
+                imago::PageLayout layout;
+                Timer timer;
+                for (int r = 0; r < rounds; r++)
+                    imago::PageSegmentator::segmentate(vars, page, layout);
+                double ms = timer.elapsedMs() / rounds;
+
+                imago::PageRegions candidates;
+                imago::PageSegmentator::selectCandidates(vars, layout, candidates);
+
+                printf("%5dx%-5d %8d %10u %12u %12.1f %12.2f\n", page.getWidth(), page.getHeight(), tile, (unsigned)layout.regions.size(),
+                       (unsigned)candidates.size(), ms, ms * 1e6 / ((double)page.getWidth() * page.getHeight()));
+            }
+        }
+        return 0;
+    }
+}
@@ -0,0 +1,71 @@
+/****************************************************************************
+ * Copyright (C) from 2009 to Present EPAM Systems.
+ *
+ * This file is part of Imago toolkit.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ ***************************************************************************/
+
+#include <cstdio>
+#include <cstdlib>
+
+#include "benchmark.h"
+
+namespace benchmark
+{
+    int benchmarkPruning(const strings& args)
+    {
+        std::string dir = args.size() > 0 ? args[0] : "../imago/tests/images";
+        int rounds = args.size() > 1 ? atoi(args[1].c_str()) : 1;
+
+        std::vector<imago::Image> images;
+        if (loadImages(dir, images) == 0)
+        {
+            printf("No images loaded from '%s'\n", dir.c_str());
+            return 1;
+        }
+
+        // exhaustive comparison is the reference for accuracy
+        const int tops[] = {0, 64, 32, 16, 8, 4};
+        const double margins[] = {0.25, 0.0};
+
+        strings reference;
+        printf("%8s %8s %12s %12s %10s\n", "top K", "margin", "time, ms", "ms/image", "same mol");
+        for (size_t t = 0; t < sizeof(tops) / sizeof(tops[0]); t++)
+        {
+            for (size_t m = 0; m < sizeof(margins) / sizeof(margins[0]); m++)
+            {
+                if (tops[t] == 0 && m > 0)
+                    continue;
+
+                imago::Settings vars;
+                vars.characters.PruningTopK = tops[t];
+                vars.characters.PruningSignatureMargin = margins[m];
+
+                strings molfiles;
+                double ms = recognizeImages(vars, images, rounds, &molfiles);
+                if (tops[t] == 0)
+                    reference = molfiles;
+
+                size_t same = 0;
+                for (size_t u = 0; u < molfiles.size(); u++)
+                    if (molfiles[u] == reference[u])
+                        same++;
+
+                printf("%8d %8.2f %12.1f %12.1f %5u/%-4u\n", tops[t], margins[m], ms, ms / (images.size() * rounds), (unsigned)same,
+                       (unsigned)molfiles.size());
+            }
+        }
+        return 0;
+    }
+}
@@ -0,0 +1,115 @@
+/****************************************************************************
+ * Copyright (C) from 2009 to Present EPAM Systems.
+ *
+ * This file is part of Imago toolkit.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ ***************************************************************************/
+
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <random>
+
+#include "benchmark.h"
+#include "log_ext.h"
+#include "rng_builder.h"
+#include "segments_graph.h"
+
+namespace benchmark
+{
+    class RNGGraph : public imago::segments_graph::SegmentsGraph
+    {
+    public:
+        double getWeight(const edge_descriptor& e) const
+        {
+            return _edges[e.id].data.weight;
+        }
+    };
+
+    // symbol centers: text rows of the page with half pixel coordinates, some of them coincide
+    static void placePoints(RNGGraph& g, int count, std::mt19937& rng)
+    {
+        int width = 40 * (int)sqrt((double)count) + 1;
+        for (int u = 0; u < count; u++)
+        {
+            imago::Vec2d pos;
+            if (u > 0 && rng() % 50 == 0)
+                pos = g.getVertexPosition(RNGGraph::vertex_descriptor(rng() % u));
+            else if (rng() % 4 == 0)
+                pos = imago::Vec2d((rng() % (2 * width)) / 2.0, (rng() % (2 * width)) / 2.0);
+            else
+                pos = imago::Vec2d((rng() % (2 * width)) / 2.0, 30 * (int)(rng() % (width / 30 + 1)) + (rng() % 9) / 2.0);
+
+            RNGGraph::vertex_descriptor v = g.addVertex();
+            g.setVertexPosition(v, pos);
+        }
+    }
+
+    static bool sameEdges(const RNGGraph& a, const RNGGraph& b)
+    {
+        if (a.edgeCount() != b.edgeCount())
+            return false;
+
+        for (RNGGraph::edge_iterator ea = a.edgeBegin(), eb = b.edgeBegin(); ea != a.edgeEnd(); ++ea, ++eb)
+        {
+            if (a.getVertexIndex((*ea).m_source) != b.getVertexIndex((*eb).m_source) ||
+                a.getVertexIndex((*ea).m_target) != b.getVertexIndex((*eb).m_target) || a.getWeight(*ea) != b.getWeight(*eb))
+                return false;
+        }
+        return true;
+    }
+
+    int benchmarkRNG(const strings& args)
+    {
+        int rounds = args.size() > 0 ? atoi(args[0].c_str()) : 3;
+
+        std::mt19937 rng(2024);
+        const int counts[] = {10, 100, 300, 1000, 3000, 10000, 30000};
+        const int max_brute_force = 1000;
+
+        printf("%8s %10s %14s %14s %10s\n", "points", "edges", "brute, ms", "delaunay, ms", "same");
+        for (size_t c = 0; c < sizeof(counts) / sizeof(counts[0]); c++)
+        {
+            double brute_ms = 0, delaunay_ms = 0;
+            size_t edges = 0;
+            int same = 0;
+            for (int r = 0; r < rounds; r++)
+            {
+                RNGGraph points;
+                placePoints(points, counts[c], rng);
+
+                RNGGraph delaunay = points;
+                Timer timer;
+                imago::RNGBuilder::buildDelaunay(delaunay);
+                delaunay_ms += timer.elapsedMs();
+                edges = delaunay.edgeCount();
+
+                if (counts[c] <= max_brute_force)
+                {
+                    RNGGraph brute = points;
+                    timer.reset();
+                    imago::RNGBuilder::build(brute);
+                    brute_ms += timer.elapsedMs();
+                    same += sameEdges(brute, delaunay);
+                }
+            }
+
+            if (counts[c] <= max_brute_force)
+                printf("%8d %10u %14.2f %14.2f %6d/%-3d\n", counts[c], (unsigned)edges, brute_ms / rounds, delaunay_ms / rounds, same, rounds);
+            else
+                printf("%8d %10u %14s %14.2f %10s\n", counts[c], (unsigned)edges, "-", delaunay_ms / rounds, "-");
+        }
+        return 0;
+    }
+}
@@ -0,0 +1,132 @@
+/****************************************************************************
+ * Copyright (C) from 2009 to Present EPAM Systems.
+ *
+ * This file is part of Imago toolkit.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ ***************************************************************************/
+
+#include <cstdio>
+#include <cstdlib>
+
+#include "benchmark.h"
+#include "character_recognizer.h"
+#include "recognition_distance.h"
+
+using namespace imago::CharacterRecognizerImp;
+
+namespace benchmark
+{
+    // template matching as it was before the masked kernels: branch per pixel, repeated for 9 equal shifts
+    static double compareLegacy(const cv::Mat1b& img, const unsigned char* penalty_ink, const unsigned char* penalty_white)
+    {
+        double best = imago::DIST_INF;
+        for (int shift_x = 0; shift_x <= 2 * PENALTY_SHIFT; shift_x += PENALTY_STEP)
+        {
+            for (int shift_y = 0; shift_y <= 2 * PENALTY_SHIFT; shift_y += PENALTY_STEP)
+            {
+                int sum_ink = 0;
+                int sum_white = 0;
+                for (int y = 0; y < img.cols; y++)
+                {
+                    for (int x = 0; x < img.rows; x++)
+                    {
+                        int idx = (y + PENALTY_SHIFT) * INTERNAL_ARRAY_DIM + (x + PENALTY_SHIFT);
+                        if (img(y, x) == 0)
+                            sum_ink += penalty_ink[idx] - CHARACTERS_OFFSET;
+                        else
+                            sum_white += penalty_white[idx] - CHARACTERS_OFFSET;
+                    }
+                }
+                double result = (double)sum_ink + (double)sum_white / (double)PENALTY_WHITE_FACTOR;
+                if (result < best)
+                    best = result;
+            }
+        }
+        return best;
+    }
+
+    // restores the glyph from its template: ink pixels have zero ink penalty
+    static cv::Mat1b templateGlyph(const PackedTemplates& templates, int u)
+    {
+        cv::Mat1b img(REQUIRED_SIZE, REQUIRED_SIZE);
+        for (int y = 0; y < REQUIRED_SIZE; y++)
+            for (int x = 0; x < REQUIRED_SIZE; x++)
+            {
+                int idx = (y + PENALTY_SHIFT) * INTERNAL_ARRAY_DIM + (x + PENALTY_SHIFT);
+                img(y, x) = (templates.ink(u)[idx] == CHARACTERS_OFFSET) ? 0 : 255;
+            }
+        return img;
+    }
+
+    static void report(const char* name, size_t comparisons, double ms, double checksum)
+    {
+        printf("%-8s %10.0f templates/s  (%.1f ms, checksum %.1f)\n", name, comparisons * 1000.0 / ms, ms, checksum);
+    }
+
+    int benchmarkTemplates(const strings& args)
+    {
+        int rounds = args.size() > 0 ? atoi(args[0].c_str()) : 5;
+
+        const PackedTemplates& templates = getBuiltinTemplates();
+        std::vector<cv::Mat1b> glyphs;
+        for (int u = 0; u < templates.count; u++)
+            glyphs.push_back(templateGlyph(templates, u));
+
+        const size_t comparisons = glyphs.size() * templates.count * rounds;
+        printf("%u glyphs x %d templates x %d rounds, default kernel: %s\n", (unsigned)glyphs.size(), templates.count, rounds,
+               getKernelName(getDefaultKernel()));
+
+        double reference = 0.0;
+        {
+            Timer timer;
+            for (int r = 0; r < rounds; r++)
+                for (size_t g = 0; g < glyphs.size(); g++)
+                    for (int t = 0; t < templates.count; t++)
+                        reference += compareLegacy(glyphs[g], templates.ink(t), templates.white(t));
+            report("legacy", comparisons, timer.elapsedMs(), reference);
+        }
+
+        const CompareKernel kernels[] = {ckScalar, ckSSE2, ckAVX2};
+        int result = 0;
+        for (size_t k = 0; k < sizeof(kernels) / sizeof(kernels[0]); k++)
+        {
+            if (!isKernelSupported(kernels[k]))
+            {
+                printf("%-8s not supported by this cpu\n", getKernelName(kernels[k]));
+                continue;
+            }
+
+            double checksum = 0.0;
+            Timer timer;
+            for (int r = 0; r < rounds; r++)
+                for (size_t g = 0; g < glyphs.size(); g++)
+                {
+                    // masks are prepared once per glyph, as recognizeMat does
+                    MaskedImage masks;
+                    prepareMasks(glyphs[g], masks);
+                    for (int t = 0; t < templates.count; t++)
+                        checksum += compareImages(masks, templates.ink(t), templates.white(t), kernels[k]);
+                }
+            report(getKernelName(kernels[k]), comparisons, timer.elapsedMs(), checksum);
+
+            if (checksum != reference)
+            {
+                printf("%s kernel results differ from the legacy ones\n", getKernelName(kernels[k]));
+                result = 1;
+            }
+        }
+
+        return result;
+    }
+}
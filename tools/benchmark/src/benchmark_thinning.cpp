@@ -0,0 +1,206 @@
+/****************************************************************************
+ * Copyright (C) from 2009 to Present EPAM Systems.
+ *
+ * This file is part of Imago toolkit.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ ***************************************************************************/
+
+#include <cstdio>
+#include <cstdlib>
+#include <vector>
+
+#include "benchmark.h"
+#include "prefilter_entry.h"
+#include "thin_filter2.h"
+
+namespace benchmark
+{
+    static inline imago::byte legacyGet(imago::Image& img, int x, int y)
+    {
+        x -= 10;
+        y -= 10;
+        if (x < 0 || y < 0 || x >= img.getWidth() || y >= img.getHeight())
+            return 0;
+        return img.getByte(x, y);
+    }
+
+    static inline void legacySet(imago::Image& img, int x, int y, imago::byte val)
+    {
+        x -= 10;
+        y -= 10;
+        if (x < 0 || y < 0 || x >= img.getWidth() || y >= img.getHeight())
+            return;
+        img.getByte(x, y) = val;
+    }
+
+    // thinning as it was before the bit-packed filter: pixel by pixel over the inverted image with a virtual border
+    static void thinLegacy(imago::Image& img)
+    {
+        const static int masks[] = {0200, 0002, 0040, 0010};
+        const static imago::byte del[512] = {
+            0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 1, 0, 0, 1, 1, 0, 1, 1, 1, 0, 0, 1, 1, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+            0, 0, 0, 1, 1, 1, 0, 1, 1, 0, 0, 1, 1, 0, 0, 1, 1, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 1, 1, 1, 1, 0, 0,
+            1, 1, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 1, 1, 0, 0, 1, 1, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+            0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 1, 1, 1, 1, 0, 0, 1, 1, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 1, 0, 1, 1, 1, 0, 1, 1, 1, 1, 1, 1,
+            1, 1, 1, 1, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 1, 0, 0, 0, 0, 0, 0, 0, 1, 1, 1, 1, 0, 0, 1, 1, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+            0, 0, 0, 0, 0, 1, 0, 1, 1, 1, 0, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+            0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 1, 0, 1, 1, 1, 0, 1, 1, 0, 0, 1, 1, 0, 0, 1, 1, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+            0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+            0, 0, 1, 1, 0, 0, 1, 1, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 1, 0, 0, 0, 0, 0, 0, 0, 1, 1, 1, 1, 0, 0, 1, 1, 0, 0, 0, 0, 0, 0, 0,
+            0, 0, 0, 0, 0, 0, 0, 0, 0, 1, 0, 1, 1, 1, 0, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 1, 0, 0, 0, 0, 0,
+            0, 0, 1, 1, 1, 1, 0, 0, 1, 1, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 1, 0, 1, 1, 1, 0, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1};
+
+        int xsize = img.getWidth() + 20;
+        int ysize = img.getHeight() + 20;
+        int count = 1;
+        int it = 0;
+        int p, q;
+        std::vector<int> qb(xsize);
+        qb[xsize - 1] = 0;
+
+        img.invertColor();
+
+        while (count && it < 20)
+        {
+            count = 0;
+            it++;
+
+            for (int i = 0; i < 4; i++)
+            {
+                int m = masks[i];
+
+                p = legacyGet(img, 0, 0) != 0;
+                for (int x = 0; x < xsize - 1; x++)
+                    qb[x] = p = ((p << 1) & 0006) | (legacyGet(img, x + 1, 0) != 0);
+
+                for (int y = 0; y < ysize - 1; y++)
+                {
+                    q = qb[0];
+                    p = ((q << 3) & 0110) | (legacyGet(img, 0, y + 1) != 0);
+
+                    for (int x = 0; x < xsize - 1; x++)
+                    {
+                        q = qb[x];
+                        p = ((p << 1) & 0666) | ((q << 3) & 0110) | (legacyGet(img, x + 1, y + 1) != 0);
+                        qb[x] = p;
+                        if (((p & m) == 0) && del[p])
+                        {
+                            count++;
+                            legacySet(img, x, y, 0);
+                        }
+                    }
+
+                    p = (p << 1) & 0666;
+                    if ((p & m) == 0 && del[p])
+                    {
+                        count++;
+                        legacySet(img, xsize - 1, y, 0);
+                    }
+                }
+
+                for (int x = 0; x < xsize; x++)
+                {
+                    q = qb[x];
+                    p = ((p << 1) & 0666) | ((q << 3) & 0110);
+                    if ((p & m) == 0 && del[p])
+                    {
+                        count++;
+                        legacySet(img, x, ysize - 1, 0);
+                    }
+                }
+            }
+        }
+
+        img.invertColor();
+    }
+
+    static bool samePixels(const imago::Image& a, const imago::Image& b)
+    {
+        if (a.getWidth() != b.getWidth() || a.getHeight() != b.getHeight())
+            return false;
+        for (int y = 0; y < a.getHeight(); y++)
+            for (int x = 0; x < a.getWidth(); x++)
+                if (a.getByte(x, y) != b.getByte(x, y))
+                    return false;
+        return true;
+    }
+
+    int benchmarkThinning(const strings& args)
+    {
+        std::string dir = args.size() > 0 ? args[0] : "../imago/tests/images";
+        int rounds = args.size() > 1 ? atoi(args[1].c_str()) : 5;
+
+        std::vector<imago::Image> loaded;
+        if (loadImages(dir, loaded) == 0)
+        {
+            printf("No images loaded from '%s'\n", dir.c_str());
+            return 1;
+        }
+
+        // thinning works on the binarized pages
+        std::vector<imago::Image> images;
+        for (size_t u = 0; u < loaded.size(); u++)
+        {
+            imago::Settings vars;
+            imago::Image img;
+            try
+            {
+                if (imago::prefilterEntrypoint(vars, img, loaded[u]))
+                    images.push_back(img);
+            }
+            catch (std::exception&)
+            {
+            }
+        }
+
+        size_t same = 0;
+        for (size_t u = 0; u < images.size(); u++)
+        {
+            imago::Image legacy(images[u]), packed(images[u]);
+            thinLegacy(legacy);
+            imago::ThinFilter2(packed).apply();
+            if (samePixels(legacy, packed))
+                same++;
+        }
+
+        double pixels = 0.0;
+        for (size_t u = 0; u < images.size(); u++)
+            pixels += (double)images[u].getWidth() * images[u].getHeight();
+        pixels *= rounds;
+
+        Timer timer;
+        for (int r = 0; r < rounds; r++)
+            for (size_t u = 0; u < images.size(); u++)
+            {
+                imago::Image img(images[u]);
+                thinLegacy(img);
+            }
+        double legacy_ms = timer.elapsedMs();
+
+        timer.reset();
+        for (int r = 0; r < rounds; r++)
+            for (size_t u = 0; u < images.size(); u++)
+            {
+                imago::Image img(images[u]);
+                imago::ThinFilter2(img).apply();
+            }
+        double packed_ms = timer.elapsedMs();
+
+        printf("%-8s %12.1f ms %10.1f Mpixels/s\n", "legacy", legacy_ms, pixels / legacy_ms / 1000.0);
+        printf("%-8s %12.1f ms %10.1f Mpixels/s\n", "packed", packed_ms, pixels / packed_ms / 1000.0);
+        printf("pixel-exact: %u/%u images\n", (unsigned)same, (unsigned)images.size());
+
+        return same == images.size() ? 0 : 1;
+    }
+}
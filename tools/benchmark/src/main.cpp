@@ -0,0 +1,144 @@
+/****************************************************************************
+ * Copyright (C) from 2009 to Present EPAM Systems.
+ *
+ * This file is part of Imago toolkit.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ ***************************************************************************/
+
+#include <cstdio>
+#include <cstring>
+
+#include "benchmark.h"
+#include "chemical_structure_recognizer.h"
+#include "image_utils.h"
+#include "log_ext.h"
+#include "molecule.h"
+#include "prefilter_entry.h"
+#include "superatom_expansion.h"
+
+namespace benchmark
+{
+    // the second molfile line holds the creation time
+    static std::string withoutTimestamp(const std::string& molfile)
+    {
+        size_t first = molfile.find('\n');
+        if (first == std::string::npos)
+            return molfile;
+        size_t second = molfile.find('\n', first + 1);
+        if (second == std::string::npos)
+            return molfile;
+        return molfile.substr(0, first + 1) + molfile.substr(second);
+    }
+
+    size_t loadImages(const std::string& dir, std::vector<imago::Image>& images, strings* names)
+    {
+        strings files;
+        if (file_helpers::getDirectoryContent(dir, files, false) != 0)
+            return 0;
+        file_helpers::filterOnlyImages(files);
+
+        for (size_t u = 0; u < files.size(); u++)
+        {
+            try
+            {
+                imago::Image img;
+                imago::ImageUtils::loadImageFromFile(img, "%s", files[u].c_str());
+                images.push_back(img);
+                if (names)
+                    names->push_back(files[u]);
+            }
+            catch (std::exception& e)
+            {
+                printf("Skipped '%s': %s\n", files[u].c_str(), e.what());
+            }
+        }
+
+        return images.size();
+    }
+
+    double recognizeImages(const imago::Settings& vars, const std::vector<imago::Image>& images, int rounds, strings* molfiles)
+    {
+        if (molfiles)
+            molfiles->assign(images.size(), std::string());
+
+        Timer timer;
+        for (int r = 0; r < rounds; r++)
+        {
+            for (size_t u = 0; u < images.size(); u++)
+            {
+                imago::Settings local = vars;
+                imago::Image img;
+                imago::Molecule mol;
+                imago::ChemicalStructureRecognizer csr;
+                try
+                {
+                    if (imago::prefilterEntrypoint(local, img, images[u]))
+                    {
+                        csr.image2mol(local, img, mol);
+                        if (molfiles && r == rounds - 1)
+                            (*molfiles)[u] = withoutTimestamp(imago::expandSuperatoms(local, mol));
+                    }
+                }
+                catch (std::exception&)
+                {
+                    // recognition failures are the part of workload
+                }
+            }
+        }
+        return timer.elapsedMs();
+    }
+}
+
+struct BenchmarkEntry
+{
+    const char* name;
+    const char* description;
+    int (*routine)(const strings& args);
+};
+
+static const BenchmarkEntry benchmarks[] = {
+    {"logging", "[images_dir] [rounds]: overhead of the disabled debug log", benchmark::benchmarkLogging},
+    {"templates", "[rounds]: characters template matching speed per kernel", benchmark::benchmarkTemplates},
+    {"pruning", "[images_dir] [rounds]: accuracy and speed of characters templates pruning", benchmark::benchmarkPruning},
+    {"thinning", "[images_dir] [rounds]: bit-packed thinning speed and exactness against the pixel-wise one", benchmark::benchmarkThinning},
+    {"labelling", "[rounds]: run-length components labelling time on synthetic scans up to 5000x5000", benchmark::benchmarkLabelling},
+    {"binarized", "[rounds]: pixel passes of the binarized prefilter, row kernels against the pixel-wise ones", benchmark::benchmarkBinarized},
+    {"page", "[rounds]: tiled segmentation of synthetic A4 pages up to 900 dpi by tile size", benchmark::benchmarkPage},
+    {"captions", "[images_dir] [rounds]: recognition of binarized images, time saved by the incremental caption removal", benchmark::benchmarkCaptions},
+    {"graph", "[rounds]: building, edge lookups and edits of a graph with 10k edges", benchmark::benchmarkGraph},
+    {"rng", "[rounds]: symbols graph of random points by the Delaunay triangulation, checked edge-for-edge against the brute force", benchmark::benchmarkRNG},
+    {"hashes", "[rounds]: hash bonds extraction on synthetic drawings with up to 50k noise specks", benchmark::benchmarkHashes},
+};
+
+int main(int argc, char** argv)
+{
+    const size_t count = sizeof(benchmarks) / sizeof(benchmarks[0]);
+
+    if (argc > 1)
+    {
+        for (size_t u = 0; u < count; u++)
+        {
+            if (strcmp(argv[1], benchmarks[u].name) == 0)
+            {
+                strings args(argv + 2, argv + argc);
+                return benchmarks[u].routine(args);
+            }
+        }
+    }
+
+    printf("Usage: %s benchmark [parameters]\n", argv[0]);
+    for (size_t u = 0; u < count; u++)
+        printf("  %s %s\n", benchmarks[u].name, benchmarks[u].description);
+    return 1;
+}
@@ -16,6 +16,7 @@
  * limitations under the License.
  ***************************************************************************/
 
+#include <cstdio>
 #include <fstream>
 #include <iostream>
 #include <string>
@@ -23,15 +24,48 @@
 
 #include "character_recognizer.h"
 
-std::string EscapeCharacter(unsigned char c)
+using namespace imago::CharacterRecognizerImp;
+
+// writes the penalty plane of all templates, one penalty row per line
+unsigned char WritePlane(FILE* f, const char* name, const PackedTemplates& templates, bool ink)
+{
+    unsigned char max = 0;
+    fprintf(f, "    // %s\n", name);
+    fprintf(f, "    {\n");
+    for (int x = 0; x < templates.count; x++)
+    {
+        const unsigned char* plane = ink ? templates.ink(x) : templates.white(x);
+        fprintf(f, "        // %u: '%c'\n", (unsigned)x, templates.text[x]);
+        for (int y = 0; y < INTERNAL_ARRAY_DIM; y++)
+        {
+            fprintf(f, "        ");
+            for (int u = 0; u < INTERNAL_ARRAY_DIM; u++)
+            {
+                unsigned char c = plane[y * INTERNAL_ARRAY_DIM + u];
+                if (c > max)
+                    max = c;
+                fprintf(f, "%u,", (unsigned int)c);
+            }
+            fprintf(f, "\n");
+        }
+    }
+    fprintf(f, "    },\n");
+    return max;
+}
+
+// writes the low resolution signatures of templates
+void WriteSignatures(FILE* f, const PackedTemplates& templates)
 {
-    std::string result;
+    fprintf(f, "    // signature\n");
+    fprintf(f, "    {\n");
+    for (int x = 0; x < templates.count; x++)
     {
-        char buf[16] = {0};
-        sprintf(buf, "%x", (unsigned int)c);
-        result = (std::string)("\\x") + buf;
+        fprintf(f, "        ");
+        for (int u = 0; u < SIGNATURE_SIZE; u++)
+            fprintf(f, "%u,", (unsigned int)templates.signature(x)[u]);
+        fprintf(f, " // %u: '%c'\n", (unsigned)x, templates.text[x]);
     }
-    return result;
+    fprintf(f, "    },\n");
 }
 
 int main(int argc, char** argv)
@@ -46,50 +80,55 @@ int main(int argc, char** argv)
         std::string dir = argv[1];
         std::string file = argv[2];
         imago::Settings vars;
-        imago::CharacterRecognizerImp::Templates templates;
-        if (imago::CharacterRecognizerImp::initializeTemplates(vars, dir, templates))
+        Templates all;
+        if (initializeTemplates(vars, dir, all))
         {
-            printf("Initialized %u templates.\n", (unsigned)templates.size());
+            printf("Initialized %u templates.\n", (unsigned)all.size());
+
+            // only one-char-length templates are supported by recognizer
+            for (size_t x = 0; x < all.size(); x++)
+            {
+                if (all[x].text.size() != 1)
+                    printf("Skipped template '%s'\n", all[x].text.c_str());
+            }
+
+            // same packing as used for fonts loaded at runtime
+            TemplatesBuffer buffer(all);
+            const PackedTemplates& templates = buffer.getTemplates();
+
             FILE* f = fopen(file.c_str(), "w");
             if (f != NULL)
             {
-                fprintf(f, "imago::CharacterRecognizerImp::MatchRecord m;\n");
-                size_t dim = imago::CharacterRecognizerImp::REQUIRED_SIZE + 2 * imago::CharacterRecognizerImp::PENALTY_SHIFT;
-
-                unsigned char max1 = 0, max2 = 0;
-
-                for (size_t x = 0; x < templates.size(); x++)
-                {
-                    imago::CharacterRecognizerImp::MatchRecord& m = templates[x];
-                    fprintf(f, "m.text = \"%s\";\n", m.text.c_str());
-                    fprintf(f, "m.wh_ratio = %g;\n", m.wh_ratio);
-
-                    std::string s1, s2;
-
-                    for (size_t u = 0; u < imago::CharacterRecognizerImp::INTERNAL_ARRAY_SIZE; u++)
-                    {
-                        unsigned char c1 = m.penalty_ink[u];
-                        if (c1 > max1)
-                            max1 = c1;
-                        s1 += EscapeCharacter(c1);
-                    }
-
-                    for (size_t u = 0; u < imago::CharacterRecognizerImp::INTERNAL_ARRAY_SIZE; u++)
-                    {
-                        unsigned char c2 = m.penalty_white[u];
-                        if (c2 > max2)
-                            max2 = c2;
-                        s2 += EscapeCharacter(c2);
-                    }
-
-                    fprintf(f, "memcpy(m.penalty_ink, \"%s\", %u);\n", s1.c_str(), imago::CharacterRecognizerImp::INTERNAL_ARRAY_SIZE);
-                    fprintf(f, "memcpy(m.penalty_white, \"%s\", %u);\n", s2.c_str(), imago::CharacterRecognizerImp::INTERNAL_ARRAY_SIZE);
-                    fprintf(f, "templates.push_back(m);\n");
-                }
+                fprintf(f, "// generated by font-generator, do not edit\n");
+                fprintf(f, "const int FONT_TEMPLATES_COUNT = %u;\n\n", (unsigned)templates.count);
+                fprintf(f, "alignas(64) constexpr PackedFont<FONT_TEMPLATES_COUNT> FONT_DATA = {\n");
+
+                unsigned char max1 = WritePlane(f, "penalty_ink", templates, true);
+                unsigned char max2 = WritePlane(f, "penalty_white", templates, false);
+                WriteSignatures(f, templates);
+
+                fprintf(f, "    // wh_ratio\n");
+                fprintf(f, "    {");
+                for (int x = 0; x < templates.count; x++)
+                    fprintf(f, "%s%g,", (x % 16 == 0) ? "\n        " : " ", templates.wh_ratio[x]);
+                fprintf(f, "\n    },\n");
+
+                fprintf(f, "    // text\n");
+                fprintf(f, "    {");
+                for (int x = 0; x < templates.count; x++)
+                    fprintf(f, "%s%u,", (x % 32 == 0) ? "\n        " : " ", (unsigned int)(unsigned char)templates.text[x]);
+                fprintf(f, "\n    },\n");
+
+                fprintf(f, "    // first\n");
+                fprintf(f, "    {");
+                for (int c = 0; c < CHARACTERS_INDEX_SIZE; c++)
+                    fprintf(f, "%s%u,", (c % 32 == 0) ? "\n        " : " ", (unsigned)templates.first[c]);
+                fprintf(f, "\n    }\n");
+                fprintf(f, "};\n");
 
                 printf("Maximal penalty_ink = %u [%s]\n", (unsigned int)max1, (max1 < 255) ? "OK" : "FAIL");
                 printf("Maximal penalty_white = %u [%s]\n", (unsigned int)max2, (max2 < 255) ? "OK" : "FAIL");
-                printf("Stored %u templates.\n", (unsigned)templates.size());
+                printf("Stored %u templates.\n", (unsigned)templates.count);
 
                 fclose(f);
             }
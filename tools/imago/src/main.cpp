@@ -18,13 +18,57 @@
 
 #include <indigo.h>
 
+#include "character_recognizer.h"
 #include "file_helpers.h"
+#include "glyph_cache.h"
 #include "log_ext.h"
 #include "machine_learning.h"
 #include "recognition_helpers.h"
 #include "settings.h"
 #include "similarity_tools.h"
 
+// stores the process-wide glyph cache back to file on exit
+struct GlyphCacheFile
+{
+    std::string path;
+
+    void load()
+    {
+        FILE* f = fopen(path.c_str(), "rb");
+        if (f == NULL)
+            return; // will be created on exit
+        fclose(f);
+
+        try
+        {
+            imago::GlyphCache::getInstance().load(path);
+        }
+        catch (std::exception& e)
+        {
+            printf("Glyph cache is not loaded: %s\n", e.what());
+        }
+    }
+
+    ~GlyphCacheFile()
+    {
+        if (path.empty())
+            return;
+
+        imago::GlyphCacheStatistics stats = imago::GlyphCache::getInstance().getStatistics();
+        printf("Glyph cache: %llu hits, %llu misses, %llu evictions, %llu entries\n", (unsigned long long)stats.hits, (unsigned long long)stats.misses,
+               (unsigned long long)stats.evictions, (unsigned long long)stats.entries);
+
+        try
+        {
+            imago::GlyphCache::getInstance().save(path);
+        }
+        catch (std::exception& e)
+        {
+            printf("Glyph cache is not saved: %s\n", e.what());
+        }
+    }
+};
+
 int main(int argc, char** argv)
 {
     qword sid = indigoAllocSessionId();
@@ -47,14 +91,19 @@ int main(int argc, char** argv)
         printf("  -logvfs: stores log in single encoded file ./log_vfs.txt \n");
         printf("  -noexp: do not expand chemical abbreviations \n");
         printf("  -pr: use probablistic separator (experimental) \n");
+        printf("  -parallelfilters: try all prefilters concurrently, the first good one in order wins \n");
+        printf("  -tiled: locate structure candidates on a large page by tiles, recognize only them \n");
         printf("  -tl time_in_ms: timelimit per single image process (default is %u) \n", vars.general.TimeLimit);
         printf("  -similarity tool [-sparam additional_parameters]: override the default comparison method \n");
         printf("  -pass: don't process images, only print their filenames \n");
         printf("  -override config_string: override config by applying specified string \n");
+        printf("  -glyphcache file: warm recognized characters cache from file and store it back on exit \n");
+        printf("  -font dir_name: extend built-in characters templates by the ones from dir_name \n");
         printf("\n BATCHES: \n");
         printf("  -dir dir_name: process every image from dir dir_name \n");
         printf("    -rec: process directory recursively \n");
         printf("    -images: skip non-supported files from directory \n");
+        printf("    -threads count: process images in parallel (0 means all cores), ignored with -log and -logvfs \n");
         printf("\n SHORTCUTS: \n");
         printf("  -learnd dir_name: -learn -dir dir_name -images \n");
         return 0;
@@ -77,6 +126,9 @@ int main(int argc, char** argv)
     bool next_arg_tl = false;
     bool next_arg_override_cfg = false;
     bool next_arg_output = false;
+    bool next_arg_threads = false;
+    bool next_arg_glyph_cache = false;
+    bool next_arg_font = false;
     int next_arg_compare = 0; // two args
 
     bool mode_recursive = false;
@@ -86,6 +138,9 @@ int main(int argc, char** argv)
     bool mode_retcode = false;
     bool mode_test_filter_only = false;
 
+    int threads = -1; // sequential processing
+    GlyphCacheFile glyph_cache;
+
     for (int c = 1; c < argc; c++)
     {
         std::string param = argv[c];
@@ -105,6 +160,12 @@ int main(int argc, char** argv)
         else if (param == "-pr" || param == "-probablistic")
             vars.general.UseProbablistics = true;
 
+        else if (param == "-parallelfilters")
+            vars.general.ParallelFilters = true;
+
+        else if (param == "-tiled")
+            vars.general.TiledPage = true;
+
         else if (param == "-dir")
             next_arg_dir = true;
 
@@ -141,6 +202,15 @@ int main(int argc, char** argv)
         else if (param == "-override")
             next_arg_override_cfg = true;
 
+        else if (param == "-threads")
+            next_arg_threads = true;
+
+        else if (param == "-glyphcache")
+            next_arg_glyph_cache = true;
+
+        else if (param == "-font")
+            next_arg_font = true;
+
         else if (param == "-learnd")
         {
             mode_learning = true;
@@ -197,6 +267,21 @@ int main(int argc, char** argv)
                 sim_param = param;
                 next_arg_sim_param = false;
             }
+            else if (next_arg_threads)
+            {
+                threads = atoi(param.c_str());
+                next_arg_threads = false;
+            }
+            else if (next_arg_glyph_cache)
+            {
+                glyph_cache.path = param;
+                next_arg_glyph_cache = false;
+            }
+            else if (next_arg_font)
+            {
+                vars.general.FontDirectory = param;
+                next_arg_font = false;
+            }
             else if (next_arg_tl)
             {
                 vars.general.TimeLimit = atoi(param.c_str());
@@ -234,6 +319,23 @@ int main(int argc, char** argv)
 
     imago::getLogExt().setLoggingEnabled(vars.general.LogEnabled);
 
+    if (!glyph_cache.path.empty())
+        glyph_cache.load();
+
+    if (!vars.general.FontDirectory.empty())
+    {
+        try
+        {
+            const imago::CharacterRecognizerImp::PackedTemplates& font = imago::CharacterRecognizerImp::getFontTemplates(vars, vars.general.FontDirectory);
+            printf("Loaded font with %d templates\n", font.count);
+        }
+        catch (std::exception& e)
+        {
+            printf("[ERROR] Can't load font: %s\n", e.what());
+            return 2;
+        }
+    }
+
     similarity_tools::setExternalSimilarityTool(sim_tool, sim_param);
 
     if (!override_cfg.empty())
@@ -288,7 +390,11 @@ int main(int argc, char** argv)
         {
             return machine_learning::performMachineLearning(vars, files, config);
         }
-        else // process or pass
+        else if (threads >= 0 && !mode_pass && !vars.general.LogEnabled && !vars.general.LogVFSEnabled)
+        {
+            return recognition_helpers::performParallelFileAction(true, vars, files, config, threads);
+        }
+        else // process or pass, also with the debug log which is enabled for the main thread only
         {
             for (size_t u = 0; u < files.size(); u++)
             {
@@ -1,13 +1,18 @@
 #include "recognition_helpers.h"
 
+#include <atomic>
+#include <thread>
+
 #include <indigo-renderer.h>
 #include <indigo.h>
 
 #include "chemical_structure_recognizer.h"
+#include "filter_race.h"
 #include "image_utils.h"
 #include "log_ext.h"
 #include "molecule.h"
 #include "output.h"
+#include "page_segmentator.h"
 #include "prefilter_entry.h"
 #include "superatom_expansion.h"
 
@@ -53,8 +58,37 @@ namespace recognition_helpers
         }
     }
 
+    static RecognitionResult recognizeImageParallel(bool verbose, imago::Settings& vars, const imago::Image& src, const std::string& config)
+    {
+        imago::FilterRaceResult race;
+
+        // config is applied in the filter threads, so without the console output
+        if (!imago::recognizeFilterRace(vars, src, race, [&config](imago::Settings& local) { applyConfig(false, local, config); }))
+        {
+            if (verbose)
+                printf("No filter succeeded, last error '%s'.\n", race.error.c_str());
+
+            RecognitionResult result;
+            result.warnings = 999;
+            return result;
+        }
+
+        if (verbose)
+            printf("Filter [%u] selected, warnings: %u.\n", race.filterIndex, race.warnings);
+
+        vars = race.vars;
+
+        RecognitionResult result;
+        result.molecule = race.molfile;
+        result.warnings = race.warnings;
+        return result;
+    }
+
     RecognitionResult recognizeImage(bool verbose, imago::Settings& vars, const imago::Image& src, const std::string& config)
     {
+        if (vars.general.ParallelFilters)
+            return recognizeImageParallel(verbose, vars, src, config);
+
         std::vector<RecognitionResult> results;
 
         imago::ChemicalStructureRecognizer _csr;
@@ -64,7 +98,7 @@ namespace recognition_helpers
         {
             bool good = false;
 
-            vars.general.StartTime = 0;
+            vars.restartTimeLimit();
 
             try
             {
@@ -86,12 +120,7 @@ namespace recognition_helpers
 
                 RecognitionResult result;
                 result.molecule = imago::expandSuperatoms(vars, mol);
-                result.warnings = mol.getWarningsCount() + mol.getDissolvingsCount() / vars.main.DissolvingsFactor;
-
-                if (vars.dynamic.CapitalHeight < vars.main.MinGoodCharactersSize && !vars.general.ImageAlreadyBinarized)
-                {
-                    result.warnings += vars.main.WarningsForTooSmallCharacters;
-                }
+                result.warnings = imago::getRecognitionWarnings(vars, mol);
 
                 results.push_back(result);
 
@@ -123,6 +152,43 @@ namespace recognition_helpers
         return result;
     }
 
+    RecognitionResult recognizePage(bool verbose, imago::Settings& vars, const imago::Image& page, const std::string& config)
+    {
+        imago::PageLayout layout;
+        imago::PageSegmentator::segmentate(vars, page, layout);
+
+        imago::PageRegions candidates;
+        imago::PageSegmentator::selectCandidates(vars, layout, candidates);
+
+        if (verbose)
+            printf("Page: %u regions, %u candidates, component height %.1f.\n", (unsigned)layout.regions.size(), (unsigned)candidates.size(),
+                   layout.componentHeight);
+
+        RecognitionResult result;
+        result.warnings = 999; // just big number to override
+
+        // the same choice as for filters: the first good candidate, otherwise the one with least warnings
+        for (size_t u = 0; u < candidates.size(); u++)
+        {
+            const imago::Rectangle& bounds = candidates[u].bounds;
+            if (verbose)
+                printf("Candidate [%u] at %d,%d size %dx%d.\n", (unsigned)u, bounds.x, bounds.y, bounds.width + 1, bounds.height + 1);
+
+            imago::Image region;
+            imago::PageSegmentator::cropRegion(page, bounds, layout.gap, region);
+
+            imago::Settings local = vars;
+            RecognitionResult candidate = recognizeImage(verbose, local, region, config);
+            if (candidate.warnings < result.warnings)
+                result = candidate;
+
+            if (candidate.warnings <= vars.main.WarningsRecalcTreshold)
+                break;
+        }
+
+        return result;
+    }
+
     int performFilterTest(imago::Settings& vars, const std::string& imageName)
     {
         int result = 0; // ok mark
@@ -152,7 +218,7 @@ namespace recognition_helpers
         int result = 0; // ok mark
         imago::VirtualFS vfs;
 
-        vars.general.StartTime = 0; // reset timelimit
+        vars.restartTimeLimit();
 
         if (vars.general.ExtractCharactersOnly)
         {
@@ -186,7 +252,8 @@ namespace recognition_helpers
             }
             else
             {
-                RecognitionResult result = recognizeImage(verbose, vars, image, configName);
+                RecognitionResult result = vars.general.TiledPage ? recognizePage(verbose, vars, image, configName)
+                                                                  : recognizeImage(verbose, vars, image, configName);
                 imago::FileOutput fout(outputName.c_str());
                 fout.writeString(result.molecule.c_str());
                 if (imago::getLogExt().loggingEnabled())
@@ -214,4 +281,36 @@ namespace recognition_helpers
 
         return result;
     }
+
+    int performParallelFileAction(bool verbose, const imago::Settings& vars, const strings& imageNames, const std::string& configName, int threads)
+    {
+        if (threads <= 0)
+            threads = std::max(1, (int)std::thread::hardware_concurrency());
+
+        std::atomic<size_t> next(0);
+        std::atomic<int> failed(0);
+
+        std::vector<std::thread> workers;
+        for (int t = 0; t < threads; t++)
+        {
+            workers.push_back(std::thread([&]() {
+                qword sid = indigoAllocSessionId();
+                indigoSetSessionId(sid);
+
+                for (size_t u = next++; u < imageNames.size(); u = next++)
+                {
+                    imago::Settings local = vars;
+                    if (performFileAction(verbose, local, imageNames[u], configName, imageNames[u] + ".result.mol") != 0)
+                        failed++;
+                }
+
+                indigoReleaseSessionId(sid);
+            }));
+        }
+
+        for (size_t u = 0; u < workers.size(); u++)
+            workers[u].join();
+
+        return failed > 0 ? 2 : 0;
+    }
 }
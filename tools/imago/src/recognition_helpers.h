@@ -20,6 +20,7 @@
 
 #include <string>
 
+#include "file_helpers.h"
 #include "image.h"
 #include "settings.h"
 #include "virtual_fs.h"
@@ -37,9 +38,16 @@ namespace recognition_helpers
 
     RecognitionResult recognizeImage(bool verbose, imago::Settings& vars, const imago::Image& src, const std::string& config);
 
+    // finds candidate regions of the page by tiles and recognizes them one by one, the large
+    // page itself never goes through the prefilters and the recognizer
+    RecognitionResult recognizePage(bool verbose, imago::Settings& vars, const imago::Image& page, const std::string& config);
+
     int performFilterTest(imago::Settings& vars, const std::string& imageName);
 
     int performFileAction(bool verbose, imago::Settings& vars, const std::string& imageName, const std::string& configName,
                           const std::string& outputName = "molecule.mol");
 
+    // processes every image with a fresh copy of vars using the specified count of worker threads (0 means all cores)
+    int performParallelFileAction(bool verbose, const imago::Settings& vars, const strings& imageNames, const std::string& configName, int threads);
+
 }
@@ -0,0 +1,74 @@
+import os
+import shutil
+import subprocess
+import sys
+import tempfile
+
+imago_root = os.path.normpath(
+    os.path.join(os.path.abspath(__file__), "..", "..", "..", "..")
+)
+
+
+def recognizeDir(dir, options):
+    if os.name == "nt":
+        execSuffix = ".exe"
+    else:
+        execSuffix = ""
+
+    subprocess.check_call(
+        [
+            f"{imago_root}/dist/imago{execSuffix}",
+            "-dir",
+            dir,
+            "-images",
+            "-tl",
+            "0",
+            "-threads",
+            "1",
+        ]
+        + options,
+        stdout=subprocess.DEVNULL,
+    )
+
+    results = {}
+    for f in sorted(os.listdir(dir)):
+        if f.endswith(".result.mol"):
+            path = os.path.join(dir, f)
+            with open(path) as fin:
+                lines = fin.read().splitlines()
+            # the second line of molfile header contains a timestamp
+            results[f] = lines[:1] + lines[2:]
+            os.remove(path)
+    return results
+
+
+if __name__ == "__main__":
+    workDir = tempfile.mkdtemp()
+    try:
+        for f in sorted(os.listdir("images")):
+            if f.endswith(".png") or f.endswith(".jpg"):
+                shutil.copy(os.path.join("images", f), workDir)
+
+        # the filters tried one by one against all of them raced at once
+        reference = recognizeDir(workDir, [])
+        results = recognizeDir(workDir, ["-parallelfilters"])
+
+        failures = 0
+        for name in sorted(set(reference.keys()) | set(results.keys())):
+            if name not in results:
+                sys.stderr.write("%s is missing with parallel filters\n" % name)
+                failures += 1
+            elif name not in reference:
+                sys.stderr.write("%s is missing with sequential filters\n" % name)
+                failures += 1
+            elif results[name] != reference[name]:
+                sys.stderr.write("%s differs from sequential filters result\n" % name)
+                failures += 1
+    finally:
+        shutil.rmtree(workDir)
+
+    print("Test results:")
+    print("Total images: %s" % len(reference))
+    print("Mismatches: %s" % failures)
+
+    exit(0 if failures == 0 and len(reference) > 0 else 1)
@@ -0,0 +1,82 @@
+import os
+import shutil
+import subprocess
+import sys
+import tempfile
+from multiprocessing import cpu_count
+
+imago_root = os.path.normpath(
+    os.path.join(os.path.abspath(__file__), "..", "..", "..", "..")
+)
+
+
+def recognizeDir(dir, threads=None):
+    if os.name == "nt":
+        execSuffix = ".exe"
+    else:
+        execSuffix = ""
+
+    args = [
+        f"{imago_root}/dist/imago{execSuffix}",
+        "-dir",
+        dir,
+        "-images",
+        "-tl",
+        "0",
+    ]
+    # without -threads the images are recognized one by one on the main thread
+    if threads is not None:
+        args += ["-threads", str(threads)]
+
+    # the exit code is not checked: the sequential directory mode always returns 1,
+    # and the failed images are compared by their missing results
+    subprocess.call(args, stdout=subprocess.DEVNULL)
+
+    results = {}
+    for f in sorted(os.listdir(dir)):
+        if f.endswith(".result.mol"):
+            path = os.path.join(dir, f)
+            with open(path) as fin:
+                lines = fin.read().splitlines()
+            # the second line of molfile header contains a timestamp
+            results[f] = lines[:1] + lines[2:]
+            os.remove(path)
+    return results
+
+
+if __name__ == "__main__":
+    rounds = int(sys.argv[1]) if len(sys.argv) > 1 else 3
+    threads = cpu_count()
+
+    workDir = tempfile.mkdtemp()
+    try:
+        for f in sorted(os.listdir("images")):
+            if f.endswith(".png") or f.endswith(".jpg"):
+                shutil.copy(os.path.join("images", f), workDir)
+
+        reference = recognizeDir(workDir)
+
+        failures = 0
+        for r in range(rounds):
+            results = recognizeDir(workDir, threads)
+            for name in sorted(reference.keys()):
+                if results.get(name) != reference[name]:
+                    sys.stderr.write(
+                        "Round %d: %s differs from sequential result\n"
+                        % (r, name)
+                    )
+                    failures += 1
+            for name in sorted(set(results.keys()) - set(reference.keys())):
+                sys.stderr.write(
+                    "Round %d: %s is missing in sequential run\n" % (r, name)
+                )
+                failures += 1
+    finally:
+        shutil.rmtree(workDir)
+
+    print("Test results:")
+    print("Total images: %s" % len(reference))
+    print("Threads: %s, rounds: %s" % (threads, rounds))
+    print("Mismatches: %s" % failures)
+
+    exit(0 if failures == 0 and len(reference) > 0 else 1)